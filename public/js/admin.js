@@ -108,24 +108,34 @@ async function deleteExercise() {
   }
 }
 
-async function loadUsers() {
+// Paginado: sem cursor recarrega a tabela, com cursor acrescenta a página seguinte
+async function loadUsers(cursor = null) {
   const container = $("usersList");
   if (!container) return;
-  container.textContent = "a carregar...";
+  if (!cursor) container.textContent = "a carregar...";
 
   try {
-    const users = await api("/admin/users", { auth: true });
-    container.innerHTML = "";
-
-    if (!users || users.length === 0) {
-      container.textContent = "Nenhum utilizador encontrado.";
-      return;
+    const page = await api("/admin/users" + (cursor ? "?after_id=" + encodeURIComponent(cursor) : ""), { auth: true });
+    const users = page?.items || [];
+    $("moreUsers")?.remove();
+
+    let tbody = container.querySelector("tbody");
+    if (!cursor || !tbody) {
+      container.innerHTML = "";
+
+      if (users.length === 0) {
+        container.textContent = "Nenhum utilizador encontrado.";
+        return;
+      }
+
+      const table = document.createElement("table");
+      table.innerHTML = "<thead><tr><th>ID</th><th>Email</th><th>Nome</th><th>Apelido</th><th>Role</th></tr></thead>";
+      tbody = document.createElement("tbody");
+      table.appendChild(tbody);
+      container.appendChild(table);
     }
 
-    const table = document.createElement("table");
-    table.innerHTML = "<thead><tr><th>ID</th><th>Email</th><th>Nome</th><th>Apelido</th><th>Role</th></tr></thead>";
-    const tbody = document.createElement("tbody");
-    (users || []).forEach(u => {
+    users.forEach(u => {
       const tr = document.createElement("tr");
       tr.innerHTML = `
         <td>${u.id}</td>
@@ -136,8 +146,15 @@ async function loadUsers() {
       `;
       tbody.appendChild(tr);
     });
-    table.appendChild(tbody);
-    container.appendChild(table);
+
+    if (page?.next_cursor) {
+      const more = document.createElement("button");
+      more.id = "moreUsers";
+      more.textContent = "Carregar mais";
+      more.style.marginTop = "10px";
+      more.onclick = () => loadUsers(page.next_cursor);
+      container.appendChild(more);
+    }
   } catch (e) {
     container.textContent = e.message;
   }
@@ -196,7 +213,7 @@ function wire() {
   if (btnDel) btnDel.onclick = deleteExercise;
 
   const btnLoadUsers = $("btnLoadUsers");
-  if (btnLoadUsers) btnLoadUsers.onclick = loadUsers;
+  if (btnLoadUsers) btnLoadUsers.onclick = () => loadUsers();
 
   const btnCreateUser = $("btnCreateUser");
   if (btnCreateUser) btnCreateUser.onclick = createUser;
@@ -1,16 +1,25 @@
 const API_BASE = "";
 
+// Respostas GET com ETag (por token + caminho): o pedido seguinte manda
+// If-None-Match e, se o servidor responder 304, reutiliza-se o JSON guardado.
+const etagCache = new Map();
+
 async function api(path, { method="GET", body=null, auth=false } = {}) {
   const headers = {};
 
   if (body !== null) headers["Content-Type"] = "application/json";
 
+  let token = "";
   if (auth) {
-    const t = localStorage.getItem("token") || "";
-    if (!t) throw new Error("Sem token");
-    headers["Authorization"] = "Bearer " + t;
+    token = localStorage.getItem("token") || "";
+    if (!token) throw new Error("Sem token");
+    headers["Authorization"] = "Bearer " + token;
   }
 
+  const cacheKey = token + " " + path;
+  const cached = method === "GET" ? etagCache.get(cacheKey) : undefined;
+  if (cached) headers["If-None-Match"] = cached.etag;
+
   let res;
   try {
     res = await fetch(API_BASE + path, {
@@ -22,6 +31,7 @@ async function api(path, { method="GET", body=null, auth=false } = {}) {
     throw new Error("Não consegui ligar ao servidor.");
   }
 
+  if (res.status === 304 && cached) return structuredClone(cached.data);
   if (res.status === 204) return null;
 
   const text = await res.text();
@@ -29,5 +39,8 @@ async function api(path, { method="GET", body=null, auth=false } = {}) {
   try { data = text ? JSON.parse(text) : null; } catch {}
 
   if (!res.ok) throw new Error(data?.error || text || `HTTP ${res.status}`);
+
+  const etag = method === "GET" ? res.headers.get("ETag") : null;
+  if (etag) etagCache.set(cacheKey, { etag, data: structuredClone(data) });
   return data;
 }
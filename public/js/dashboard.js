@@ -67,16 +67,19 @@ $("btnCreateW").onclick = async () => {
   }
 };
 
-async function loadWorkouts() {
+// Paginado: sem cursor recarrega a lista, com cursor acrescenta a página seguinte
+async function loadWorkouts(cursor = null) {
   const container = $("workoutsList");
   if (!container) return;
-  container.textContent = "a carregar...";
+  if (!cursor) container.textContent = "a carregar...";
 
   try {
-    const workouts = await api("/workouts", { auth:true });
-    container.innerHTML = "";
+    const page = await api("/workouts" + (cursor ? "?after_id=" + encodeURIComponent(cursor) : ""), { auth:true });
+    const workouts = page?.items || [];
+    if (!cursor) container.innerHTML = "";
+    $("moreWorkouts")?.remove();
 
-    if (!workouts || workouts.length === 0) {
+    if (!cursor && workouts.length === 0) {
       container.textContent = "Nenhum workout encontrado.";
       return;
     }
@@ -95,6 +98,15 @@ async function loadWorkouts() {
       `;
       container.appendChild(div);
     });
+
+    if (page?.next_cursor) {
+      const more = document.createElement("button");
+      more.id = "moreWorkouts";
+      more.className = "small";
+      more.textContent = "Carregar mais";
+      more.onclick = () => loadWorkouts(page.next_cursor);
+      container.appendChild(more);
+    }
   } catch (e) {
     container.textContent = e.message;
   }
@@ -247,6 +259,6 @@ $("btnLoadPRs").onclick = async () => {
   }
 };
 
-$("btnRefreshWorkouts").onclick = loadWorkouts;
+$("btnRefreshWorkouts").onclick = () => loadWorkouts();
 
 init();
@@ -2,13 +2,13 @@
 #define ADMIN_H
 
 #include "mongoose.h"
+#include "auth.h"
 
 // POST /admin/users
-void handle_post_admin_users(struct mg_connection *c, struct mg_http_message *hm);
+void handle_post_admin_users(struct mg_connection *c, struct mg_http_message *hm,
+                             const struct request_ctx *ctx);
 // GET /admin/users
-void handle_get_admin_users(struct mg_connection *c);
-
-// Middleware: exige sessão válida e role=admin
-int auth_require_admin(struct mg_connection *c, struct mg_http_message *hm, int *out_user_id);
+void handle_get_admin_users(struct mg_connection *c, struct mg_http_message *hm,
+                            const struct request_ctx *ctx);
 
 #endif
@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "agg.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AGG_X86 1
+#include <immintrin.h>
+#endif
+
+static int s_impl = -1;
+
+// ======================================================
+// Escalar (referência)
+// ======================================================
+static void agg_scalar(const struct agg_input *in, struct agg_result *out) {
+  long long count = 0;
+  double volume = 0;
+  double min_w = INFINITY, max_w = -INFINITY;
+  double min_r = INFINITY, max_r = -INFINITY;
+  double max_v = -INFINITY;
+
+  for (int i = 0; i < in->n; i++) {
+    int64_t t = in->ts[i];
+    if (t < in->from_ts || t >= in->to_ts) continue;
+    if (in->exercise >= 0 && in->exercise_id[i] != in->exercise) continue;
+
+    double r = (double) in->reps[i];
+    double w = in->weight[i];
+    double v = r * w;
+
+    count++;
+    volume += v;
+    if (w < min_w) min_w = w;
+    if (w > max_w) max_w = w;
+    if (r < min_r) min_r = r;
+    if (r > max_r) max_r = r;
+    if (v > max_v) max_v = v;
+  }
+
+  memset(out, 0, sizeof(*out));
+  out->count = count;
+  if (count == 0) return;
+  out->volume = volume;
+  out->min_weight = min_w;
+  out->max_weight = max_w;
+  out->min_reps = (int) min_r;
+  out->max_reps = (int) max_r;
+  out->max_volume = max_v;
+}
+
+// Junta o resultado dos lanes SIMD com a cauda escalar
+static void agg_merge(struct agg_result *out, long long count, double volume,
+                      double min_w, double max_w, double min_r, double max_r, double max_v,
+                      const struct agg_input *in, int done) {
+  struct agg_input tail = *in;
+  struct agg_result t;
+  tail.n = in->n - done;
+  tail.ts += done;
+  tail.exercise_id += done;
+  tail.reps += done;
+  tail.weight += done;
+  agg_scalar(&tail, &t);
+
+  if (t.count > 0) {
+    volume += t.volume;
+    if (t.min_weight < min_w) min_w = t.min_weight;
+    if (t.max_weight > max_w) max_w = t.max_weight;
+    if (t.min_reps < min_r) min_r = t.min_reps;
+    if (t.max_reps > max_r) max_r = t.max_reps;
+    if (t.max_volume > max_v) max_v = t.max_volume;
+    count += t.count;
+  }
+
+  memset(out, 0, sizeof(*out));
+  out->count = count;
+  if (count == 0) return;
+  out->volume = volume;
+  out->min_weight = min_w;
+  out->max_weight = max_w;
+  out->min_reps = (int) min_r;
+  out->max_reps = (int) max_r;
+  out->max_volume = max_v;
+}
+
+#ifdef AGG_X86
+// ======================================================
+// SSE2: 2 sets por iteração (lanes de 64 bits)
+// ======================================================
+
+// a > b com sinal em 64 bits (o SSE2 só compara 32 bits): parte alta com
+// sinal; se igual, parte baixa sem sinal (xor com o bit de sinal)
+static __m128i sse2_cmpgt_epi64(__m128i a, __m128i b) {
+  const __m128i sign_lo = _mm_set_epi32(0, (int) 0x80000000, 0, (int) 0x80000000);
+  __m128i as = _mm_xor_si128(a, sign_lo);
+  __m128i bs = _mm_xor_si128(b, sign_lo);
+  __m128i gt = _mm_cmpgt_epi32(as, bs);
+  __m128i eq = _mm_cmpeq_epi32(as, bs);
+  // hi_gt | (hi_eq & lo_gt), espalhado pelos 2 halves do lane
+  __m128i lo_gt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0));
+  __m128i hi_gt = _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128i hi_eq = _mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1));
+  return _mm_or_si128(hi_gt, _mm_and_si128(hi_eq, lo_gt));
+}
+
+static double sse2_hmin(__m128d v) {
+  return _mm_cvtsd_f64(_mm_min_sd(v, _mm_unpackhi_pd(v, v)));
+}
+static double sse2_hmax(__m128d v) {
+  return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static void agg_sse2(const struct agg_input *in, struct agg_result *out) {
+  // from <= t < to  <=>  (t - from) < (to - from) sem sinal: uma comparação
+  // em vez de duas (o xor com o bit de sinal passa-a para com sinal)
+  const __m128i sign = _mm_set1_epi64x(INT64_MIN);
+  const __m128i from = _mm_set1_epi64x(in->from_ts);
+  const __m128i range = _mm_xor_si128(_mm_set1_epi64x((int64_t) ((uint64_t) in->to_ts - (uint64_t) in->from_ts)), sign);
+  const __m128i ex = _mm_set1_epi32(in->exercise);
+  const __m128d pinf = _mm_set1_pd(INFINITY), ninf = _mm_set1_pd(-INFINITY);
+  const int filter_ex = in->exercise >= 0;
+
+  __m128i cnt = _mm_setzero_si128();
+  __m128d vol = _mm_setzero_pd();
+  __m128d min_w = pinf, max_w = ninf, min_r = pinf, max_r = ninf, max_v = ninf;
+
+  int i = 0;
+  for (; i + 2 <= in->n; i += 2) {
+    __m128i t = _mm_loadu_si128((const __m128i *) (in->ts + i));
+    __m128i d = _mm_xor_si128(_mm_sub_epi64(t, from), sign);
+    __m128i m = sse2_cmpgt_epi64(range, d);
+    if (filter_ex) {
+      __m128i e = _mm_loadl_epi64((const __m128i *) (in->exercise_id + i));
+      __m128i me = _mm_cmpeq_epi32(e, ex);
+      m = _mm_and_si128(m, _mm_unpacklo_epi32(me, me));
+    }
+    int bits = _mm_movemask_epi8(m);
+    if (bits == 0) continue;
+
+    __m128d md = _mm_castsi128_pd(m);
+    __m128d r = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) (in->reps + i)));
+    __m128d w = _mm_loadu_pd(in->weight + i);
+    __m128d v = _mm_mul_pd(r, w);
+
+    cnt = _mm_sub_epi64(cnt, m);                       // m = -1 nos lanes ativos
+    if (bits == 0xFFFF) {
+      // Os 2 lanes contam (o caso comum): sem máscaras nos mínimos / máximos
+      vol = _mm_add_pd(vol, v);
+      min_w = _mm_min_pd(min_w, w);
+      max_w = _mm_max_pd(max_w, w);
+      min_r = _mm_min_pd(min_r, r);
+      max_r = _mm_max_pd(max_r, r);
+      max_v = _mm_max_pd(max_v, v);
+      continue;
+    }
+    vol = _mm_add_pd(vol, _mm_and_pd(md, v));
+    // Lanes inativos: +inf para os mínimos, -inf para os máximos
+    __m128d w_lo = _mm_or_pd(_mm_and_pd(md, w), _mm_andnot_pd(md, pinf));
+    __m128d w_hi = _mm_or_pd(_mm_and_pd(md, w), _mm_andnot_pd(md, ninf));
+    __m128d r_lo = _mm_or_pd(_mm_and_pd(md, r), _mm_andnot_pd(md, pinf));
+    __m128d r_hi = _mm_or_pd(_mm_and_pd(md, r), _mm_andnot_pd(md, ninf));
+    __m128d v_hi = _mm_or_pd(_mm_and_pd(md, v), _mm_andnot_pd(md, ninf));
+    min_w = _mm_min_pd(min_w, w_lo);
+    max_w = _mm_max_pd(max_w, w_hi);
+    min_r = _mm_min_pd(min_r, r_lo);
+    max_r = _mm_max_pd(max_r, r_hi);
+    max_v = _mm_max_pd(max_v, v_hi);
+  }
+
+  long long c[2];
+  _mm_storeu_si128((__m128i *) c, cnt);
+  double vs[2];
+  _mm_storeu_pd(vs, vol);
+
+  agg_merge(out, c[0] + c[1], vs[0] + vs[1],
+            sse2_hmin(min_w), sse2_hmax(max_w), sse2_hmin(min_r), sse2_hmax(max_r),
+            sse2_hmax(max_v), in, i);
+}
+
+// ======================================================
+// AVX2: 4 sets por iteração (compilado só para esta função)
+// ======================================================
+__attribute__((target("avx2")))
+static double avx2_hmin(__m256d v) {
+  __m128d m = _mm_min_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_min_sd(m, _mm_unpackhi_pd(m, m)));
+}
+
+__attribute__((target("avx2")))
+static double avx2_hmax(__m256d v) {
+  __m128d m = _mm_max_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+}
+
+__attribute__((target("avx2")))
+static void agg_avx2(const struct agg_input *in, struct agg_result *out) {
+  const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+  const __m256i from = _mm256_set1_epi64x(in->from_ts);
+  const __m256i range = _mm256_xor_si256(_mm256_set1_epi64x((int64_t) ((uint64_t) in->to_ts - (uint64_t) in->from_ts)), sign);
+  const __m128i ex = _mm_set1_epi32(in->exercise);
+  const __m256d pinf = _mm256_set1_pd(INFINITY), ninf = _mm256_set1_pd(-INFINITY);
+  const int filter_ex = in->exercise >= 0;
+
+  __m256i cnt = _mm256_setzero_si256();
+  __m256d vol = _mm256_setzero_pd();
+  __m256d min_w = pinf, max_w = ninf, min_r = pinf, max_r = ninf, max_v = ninf;
+
+  int i = 0;
+  for (; i + 4 <= in->n; i += 4) {
+    __m256i t = _mm256_loadu_si256((const __m256i *) (in->ts + i));
+    __m256i d = _mm256_xor_si256(_mm256_sub_epi64(t, from), sign);
+    __m256i m = _mm256_cmpgt_epi64(range, d);
+    if (filter_ex) {
+      __m128i e = _mm_loadu_si128((const __m128i *) (in->exercise_id + i));
+      m = _mm256_and_si256(m, _mm256_cvtepi32_epi64(_mm_cmpeq_epi32(e, ex)));
+    }
+    if (_mm256_testz_si256(m, m)) continue;
+
+    __m256d md = _mm256_castsi256_pd(m);
+    __m256d r = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) (in->reps + i)));
+    __m256d w = _mm256_loadu_pd(in->weight + i);
+    __m256d v = _mm256_mul_pd(r, w);
+
+    cnt = _mm256_sub_epi64(cnt, m);
+    vol = _mm256_add_pd(vol, _mm256_and_pd(md, v));
+    min_w = _mm256_min_pd(min_w, _mm256_blendv_pd(pinf, w, md));
+    max_w = _mm256_max_pd(max_w, _mm256_blendv_pd(ninf, w, md));
+    min_r = _mm256_min_pd(min_r, _mm256_blendv_pd(pinf, r, md));
+    max_r = _mm256_max_pd(max_r, _mm256_blendv_pd(ninf, r, md));
+    max_v = _mm256_max_pd(max_v, _mm256_blendv_pd(ninf, v, md));
+  }
+
+  long long c[4];
+  _mm256_storeu_si256((__m256i *) c, cnt);
+  double vs[4];
+  _mm256_storeu_pd(vs, vol);
+
+  agg_merge(out, c[0] + c[1] + c[2] + c[3], (vs[0] + vs[1]) + (vs[2] + vs[3]),
+            avx2_hmin(min_w), avx2_hmax(max_w), avx2_hmin(min_r), avx2_hmax(max_r),
+            avx2_hmax(max_v), in, i);
+}
+#endif
+
+// ======================================================
+// Dispatch
+// ======================================================
+static int impl_supported(int impl) {
+  if (impl == AGG_SCALAR) return 1;
+#ifdef AGG_X86
+  __builtin_cpu_init();
+  if (impl == AGG_SSE2) return __builtin_cpu_supports("sse2");
+  if (impl == AGG_AVX2) return __builtin_cpu_supports("avx2");
+#endif
+  return 0;
+}
+
+const char *agg_impl_name(int impl) {
+  return impl == AGG_AVX2 ? "avx2" : impl == AGG_SSE2 ? "sse2" : "scalar";
+}
+
+void agg_init(void) {
+  if (s_impl >= 0) return;
+
+  s_impl = impl_supported(AGG_AVX2) ? AGG_AVX2 : impl_supported(AGG_SSE2) ? AGG_SSE2 : AGG_SCALAR;
+
+  // GYM_SIMD força uma variante mais baixa (para comparar / despistar)
+  const char *env = getenv("GYM_SIMD");
+  if (env) {
+    for (int i = AGG_SCALAR; i <= AGG_AVX2; i++) {
+      if (strcmp(env, agg_impl_name(i)) == 0 && impl_supported(i)) s_impl = i;
+    }
+  }
+
+  printf("Kernels de agregação: %s\n", agg_impl_name(s_impl));
+}
+
+int agg_impl(void) {
+  agg_init();
+  return s_impl;
+}
+
+int agg_run_impl(int impl, const struct agg_input *in, struct agg_result *out) {
+  if (!impl_supported(impl)) return 0;
+  // Intervalo vazio: os kernels SIMD assumem from_ts <= to_ts
+  if (in->from_ts >= in->to_ts) {
+    memset(out, 0, sizeof(*out));
+    return 1;
+  }
+  switch (impl) {
+#ifdef AGG_X86
+    case AGG_AVX2: agg_avx2(in, out); break;
+    case AGG_SSE2: agg_sse2(in, out); break;
+#endif
+    default: agg_scalar(in, out); break;
+  }
+  return 1;
+}
+
+void agg_run(const struct agg_input *in, struct agg_result *out) {
+  agg_run_impl(agg_impl(), in, out);
+}
@@ -0,0 +1,51 @@
+#ifndef AGG_H
+#define AGG_H
+
+#include <stdint.h>
+
+// Kernels de agregação sobre colunas de sets (usados pelo colstore).
+// Um só passo calcula tudo: contagem, soma de reps*weight e mínimos /
+// máximos de weight, reps e volume, filtrando por intervalo de ts e,
+// opcionalmente, por exercício.
+//
+// Há 3 variantes (escalar, SSE2, AVX2), escolhidas no arranque pelo CPUID
+// (ou por GYM_SIMD=scalar|sse2|avx2). Contagens, mínimos e máximos são
+// exatamente iguais em todas; a soma muda de ordem (2 ou 4 somas parciais)
+// e só é igual dentro de AGG_SUM_TOLERANCE (erro relativo).
+
+#define AGG_SUM_TOLERANCE 1e-12
+
+struct agg_input {
+  int n;
+  const int64_t *ts;
+  const int32_t *exercise_id;
+  const int32_t *reps;
+  const double *weight;
+  int64_t from_ts, to_ts;     // from_ts <= ts < to_ts
+  int exercise;               // < 0 = todos
+};
+
+// Sem sets (count 0): tudo a 0
+struct agg_result {
+  long long count;
+  double volume;              // soma de reps * weight
+  double min_weight, max_weight;
+  int min_reps, max_reps;
+  double max_volume;          // maior reps * weight num set
+};
+
+enum { AGG_SCALAR = 0, AGG_SSE2 = 1, AGG_AVX2 = 2 };
+
+// Escolhe a variante (CPUID + GYM_SIMD). Chamado automaticamente no 1º uso.
+void agg_init(void);
+
+void agg_run(const struct agg_input *in, struct agg_result *out);
+
+// Variante concreta (para o --check-kernels, check.h). Retorna 0 se o CPU não a suporta.
+int agg_run_impl(int impl, const struct agg_input *in, struct agg_result *out);
+
+// Variante em uso / nome ("scalar", "sse2", "avx2")
+int agg_impl(void);
+const char *agg_impl_name(int impl);
+
+#endif
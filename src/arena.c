@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <windows.h>
+
+#include "arena.h"
+#include "mongoose.h"
+#include "db.h"
+#include "worker.h"
+
+// Bloco extra de um pedido que não coube (os dados vêm a seguir, alinhados a 8)
+union arena_extra {
+  union arena_extra *next;
+  long long align;
+  double align_d;
+};
+
+struct arena {
+  char *buf;
+  size_t size, used;
+  size_t total;                   // bytes pedidos desde o reset (com os blocos extra)
+  union arena_extra *extra;
+};
+
+static WORKER_LOCAL struct arena s_arena;
+
+static volatile long s_mg_allocs = 0, s_sqlite_allocs = 0, s_arena_allocs = 0;
+
+// ======================================================
+// Arena
+// ======================================================
+static int block_init(struct arena *a, size_t size) {
+  char *p = (char *) malloc(size);
+  if (!p) return 0;
+  InterlockedIncrement(&s_arena_allocs);
+  free(a->buf);
+  a->buf = p;
+  a->size = size;
+  a->used = 0;
+  return 1;
+}
+
+void *arena_alloc(size_t n) {
+  struct arena *a = &s_arena;
+  n = n ? (n + 7) & ~(size_t) 7 : 8;
+  if (!a->buf && !block_init(a, ARENA_BLOCK)) return NULL;
+
+  a->total += n;
+  if (a->size - a->used >= n) {
+    void *p = a->buf + a->used;
+    a->used += n;
+    return p;
+  }
+
+  // Não coube: bloco extra só para este pedido
+  union arena_extra *e = (union arena_extra *) malloc(sizeof(*e) + n);
+  if (!e) return NULL;
+  InterlockedIncrement(&s_arena_allocs);
+  e->next = a->extra;
+  a->extra = e;
+  return e + 1;
+}
+
+char *arena_strndup(const char *s, size_t n) {
+  char *p = (char *) arena_alloc(n + 1);
+  if (!p) return NULL;
+  if (n > 0) memcpy(p, s, n);
+  p[n] = '\0';
+  return p;
+}
+
+char *arena_vprintf(const char *fmt, va_list *ap) {
+  struct arena *a = &s_arena;
+  if (!a->buf && !block_init(a, ARENA_BLOCK)) return NULL;
+
+  // Formata logo no espaço livre do bloco; se não couber, aloca o tamanho
+  // certo e formata outra vez
+  va_list ap2;
+  va_copy(ap2, *ap);
+  char *p = a->buf + a->used;
+  size_t avail = a->size - a->used;
+  size_t n = mg_vsnprintf(p, avail, fmt, ap);
+  if (n < avail) {
+    arena_alloc(n + 1);           // devolve p: o texto já lá está
+  } else {
+    p = (char *) arena_alloc(n + 1);
+    if (p) mg_vsnprintf(p, n + 1, fmt, &ap2);
+  }
+  va_end(ap2);
+  return p;
+}
+
+char *arena_printf(const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  char *p = arena_vprintf(fmt, &ap);
+  va_end(ap);
+  return p;
+}
+
+void arena_reset(void) {
+  struct arena *a = &s_arena;
+  if (a->extra) {
+    while (a->extra) {
+      union arena_extra *next = a->extra->next;
+      free(a->extra);
+      a->extra = next;
+    }
+    // O próximo pedido deste tamanho já cabe no bloco
+    size_t want = a->size;
+    while (want < a->total && want < ARENA_MAX_BLOCK) want *= 2;
+    if (want > a->size) block_init(a, want);
+  }
+  a->used = 0;
+  a->total = 0;
+}
+
+void arena_thread_free(void) {
+  arena_reset();
+  free(s_arena.buf);
+  memset(&s_arena, 0, sizeof(s_arena));
+}
+
+// ======================================================
+// Contadores
+// ======================================================
+#if MG_ENABLE_CUSTOM_CALLOC
+// O mongoose aloca tudo por aqui (recv/send das ligações, mg_mprintf...)
+void *mg_calloc(size_t count, size_t size) {
+  InterlockedIncrement(&s_mg_allocs);
+  return calloc(count, size);
+}
+
+void mg_free(void *ptr) {
+  free(ptr);
+}
+#endif
+
+// Os métodos default do SQLite com contagem em xMalloc / xRealloc
+static sqlite3_mem_methods s_sqlite_mem;
+
+static void *sqlite_malloc(int n) {
+  InterlockedIncrement(&s_sqlite_allocs);
+  return s_sqlite_mem.xMalloc(n);
+}
+
+static void *sqlite_realloc(void *p, int n) {
+  InterlockedIncrement(&s_sqlite_allocs);
+  return s_sqlite_mem.xRealloc(p, n);
+}
+
+void alloc_stats_init(void) {
+  if (sqlite3_config(SQLITE_CONFIG_GETMALLOC, &s_sqlite_mem) != SQLITE_OK) return;
+  sqlite3_mem_methods m = s_sqlite_mem;
+  m.xMalloc = sqlite_malloc;
+  m.xRealloc = sqlite_realloc;
+  if (sqlite3_config(SQLITE_CONFIG_MALLOC, &m) != SQLITE_OK) {
+    printf("AVISO: sem contagem das alocações do SQLite\n");
+  }
+}
+
+void alloc_stats(struct alloc_stats *st) {
+  st->mg = (unsigned long) s_mg_allocs;
+  st->sqlite = (unsigned long) s_sqlite_allocs;
+  st->arena = (unsigned long) s_arena_allocs;
+  st->mg_counted = MG_ENABLE_CUSTOM_CALLOC;
+}
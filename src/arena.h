@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdarg.h>
+
+// Memória de um pedido (cópia do corpo, strings do JSON, respostas do
+// writer): bump allocator por thread, libertado de uma vez no fim do
+// pedido. Cada thread que corre handlers (workers, leitores e writer do
+// executor) só tem um pedido em curso, por isso a arena é da thread e não
+// da ligação: o router faz arena_reset no fim de cada evento e o executor
+// no fim de cada job.
+//
+// O bloco fica para o pedido seguinte. Um pedido que não cabe recebe blocos
+// extra (malloc) e no reset o bloco passa a ter o tamanho desse pedido (até
+// ARENA_MAX_BLOCK): em regime estável alocar não chega ao heap.
+//
+// Nada da arena pode sobreviver ao pedido: o que segue para outra thread
+// ou para um callback posterior (hashpool, writeq) é copiado.
+
+#define ARENA_BLOCK     (16 * 1024)     // bloco inicial de cada thread
+#define ARENA_MAX_BLOCK (1024 * 1024)   // maior bloco que o reset guarda
+
+// Alinhado a 8. NULL só sem memória.
+void *arena_alloc(size_t n);
+
+// Cópia com '\0' de n bytes
+char *arena_strndup(const char *s, size_t n);
+
+// printf para a arena (formatos do mg_xprintf, incluindo %M)
+char *arena_printf(const char *fmt, ...);
+char *arena_vprintf(const char *fmt, va_list *ap);
+
+// Fim do pedido: tudo o que foi alocado desde o último reset deixa de valer
+void arena_reset(void);
+
+// Fim da thread
+void arena_thread_free(void);
+
+// ------------------ Contadores de alocações no heap ------------------
+// Todas as threads. mg = mg_calloc (buffers do mongoose e jobs do
+// executor): só contado com -DMG_ENABLE_CUSTOM_CALLOC=1 (ver README).
+struct alloc_stats {
+  unsigned long mg;           // mg_calloc
+  unsigned long sqlite;       // malloc/realloc do SQLite
+  unsigned long arena;        // blocos da arena (iniciais, extra e crescimento)
+  int mg_counted;             // 0 = build sem MG_ENABLE_CUSTOM_CALLOC
+};
+
+// Antes de qualquer uso do SQLite (início do main)
+void alloc_stats_init(void);
+void alloc_stats(struct alloc_stats *st);
+
+#endif
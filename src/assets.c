@@ -0,0 +1,419 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "assets.h"
+#include "http.h"
+#include "gzip.h"
+
+#define ASSETS_ROOT      "public"
+#define ASSETS_MAX       64
+#define ASSETS_MAX_PATH  96
+#define ASSETS_HASH_LEN  16       // hex do SHA1 do conteúdo (truncado)
+#define ASSETS_WATCH_MS  1000
+#define ASSETS_MAX_FILE  (1024 * 1024)   // maiores ficam no disco (TransmitFile)
+
+// Diretórios servidos (iguais aos de serve_static): a raiz só com .html
+static const char *ASSET_DIRS[] = { "", "css", "js" };
+#define ASSET_NDIRS ((int) (sizeof(ASSET_DIRS) / sizeof(ASSET_DIRS[0])))
+
+struct asset {
+  char uri[ASSETS_MAX_PATH];      // "/js/api.js"
+  const char *mime;
+  int html;
+  char hash[ASSETS_HASH_LEN + 1];
+  struct mg_str body, gz, br;     // gz/br vazios se não compensam / não existem
+};
+
+static struct asset *s_assets = NULL;
+static int s_count = 0;
+static unsigned long s_sig = 0;       // assinatura (nomes, tamanhos, mtimes) do último load
+static unsigned long s_reloads = 0;
+static int s_watch = 0;
+
+// ======================================================
+// Listagem
+// ======================================================
+struct name_list {
+  const char *dir;
+  char names[ASSETS_MAX][ASSETS_MAX_PATH];   // relativos a public/: "js/api.js"
+  int n;
+};
+
+static int has_suffix(const char *s, const char *suffix) {
+  size_t n = strlen(s), m = strlen(suffix);
+  return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static void list_cb(const char *name, void *ud) {
+  struct name_list *l = (struct name_list *) ud;
+  if (l->n >= ASSETS_MAX || name[0] == '.') return;
+  if (l->dir[0] == '\0' && !has_suffix(name, ".html")) return;
+
+  int n = snprintf(l->names[l->n], ASSETS_MAX_PATH, "%s%s%s",
+                   l->dir, l->dir[0] ? "/" : "", name);
+  if (n > 0 && n < ASSETS_MAX_PATH) l->n++;
+}
+
+// Todos os ficheiros servidos, incluindo as variantes .gz/.br
+static void list_all(struct name_list *l) {
+  l->n = 0;
+  for (int d = 0; d < ASSET_NDIRS; d++) {
+    char path[ASSETS_MAX_PATH];
+    snprintf(path, sizeof(path), "%s%s%s", ASSETS_ROOT, ASSET_DIRS[d][0] ? "/" : "", ASSET_DIRS[d]);
+    l->dir = ASSET_DIRS[d];
+    mg_fs_posix.ls(path, list_cb, l);
+  }
+}
+
+static int stat_file(const char *rel, size_t *size, time_t *mtime) {
+  char path[ASSETS_MAX_PATH + 8];
+  snprintf(path, sizeof(path), "%s/%s", ASSETS_ROOT, rel);
+  *size = 0;
+  *mtime = 0;
+  int flags = mg_fs_posix.st(path, size, mtime);
+  return flags != 0 && !(flags & MG_FS_DIR);
+}
+
+// FNV-1a sobre (nome, tamanho, mtime) de tudo o que está listado
+static unsigned long scan_signature(void) {
+  static struct name_list l;
+  list_all(&l);
+
+  unsigned long h = 2166136261u;
+  for (int i = 0; i < l.n; i++) {
+    size_t size;
+    time_t mtime;
+    stat_file(l.names[i], &size, &mtime);
+    char line[ASSETS_MAX_PATH + 48];
+    int n = snprintf(line, sizeof(line), "%s %lu %lld;", l.names[i],
+                     (unsigned long) size, (long long) mtime);
+    for (int k = 0; k < n && k < (int) sizeof(line); k++) {
+      h ^= (unsigned char) line[k];
+      h *= 16777619u;
+    }
+  }
+  return h;
+}
+
+// ======================================================
+// Carregamento
+// ======================================================
+static const char *mime_for(const char *name, int *compress) {
+  *compress = 1;
+  if (has_suffix(name, ".html")) return "text/html; charset=utf-8";
+  if (has_suffix(name, ".css")) return "text/css; charset=utf-8";
+  if (has_suffix(name, ".js")) return "text/javascript; charset=utf-8";
+  if (has_suffix(name, ".json")) return "application/json";
+  if (has_suffix(name, ".svg")) return "image/svg+xml";
+  *compress = 0;
+  if (has_suffix(name, ".png")) return "image/png";
+  if (has_suffix(name, ".ico")) return "image/x-icon";
+  return "application/octet-stream";
+}
+
+const char *assets_mime_type(const char *path) {
+  int compress;
+  return mime_for(path, &compress);
+}
+
+static void content_hash(struct mg_str body, char *out) {
+  mg_sha1_ctx ctx;
+  unsigned char digest[20];
+  mg_sha1_init(&ctx);
+  mg_sha1_update(&ctx, (const unsigned char *) body.buf, body.len);
+  mg_sha1_final(digest, &ctx);
+  for (int i = 0; i < ASSETS_HASH_LEN / 2; i++) sprintf(out + 2 * i, "%02x", digest[i]);
+  out[ASSETS_HASH_LEN] = '\0';
+}
+
+// Variante pré-comprimida em disco ("<rel>.br" / "<rel>.gz"); ignorada se for
+// mais antiga que o original (ficou para trás numa edição)
+static struct mg_str read_sidecar(const char *rel, const char *ext, time_t src_mtime) {
+  struct mg_str none = { NULL, 0 };
+  char side[ASSETS_MAX_PATH + 4];
+  size_t size;
+  time_t mtime;
+  snprintf(side, sizeof(side), "%s%s", rel, ext);
+  if (!stat_file(side, &size, &mtime) || mtime < src_mtime || size == 0) return none;
+
+  char path[ASSETS_MAX_PATH + 12];
+  snprintf(path, sizeof(path), "%s/%s", ASSETS_ROOT, side);
+  return mg_file_read(&mg_fs_posix, path);
+}
+
+// Nas páginas, "css/x.css" / "js/x.js" (entre aspas) passam a "...?v=<hash>"
+static struct mg_str rewrite_refs(struct mg_str html, const struct asset *list, int n) {
+  size_t cap = html.len + 1;
+  for (int i = 0; i < n; i++) cap += 4 + ASSETS_HASH_LEN;   // pelo menos uma referência cada
+  size_t len = 0;
+  char *out = (char *) malloc(cap);
+  if (!out) return mg_str_n(NULL, 0);
+
+  for (size_t p = 0; p < html.len; p++) {
+    const struct asset *hit = NULL;
+    size_t ref_len = 0;
+    if (html.buf[p] == '"') {
+      for (int i = 0; i < n && !hit; i++) {
+        if (list[i].html) continue;
+        const char *rel = list[i].uri + 1;          // sem a "/" inicial
+        size_t rl = strlen(rel);
+        if (p + 1 + rl < html.len && memcmp(html.buf + p + 1, rel, rl) == 0 &&
+            html.buf[p + 1 + rl] == '"') {
+          hit = &list[i];
+          ref_len = rl;
+        }
+      }
+    }
+
+    size_t need = hit ? 1 + ref_len + 3 + ASSETS_HASH_LEN : 1;
+    if (len + need + 1 > cap) {
+      cap = (cap + need) * 2;
+      char *grown = (char *) realloc(out, cap);
+      if (!grown) {
+        free(out);
+        return mg_str_n(NULL, 0);
+      }
+      out = grown;
+    }
+
+    if (!hit) {
+      out[len++] = html.buf[p];
+      continue;
+    }
+    out[len++] = '"';
+    memcpy(out + len, html.buf + p + 1, ref_len);
+    len += ref_len;
+    len += (size_t) sprintf(out + len, "?v=%s", hit->hash);
+    p += ref_len;   // a aspa final é copiada na iteração seguinte
+  }
+  out[len] = '\0';
+  return mg_str_n(out, len);
+}
+
+static void asset_release(struct asset *a) {
+  free((void *) a->body.buf);
+  free((void *) a->gz.buf);
+  free((void *) a->br.buf);
+  memset(a, 0, sizeof(*a));
+}
+
+static int asset_load(struct asset *a, const char *rel, const struct asset *list, int n) {
+  char path[ASSETS_MAX_PATH + 8];
+  size_t size;
+  time_t mtime;
+  int compress;
+
+  memset(a, 0, sizeof(*a));
+  if (!stat_file(rel, &size, &mtime)) return 0;
+  snprintf(a->uri, sizeof(a->uri), "/%s", rel);
+  a->mime = mime_for(rel, &compress);
+  a->html = has_suffix(rel, ".html");
+
+  snprintf(path, sizeof(path), "%s/%s", ASSETS_ROOT, rel);
+  struct mg_str raw = mg_file_read(&mg_fs_posix, path);
+  if (raw.buf == NULL) return 0;
+
+  // As variantes em disco só valem para o ficheiro tal como está
+  int rewritten = 0;
+  if (a->html) {
+    struct mg_str page = rewrite_refs(raw, list, n);
+    if (page.buf == NULL) {
+      free((void *) raw.buf);
+      return 0;
+    }
+    rewritten = page.len != raw.len || memcmp(page.buf, raw.buf, raw.len) != 0;
+    free((void *) raw.buf);
+    raw = page;
+  }
+  a->body = raw;
+  content_hash(a->body, a->hash);
+  if (!compress) return 1;
+
+  unsigned char *gz = NULL;
+  size_t gz_len = 0;
+  if (gzip_compress(a->body.buf, a->body.len, &gz, &gz_len) && gz_len < a->body.len) {
+    a->gz = mg_str_n((char *) gz, gz_len);
+  } else {
+    free(gz);
+  }
+
+  if (!rewritten) {
+    struct mg_str side = read_sidecar(rel, ".gz", mtime);
+    if (side.buf && side.len < (a->gz.buf ? a->gz.len : a->body.len)) {
+      free((void *) a->gz.buf);
+      a->gz = side;
+    } else {
+      free((void *) side.buf);
+    }
+
+    side = read_sidecar(rel, ".br", mtime);
+    if (side.buf && side.len < a->body.len) a->br = side;
+    else free((void *) side.buf);
+  }
+  return 1;
+}
+
+// Carrega tudo para uma tabela nova; só substitui a atual se correu bem
+static int assets_load(void) {
+  static struct name_list l;
+  list_all(&l);
+
+  struct asset *list = (struct asset *) calloc(ASSETS_MAX, sizeof(struct asset));
+  if (!list) return 0;
+
+  // css/js primeiro: as páginas precisam dos hashes deles
+  int n = 0, ok = 1;
+  for (int pass = 0; pass < 2 && ok; pass++) {
+    for (int i = 0; i < l.n && ok; i++) {
+      const char *rel = l.names[i];
+      if (has_suffix(rel, ".gz") || has_suffix(rel, ".br")) continue;
+      if (has_suffix(rel, ".html") != (pass == 1)) continue;
+      size_t size;
+      time_t mtime;
+      if (!stat_file(rel, &size, &mtime) || size > ASSETS_MAX_FILE) continue;
+      if (!asset_load(&list[n], rel, list, n)) {
+        printf("Erro ao carregar asset %s/%s\n", ASSETS_ROOT, rel);
+        ok = 0;
+        break;
+      }
+      n++;
+    }
+  }
+
+  if (!ok || n == 0) {
+    for (int i = 0; i < n; i++) asset_release(&list[i]);
+    free(list);
+    return 0;
+  }
+
+  assets_free();
+  s_assets = list;
+  s_count = n;
+  s_sig = scan_signature();
+  return 1;
+}
+
+static void watch_fn(void *arg) {
+  (void) arg;
+  if (scan_signature() == s_sig) return;
+  if (assets_load()) {
+    s_reloads++;
+    printf("Assets recarregados (%d ficheiros)\n", s_count);
+  }
+}
+
+int assets_init(int watch) {
+  s_watch = watch;
+  if (!assets_load()) {
+    printf("AVISO: assets não carregados, servidos do disco\n");
+    return 0;
+  }
+
+  struct assets_stats st;
+  assets_stats(&st);
+  printf("Assets em memória: %lu ficheiros, %lu KB (gzip %lu KB, br %lu KB)%s\n",
+         st.files, (unsigned long) (st.bytes / 1024), (unsigned long) (st.gzip_bytes / 1024),
+         (unsigned long) (st.br_bytes / 1024), watch ? ", a vigiar alterações" : "");
+
+  return 1;
+}
+
+void assets_watch(struct mg_mgr *mgr) {
+  if (s_watch && s_count > 0) mg_timer_add(mgr, ASSETS_WATCH_MS, MG_TIMER_REPEAT, watch_fn, NULL);
+}
+
+void assets_free(void) {
+  for (int i = 0; i < s_count; i++) asset_release(&s_assets[i]);
+  free(s_assets);
+  s_assets = NULL;
+  s_count = 0;
+}
+
+// ======================================================
+// Servir
+// ======================================================
+// q=0 recusa explicitamente a codificação
+static int accepts_encoding(struct mg_http_message *hm, const char *enc) {
+  struct mg_str *ae = mg_http_get_header(hm, "Accept-Encoding");
+  if (!ae) return 0;
+
+  struct mg_str rest = *ae, item;
+  while (mg_span(rest, &item, &rest, ',')) {
+    struct mg_str name, params;
+    mg_span(item, &name, &params, ';');
+    while (name.len && name.buf[0] == ' ') name.buf++, name.len--;
+    while (name.len && name.buf[name.len - 1] == ' ') name.len--;
+    if (mg_strcasecmp(name, mg_str(enc)) != 0) continue;
+
+    const char *q = NULL;
+    for (size_t i = 0; i + 1 < params.len; i++) {
+      if (params.buf[i] == 'q' && params.buf[i + 1] == '=') {
+        q = params.buf + i + 2;
+        break;
+      }
+    }
+    return q == NULL || atof(q) > 0;
+  }
+  return 0;
+}
+
+static const struct asset *find_asset(struct mg_str uri) {
+  if (mg_match(uri, mg_str("/"), NULL)) uri = mg_str("/index.html");
+  for (int i = 0; i < s_count; i++) {
+    if (mg_strcmp(uri, mg_str(s_assets[i].uri)) == 0) return &s_assets[i];
+  }
+  return NULL;
+}
+
+int assets_serve(struct mg_connection *c, struct mg_http_message *hm) {
+  const struct asset *a = find_asset(hm->uri);
+  if (!a) return 0;
+
+  struct mg_str body = a->body;
+  const char *encoding = NULL;
+  if (a->br.buf && accepts_encoding(hm, "br")) {
+    body = a->br;
+    encoding = "br";
+  } else if (a->gz.buf && accepts_encoding(hm, "gzip")) {
+    body = a->gz;
+    encoding = "gzip";
+  }
+
+  char etag[ASSETS_HASH_LEN + 8];
+  snprintf(etag, sizeof(etag), "\"%s%s%s\"", a->hash,
+           encoding ? "-" : "", encoding ? (encoding[0] == 'b' ? "br" : "gz") : "");
+
+  // Só o URL versionado (o que as páginas usam) é imutável
+  char v[ASSETS_HASH_LEN + 1];
+  int versioned = !a->html && mg_http_get_var(&hm->query, "v", v, sizeof(v)) > 0 &&
+                  strcmp(v, a->hash) == 0;
+  const char *cache_control = versioned ? "public, max-age=31536000, immutable" : "no-cache";
+
+  if (etag_matches(hm, etag)) {
+    mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: %s\r\n"
+                 "Vary: Accept-Encoding\r\n\r\n", etag, cache_control);
+    c->is_resp = 0;
+    return 1;
+  }
+
+  mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\n%s%s%sContent-Length: %lu\r\n"
+               "ETag: %s\r\nCache-Control: %s\r\nVary: Accept-Encoding\r\n\r\n",
+            a->mime, encoding ? "Content-Encoding: " : "", encoding ? encoding : "",
+            encoding ? "\r\n" : "", (unsigned long) body.len, etag, cache_control);
+  mg_send(c, body.buf, body.len);
+  c->is_resp = 0;
+  return 1;
+}
+
+void assets_stats(struct assets_stats *st) {
+  memset(st, 0, sizeof(*st));
+  st->files = (unsigned long) s_count;
+  st->reloads = s_reloads;
+  for (int i = 0; i < s_count; i++) {
+    st->bytes += s_assets[i].body.len;
+    st->gzip_bytes += s_assets[i].gz.len;
+    st->br_bytes += s_assets[i].br.len;
+  }
+}
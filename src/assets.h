@@ -0,0 +1,43 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "mongoose.h"
+
+// Frontend (public/) servido da memória. No arranque cada ficheiro até 1 MB
+// (os maiores continuam a ir do disco) é lido uma vez, comprimido em gzip e,
+// se existir ao lado um "<ficheiro>.br" (ou um ".gz" melhor, p.ex. de
+// zopfli), essa variante pré-comprimida também fica carregada. A codificação escolhe-se pelo Accept-Encoding (br > gzip
+// > identity) e o pedido é respondido só com memcpy para o send buffer.
+//
+// ETag = hash do conteúdo (com sufixo por codificação). As páginas HTML
+// referem os css/js com "?v=<hash>": esses URLs têm cache de um ano
+// (immutable) e as páginas usam no-cache, por isso um deploy novo chega ao
+// browser no próximo carregamento sem mudar nomes de ficheiros.
+//
+// watch = 1 (GYM_ASSETS_WATCH=1, para desenvolvimento): um timer verifica
+// tamanhos/mtimes a cada segundo e recarrega tudo se algo mudou.
+// Depois do init a tabela só é lida, e pode ser partilhada pelos workers;
+// a recarga troca-a sem lock, por isso o watch só existe com um worker.
+
+// Retorna 1 se carregou, 0 se falhou (aí os pedidos vão ao disco)
+int assets_init(int watch);
+void assets_free(void);
+
+// Liga o timer do watch (se pedido no init) ao event loop de mgr
+void assets_watch(struct mg_mgr *mgr);
+
+// GET de um asset carregado: responde (200 ou 304) e retorna 1; senão 0
+int assets_serve(struct mg_connection *c, struct mg_http_message *hm);
+
+// Content-Type pela extensão (também para o que é servido do disco)
+const char *assets_mime_type(const char *path);
+
+// Contadores (para /health)
+struct assets_stats {
+  unsigned long files;
+  size_t bytes, gzip_bytes, br_bytes;
+  unsigned long reloads;
+};
+void assets_stats(struct assets_stats *st);
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <WinSock2.h>
 #include <windows.h>
@@ -9,59 +10,15 @@
 
 #include "auth.h"
 #include "db.h"
+#include "stmtcache.h"
+#include "queries.h"
 #include "json.h"
 #include "password.h"
-
-// ======================================================
-// JSON helpers (strings)
-// ======================================================
-static int json_get_string_field(const char *json,
-                                 const char *field_name,
-                                 char *out, size_t out_size) {
-  char key[64];
-  if (snprintf(key, sizeof(key), "\"%s\"", field_name) <= 0) return 0;
-
-  const char *p = strstr(json, key);
-  if (!p) return 0;
-
-  p += strlen(key);
-  while (*p && *p != ':') p++;
-  if (*p != ':') return 0;
-  p++;
-
-  while (*p == ' ' || *p == '\t') p++;
-  if (*p != '"') return 0;
-  p++;
-
-  size_t o = 0;
-  while (*p && o < out_size - 1) {
-    if (*p == '"') { out[o] = '\0'; return 1; }
-
-    if (*p == '\\') {
-      p++;
-      if (!*p) return 0;
-
-      char ch;
-      switch (*p) {
-        case '"':  ch = '"';  break;
-        case '\\': ch = '\\'; break;
-        case 'n':  ch = '\n'; break;
-        case 'r':  ch = '\r'; break;
-        case 't':  ch = '\t'; break;
-        case 'b':  ch = '\b'; break;
-        case 'f':  ch = '\f'; break;
-        default: return 0;
-      }
-
-      out[o++] = ch;
-      p++;
-    } else {
-      out[o++] = *p++;
-    }
-  }
-
-  return 0;
-}
+#include "hashpool.h"
+#include "sesscache.h"
+#include "arena.h"
+#include "dbexec.h"
+#include "writeq.h"
 
 // ======================================================
 // Token generator (32 bytes -> 64 hex chars)
@@ -108,9 +65,10 @@ static int get_bearer_token(struct mg_http_message *hm, char *out, size_t out_si
 }
 
 // ======================================================
-// Middleware: exige sessão válida e devolve user_id
+// Middleware: exige sessão válida e devolve user_id + role
+// (uma só query: sessions JOIN users)
 // ======================================================
-int auth_require_user(struct mg_connection *c, struct mg_http_message *hm, int *out_user_id) {
+int auth_require_user(struct mg_connection *c, struct mg_http_message *hm, struct request_ctx *ctx) {
   char token[128];
   if (!get_bearer_token(hm, token, sizeof(token))) {
     mg_http_reply(c, 401, "Content-Type: application/json\r\n",
@@ -118,14 +76,18 @@ int auth_require_user(struct mg_connection *c, struct mg_http_message *hm, int *
     return 0;
   }
 
-  const char *sql =
-    "SELECT user_id "
-    "FROM sessions "
-    "WHERE token = ? AND (expires_at IS NULL OR expires_at > CURRENT_TIMESTAMP) "
-    "LIMIT 1;";
+  // Token validado recentemente: sem ida à BD
+  if (sesscache_lookup(token, ctx)) return 1;
+
+  // Falha da cache: o SELECT corre aqui, no event loop, com a ligação do worker
+  // (não passa pelo executor: a rota só corre depois de o middleware decidir).
+  // É uma procura pelo índice UNIQUE do token e o put seguinte poupa a ida à BD aos pedidos seguintes.
+
+  // Antes do SELECT: um logout que acabe entretanto impede o put
+  unsigned long gen = sesscache_gen();
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(SQL_SESSION_LOOKUP, &stmt);
   if (rc != SQLITE_OK || !stmt) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
@@ -136,157 +98,327 @@ int auth_require_user(struct mg_connection *c, struct mg_http_message *hm, int *
   rc = sqlite3_step(stmt);
 
   if (rc != SQLITE_ROW) {
-    sqlite3_finalize(stmt);
+    stmtcache_release(stmt);
     mg_http_reply(c, 401, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid or expired session\" }\n");
     return 0;
   }
 
   int user_id = sqlite3_column_int(stmt, 0);
-  sqlite3_finalize(stmt);
+  const unsigned char *role_u = sqlite3_column_text(stmt, 1);
+
+  const char *role = role_u ? (const char *) role_u : "";
+
+  if (ctx) {
+    ctx->user_id = user_id;
+    snprintf(ctx->role, sizeof(ctx->role), "%s", role);
+  }
+  sesscache_put(token, user_id, role, sqlite3_column_int64(stmt, 2), gen);
+  stmtcache_release(stmt);
 
-  if (out_user_id) *out_user_id = user_id;
   return 1;
 }
 
 // ======================================================
-// POST /login
-// Body: { "email":"...", "password":"..." }
-// Resposta: { "token":"...", "user": {...} }
+// Middleware: exige sessão + admin
 // ======================================================
-void handle_post_login(struct mg_connection *c, struct mg_http_message *hm) {
-  if (hm->body.len == 0 || hm->body.len > 1024) {
-    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"invalid body\" }\n");
+int auth_require_admin(struct mg_connection *c, struct mg_http_message *hm, struct request_ctx *ctx) {
+  struct request_ctx local;
+  if (!ctx) ctx = &local;
+
+  if (!auth_require_user(c, hm, ctx)) return 0;
+
+  if (strcmp(ctx->role, "admin") != 0) {
+    mg_http_reply(c, 403, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"admin only\" }\n");
+    return 0;
+  }
+
+  return 1;
+}
+
+// ======================================================
+// Cria sessão (7 dias) e responde com { "token", "user" }
+// Corre no writer (writeq): o signup cria também o user, o login com
+// password antiga em texto simples grava o novo hash
+// ======================================================
+struct session_user {
+  int id;                       // 0 = signup: o user é criado no job
+  char email[256], role[32], name[128], surname[128];
+};
+
+struct session_job {
+  struct session_user user;
+  int status;                   // 200 (login) / 201 (signup)
+  char token[65];
+  char hash[512];               // signup: hash da password; login: novo hash ("" = manter)
+};
+
+static void run_session(const void *arg, struct writeq_result *res) {
+  const struct session_job *job = (const struct session_job *) arg;
+  int user_id = job->user.id;
+  sqlite3_stmt *stmt = NULL;
+  int rc;
+
+  if (user_id == 0) {
+    const char *sql_user =
+      "INSERT INTO users (email, password_hash, name, surname, role) "
+      "VALUES (?, ?, ?, ?, 'client');";
+
+    rc = stmtcache_prepare(sql_user, &stmt);
+    if (rc != SQLITE_OK || !stmt) {
+      writeq_reply(res, 500, "{ \"error\": \"db prepare failed\" }\n");
+      return;
+    }
+
+    sqlite3_bind_text(stmt, 1, job->user.email, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, job->hash, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, job->user.name, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, job->user.surname, -1, SQLITE_TRANSIENT);
+
+    rc = sqlite3_step(stmt);
+    stmtcache_release(stmt);
+
+    if (db_is_busy(rc)) {
+      writeq_reply(res, 503, "{ \"error\": \"server busy, try again\" }\n");
+      return;
+    }
+    if ((rc & 0xFF) == SQLITE_CONSTRAINT) {
+      writeq_reply(res, 400, "{ \"error\": \"signup failed (email already exists?)\" }\n");
+      return;
+    }
+    if (rc != SQLITE_DONE) {
+      writeq_reply(res, 500, "{ \"error\": \"signup failed\" }\n");
+      return;
+    }
+
+    user_id = (int) sqlite3_last_insert_rowid(db);
+  } else if (job->hash[0]) {
+    // Se o UPDATE falhar, o upgrade fica para o próximo login
+    const char *usql = "UPDATE users SET password_hash = ? WHERE id = ?;";
+    if (stmtcache_prepare(usql, &stmt) == SQLITE_OK && stmt) {
+      sqlite3_bind_text(stmt, 1, job->hash, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int(stmt, 2, user_id);
+      sqlite3_step(stmt);
+      stmtcache_release(stmt);
+    }
+  }
+
+  const char *ins =
+    "INSERT INTO sessions (user_id, token, expires_at) "
+    "VALUES (?, ?, datetime('now', '+7 days'));";
+
+  rc = stmtcache_prepare(ins, &stmt);
+  if (rc != SQLITE_OK || !stmt) {
+    writeq_reply(res, 500, "{ \"error\": \"db prepare failed\" }\n");
     return;
   }
 
-  char body[1025];
-  memcpy(body, hm->body.buf, hm->body.len);
-  body[hm->body.len] = '\0';
+  sqlite3_bind_int(stmt, 1, user_id);
+  sqlite3_bind_text(stmt, 2, job->token, -1, SQLITE_TRANSIENT);
 
-  char email[256], password[256];
-  if (!json_get_string_field(body, "email", email, sizeof(email)) ||
-      !json_get_string_field(body, "password", password, sizeof(password))) {
-    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"missing email/password\" }\n");
+  rc = sqlite3_step(stmt);
+  stmtcache_release(stmt);
+
+  if (db_is_busy(rc)) {
+    writeq_reply(res, 503, "{ \"error\": \"server busy, try again\" }\n");
+    return;
+  }
+  if (rc != SQLITE_DONE) {
+    writeq_reply(res, 500, "{ \"error\": \"session insert failed\" }\n");
     return;
   }
 
+  // Token novo: nenhum logout o pode ter revogado
+  sesscache_put(job->token, user_id, job->user.role, (long long) time(NULL) + 7 * 24 * 3600,
+                sesscache_gen());
+
+  writeq_reply(res, job->status,
+    "{ \"token\": \"%s\", \"user\": { \"id\": %d, \"email\": %M, \"role\": %M, \"name\": %M, \"surname\": %M } }\n",
+    job->token, user_id, json_esc, job->user.email, json_esc, job->user.role,
+    json_esc, job->user.name, json_esc, job->user.surname);
+}
+
+static void reply_busy(struct mg_connection *c) {
+  mg_http_reply(c, 503, "Content-Type: application/json\r\n",
+                "{ \"error\": \"server busy, try again\" }\n");
+}
+
+// Continuação do hashpool (thread do event loop): gera o token e submete ao writer
+static void submit_session(struct mg_connection *c, int status,
+                           const struct session_user *user, const char *hash) {
+  struct session_job job;
+  memset(&job, 0, sizeof(job));
+  job.user = *user;
+  job.status = status;
+  snprintf(job.hash, sizeof(job.hash), "%s", hash);
+
+  if (!gen_token_hex(job.token, sizeof(job.token))) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"token generation failed\" }\n");
+    return;
+  }
+
+  // Sem o pedido original: como as outras respostas do hashpool, não honra o "Connection: close"
+  if (!writeq_submit(c, NULL, run_session, &job, sizeof(job))) reply_busy(c);
+}
+
+// ======================================================
+// POST /login
+// Body: { "email":"...", "password":"..." }
+// Resposta: { "token":"...", "user": {...} }
+// SELECT num leitor (dbexec_call), PBKDF2 no hashpool, sessão no writer
+// ======================================================
+struct login_lookup {
+  struct session_user user;     // email na entrada, o resto vem da BD
+  char password[256];
+  char stored[512];
+};
+
+static int login_lookup(void *arg) {
+  struct login_lookup *lk = (struct login_lookup *) arg;
+
   const char *sql =
     "SELECT id, password_hash, role, name, surname "
     "FROM users WHERE email = ? LIMIT 1;";
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-  if (rc != SQLITE_OK || !stmt) {
-    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"db prepare failed\" }\n");
-    return;
-  }
+  int rc = stmtcache_prepare(sql, &stmt);
+  if (rc != SQLITE_OK || !stmt) return 500;
 
-  sqlite3_bind_text(stmt, 1, email, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 1, lk->user.email, -1, SQLITE_TRANSIENT);
   rc = sqlite3_step(stmt);
 
   if (rc != SQLITE_ROW) {
-    sqlite3_finalize(stmt);
-    mg_http_reply(c, 401, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"invalid credentials\" }\n");
-    return;
+    stmtcache_release(stmt);
+    if (db_is_busy(rc)) return 503;
+    return rc == SQLITE_DONE ? 401 : 500;
   }
 
-  // --- LER E COPIAR ANTES DO finalize() ---
-  int user_id = sqlite3_column_int(stmt, 0);
+  // --- LER E COPIAR ANTES DO release() ---
+  lk->user.id = sqlite3_column_int(stmt, 0);
 
   const unsigned char *hash_u    = sqlite3_column_text(stmt, 1);
   const unsigned char *role_u    = sqlite3_column_text(stmt, 2);
   const unsigned char *name_u    = sqlite3_column_text(stmt, 3);
   const unsigned char *surname_u = sqlite3_column_text(stmt, 4);
 
-  char stored[512], role[32], name[128], surname[128];
-  snprintf(stored, sizeof(stored), "%s", hash_u ? (const char *) hash_u : "");
-  snprintf(role,   sizeof(role),   "%s", role_u ? (const char *) role_u : "");
-  snprintf(name,   sizeof(name),   "%s", name_u ? (const char *) name_u : "");
-  snprintf(surname,sizeof(surname),"%s", surname_u ? (const char *) surname_u : "");
+  snprintf(lk->stored,       sizeof(lk->stored),       "%s", hash_u ? (const char *) hash_u : "");
+  snprintf(lk->user.role,    sizeof(lk->user.role),    "%s", role_u ? (const char *) role_u : "");
+  snprintf(lk->user.name,    sizeof(lk->user.name),    "%s", name_u ? (const char *) name_u : "");
+  snprintf(lk->user.surname, sizeof(lk->user.surname), "%s", surname_u ? (const char *) surname_u : "");
 
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
+  return 200;
+}
 
-  // Verificar password (PBKDF2) 
-  int ok = 0;
+static void login_verified(struct mg_connection *c, int ok, const char *hash, void *arg) {
+  struct session_user *user = (struct session_user *) arg;
+  (void) hash;
 
-  if (pwd_is_pbkdf2(stored)) {
-    ok = pwd_verify(password, stored);
+  if (!ok) {
+    mg_http_reply(c, 401, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"invalid credentials\" }\n");
   } else {
-    ok = (strcmp(stored, password) == 0);
-
-    // Upgrade no 1º login bem sucedido
-    if (ok) {
-      char new_hash[256];
-      if (pwd_hash(password, new_hash, sizeof(new_hash))) {
-        sqlite3_stmt *up = NULL;
-        const char *usql = "UPDATE users SET password_hash = ? WHERE id = ?;";
-        if (sqlite3_prepare_v2(db, usql, -1, &up, NULL) == SQLITE_OK && up) {
-          sqlite3_bind_text(up, 1, new_hash, -1, SQLITE_TRANSIENT);
-          sqlite3_bind_int(up, 2, user_id);
-          sqlite3_step(up);
-          sqlite3_finalize(up);
-        }
-      }
-    }
+    submit_session(c, 200, user, "");
   }
+  free(user);
+}
 
-  if (!ok) {
+// Password antiga em texto simples: já validada, o novo hash é gravado com a sessão
+static void login_rehashed(struct mg_connection *c, int ok, const char *hash, void *arg) {
+  struct session_user *user = (struct session_user *) arg;
+  submit_session(c, 200, user, ok ? hash : "");
+  free(user);
+}
+
+static void login_check(struct mg_connection *c, int status, const struct login_lookup *lk) {
+  if (status == 401) {
     mg_http_reply(c, 401, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid credentials\" }\n");
     return;
   }
+  if (status == 503) {
+    reply_busy(c);
+    return;
+  }
+  if (status != 200) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"db query failed\" }\n");
+    return;
+  }
 
-  // Criar sessão (7 dias)
-  char token[65];
-  if (!gen_token_hex(token, sizeof(token))) {
+  struct session_user *user = (struct session_user *) malloc(sizeof(*user));
+  if (!user) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"token generation failed\" }\n");
+                  "{ \"error\": \"out of memory\" }\n");
     return;
   }
+  *user = lk->user;
 
-  const char *ins =
-    "INSERT INTO sessions (user_id, token, expires_at) "
-    "VALUES (?, ?, datetime('now', '+7 days'));";
+  // Verificar password (PBKDF2) no hashpool
+  if (pwd_is_pbkdf2(lk->stored)) {
+    if (!hashpool_submit_verify(c, lk->password, lk->stored, login_verified, user)) {
+      free(user);
+      reply_busy(c);
+    }
+    return;
+  }
 
-  rc = sqlite3_prepare_v2(db, ins, -1, &stmt, NULL);
-  if (rc != SQLITE_OK || !stmt) {
-    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"db prepare failed\" }\n");
+  if (strcmp(lk->stored, lk->password) != 0) {
+    free(user);
+    mg_http_reply(c, 401, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"invalid credentials\" }\n");
     return;
   }
 
-  sqlite3_bind_int(stmt, 1, user_id);
-  sqlite3_bind_text(stmt, 2, token, -1, SQLITE_TRANSIENT);
+  // Upgrade no 1º login bem sucedido (se o pool estiver cheio, fica para o próximo)
+  if (!hashpool_submit_hash(c, lk->password, login_rehashed, user)) {
+    login_rehashed(c, 0, "", user);
+  }
+}
 
-  rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+// A password e o hash vão na cópia do job, que volta ao pool com os bytes:
+// apagar em todos os caminhos (o hashpool já tem a sua cópia, e apaga-a)
+static void login_found(struct mg_connection *c, int status, void *arg) {
+  struct login_lookup *lk = (struct login_lookup *) arg;
+  login_check(c, status, lk);
+  memset(lk->password, 0, sizeof(lk->password));
+  memset(lk->stored, 0, sizeof(lk->stored));
+}
 
-  if (rc != SQLITE_DONE) {
-    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"session insert failed\" }\n");
+void handle_post_login(struct mg_connection *c, struct mg_http_message *hm,
+                       const struct request_ctx *rq) {
+  (void) rq;
+  if (hm->body.len == 0 || hm->body.len > 1024) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"invalid body\" }\n");
+    return;
+  }
+
+  char *email = json_get_str(hm->body, "email", 255);
+  char *password = json_get_str(hm->body, "password", 255);
+  if (!email || !password) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"missing email/password\" }\n");
     return;
   }
 
-  char esc_email[512], esc_role[64], esc_name[256], esc_surname[256];
-  json_escape(email, esc_email, sizeof(esc_email));
-  json_escape(role,  esc_role, sizeof(esc_role));
-  json_escape(name,  esc_name, sizeof(esc_name));
-  json_escape(surname, esc_surname, sizeof(esc_surname));
+  struct login_lookup lk;
+  memset(&lk, 0, sizeof(lk));
+  snprintf(lk.user.email, sizeof(lk.user.email), "%s", email);
+  snprintf(lk.password,   sizeof(lk.password),   "%s", password);
 
-  mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-    "{ \"token\": \"%s\", \"user\": { \"id\": %d, \"email\": \"%s\", \"role\": \"%s\", \"name\": \"%s\", \"surname\": \"%s\" } }\n",
-    token, user_id, esc_email, esc_role, esc_name, esc_surname);
+  if (!dbexec_call(c, hm, login_lookup, login_found, &lk, sizeof(lk))) reply_busy(c);
+  memset(lk.password, 0, sizeof(lk.password));
 }
 
 // ======================================================
-// POST /logout
+// POST /logout (ROUTE_WRITE: corre no writer)
 // ======================================================
-void handle_post_logout(struct mg_connection *c, struct mg_http_message *hm) {
+void handle_post_logout(struct mg_connection *c, struct mg_http_message *hm,
+                        const struct request_ctx *rq) {
+  (void) rq;
   char token[128];
   if (!get_bearer_token(hm, token, sizeof(token))) {
     mg_http_reply(c, 401, "Content-Type: application/json\r\n",
@@ -297,7 +429,7 @@ void handle_post_logout(struct mg_connection *c, struct mg_http_message *hm) {
   const char *sql = "DELETE FROM sessions WHERE token = ?;";
   sqlite3_stmt *stmt = NULL;
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || !stmt) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
@@ -306,14 +438,21 @@ void handle_post_logout(struct mg_connection *c, struct mg_http_message *hm) {
 
   sqlite3_bind_text(stmt, 1, token, -1, SQLITE_TRANSIENT);
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
+  if (db_is_busy(rc)) {
+    reply_busy(c);
+    return;
+  }
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"logout failed\" }\n");
     return;
   }
 
+  // Só sai da cache depois do COMMIT do batch (sesscache_txn_end)
+  sesscache_evict(token);
+
   mg_http_reply(c, 204, "", "");
 }
 
@@ -321,23 +460,34 @@ void handle_post_logout(struct mg_connection *c, struct mg_http_message *hm) {
 // POST /signup (auto-login)
 // Body: { "email":..., "password":..., "name":..., "surname":... }
 // Resposta: { "token":"...", "user": {...} }
+// O hash corre no hashpool; o INSERT do user e da sessão no writer (run_session)
 // ======================================================
-void handle_post_signup(struct mg_connection *c, struct mg_http_message *hm) {
+static void signup_hashed(struct mg_connection *c, int ok, const char *phash, void *arg) {
+  struct session_user *user = (struct session_user *) arg;
+
+  if (!ok) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"hash failed\" }\n");
+  } else {
+    submit_session(c, 201, user, phash);
+  }
+  free(user);
+}
+
+void handle_post_signup(struct mg_connection *c, struct mg_http_message *hm,
+                        const struct request_ctx *rq) {
+  (void) rq;
   if (hm->body.len == 0 || hm->body.len > 2048) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid body\" }\n");
     return;
   }
 
-  char body[2049];
-  memcpy(body, hm->body.buf, hm->body.len);
-  body[hm->body.len] = '\0';
-
-  char email[256], password[256], name[128], surname[128];
-  if (!json_get_string_field(body, "email", email, sizeof(email)) ||
-      !json_get_string_field(body, "password", password, sizeof(password)) ||
-      !json_get_string_field(body, "name", name, sizeof(name)) ||
-      !json_get_string_field(body, "surname", surname, sizeof(surname))) {
+  char *email = json_get_str(hm->body, "email", 255);
+  char *password = json_get_str(hm->body, "password", 255);
+  char *name = json_get_str(hm->body, "name", 127);
+  char *surname = json_get_str(hm->body, "surname", 127);
+  if (!email || !password || !name || !surname) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"missing fields\" }\n");
     return;
@@ -349,98 +499,38 @@ void handle_post_signup(struct mg_connection *c, struct mg_http_message *hm) {
     return;
   }
 
-  // Hash 
-  char phash[256];
-  if (!pwd_hash(password, phash, sizeof(phash))) {
+  struct session_user *user = (struct session_user *) calloc(1, sizeof(*user));
+  if (!user) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"hash failed\" }\n");
+                  "{ \"error\": \"out of memory\" }\n");
     return;
   }
-
-  // 1) Criar user (client)
-  const char *sql_user =
-    "INSERT INTO users (email, password_hash, name, surname, role) "
-    "VALUES (?, ?, ?, ?, 'client');";
-
-  sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql_user, -1, &stmt, NULL);
-  if (rc != SQLITE_OK || !stmt) {
-    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"db prepare failed\" }\n");
-    return;
-  }
-
-  sqlite3_bind_text(stmt, 1, email, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 2, phash, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 3, name, -1, SQLITE_TRANSIENT);
-  sqlite3_bind_text(stmt, 4, surname, -1, SQLITE_TRANSIENT);
-
-  rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
-
-  if (rc != SQLITE_DONE) {
-    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"signup failed (email already exists?)\" }\n");
-    return;
-  }
-
-  int user_id = (int) sqlite3_last_insert_rowid(db);
-
-  // 2) Criar sessão (auto-login)
-  char token[65];
-  if (!gen_token_hex(token, sizeof(token))) {
-    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"token generation failed\" }\n");
-    return;
-  }
-
-  const char *sql_sess =
-    "INSERT INTO sessions (user_id, token, expires_at) "
-    "VALUES (?, ?, datetime('now', '+7 days'));";
-
-  rc = sqlite3_prepare_v2(db, sql_sess, -1, &stmt, NULL);
-  if (rc != SQLITE_OK || !stmt) {
-    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"db prepare failed\" }\n");
-    return;
-  }
-
-  sqlite3_bind_int(stmt, 1, user_id);
-  sqlite3_bind_text(stmt, 2, token, -1, SQLITE_TRANSIENT);
-
-  rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
-
-  if (rc != SQLITE_DONE) {
-    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"session insert failed\" }\n");
-    return;
+  snprintf(user->email,   sizeof(user->email),   "%s", email);
+  snprintf(user->role,    sizeof(user->role),    "%s", "client");
+  snprintf(user->name,    sizeof(user->name),    "%s", name);
+  snprintf(user->surname, sizeof(user->surname), "%s", surname);
+
+  // Hash
+  if (!hashpool_submit_hash(c, password, signup_hashed, user)) {
+    free(user);
+    reply_busy(c);
   }
-
-  // 3) Resposta
-  char esc_email[512], esc_name[256], esc_surname[256];
-  json_escape(email, esc_email, sizeof(esc_email));
-  json_escape(name, esc_name, sizeof(esc_name));
-  json_escape(surname, esc_surname, sizeof(esc_surname));
-
-  mg_http_reply(c, 201, "Content-Type: application/json\r\n",
-    "{ \"token\": \"%s\", \"user\": { \"id\": %d, \"email\": \"%s\", \"role\": \"client\", \"name\": \"%s\", \"surname\": \"%s\" } }\n",
-    token, user_id, esc_email, esc_name, esc_surname);
 }
 
 // ======================================================
 // GET /me
 // ======================================================
-void handle_get_me(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+void handle_get_me(struct mg_connection *c, struct mg_http_message *hm,
+                   const struct request_ctx *ctx) {
+  (void) hm;
+  int user_id = ctx->user_id;
 
   const char *sql =
     "SELECT id, email, role, name, surname "
     "FROM users WHERE id = ? LIMIT 1;";
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || !stmt) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
@@ -451,32 +541,21 @@ void handle_get_me(struct mg_connection *c, struct mg_http_message *hm) {
   rc = sqlite3_step(stmt);
 
   if (rc != SQLITE_ROW) {
-    sqlite3_finalize(stmt);
+    stmtcache_release(stmt);
     mg_http_reply(c, 404, "Content-Type: application/json\r\n",
                   "{ \"error\": \"not found\" }\n");
     return;
   }
 
-  const unsigned char *email_u   = sqlite3_column_text(stmt, 1);
-  const unsigned char *role_u    = sqlite3_column_text(stmt, 2);
-  const unsigned char *name_u    = sqlite3_column_text(stmt, 3);
-  const unsigned char *surname_u = sqlite3_column_text(stmt, 4);
-
-  char email[256], role[32], name[128], surname[128];
-  snprintf(email, sizeof(email), "%s", email_u ? (const char *) email_u : "");
-  snprintf(role,  sizeof(role),  "%s", role_u ? (const char *) role_u : "");
-  snprintf(name,  sizeof(name),  "%s", name_u ? (const char *) name_u : "");
-  snprintf(surname,sizeof(surname),"%s", surname_u ? (const char *) surname_u : "");
-
-  sqlite3_finalize(stmt);
-
-  char e1[512], r1[64], n1[256], s1[256];
-  json_escape(email, e1, sizeof(e1));
-  json_escape(role,  r1, sizeof(r1));
-  json_escape(name,  n1, sizeof(n1));
-  json_escape(surname, s1, sizeof(s1));
+  // Escapadas diretamente das colunas (válidas até ao release)
+  const char *email   = (const char *) sqlite3_column_text(stmt, 1);
+  const char *role    = (const char *) sqlite3_column_text(stmt, 2);
+  const char *name    = (const char *) sqlite3_column_text(stmt, 3);
+  const char *surname = (const char *) sqlite3_column_text(stmt, 4);
 
   mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-    "{ \"user\": { \"id\": %d, \"email\": \"%s\", \"role\": \"%s\", \"name\": \"%s\", \"surname\": \"%s\" } }\n",
-    user_id, e1, r1, n1, s1);
+    "{ \"user\": { \"id\": %d, \"email\": %M, \"role\": %M, \"name\": %M, \"surname\": %M } }\n",
+    user_id, json_esc, email, json_esc, role, json_esc, name, json_esc, surname);
+
+  stmtcache_release(stmt);
 }
@@ -3,22 +3,36 @@
 
 #include "mongoose.h"
 
+#define REQUEST_MAX_PARAMS 2
+
+// Identidade resolvida uma vez pelo router e passada aos handlers, com os
+// parâmetros numéricos do path (ver router.h)
+struct request_ctx {
+  int user_id;
+  char role[16];   // "admin" | "client"
+  int param[REQUEST_MAX_PARAMS];
+};
+
 // POST /login
-void handle_post_login(struct mg_connection *c, struct mg_http_message *hm);
+void handle_post_login(struct mg_connection *c, struct mg_http_message *hm,
+                       const struct request_ctx *ctx);
 
-// Lê "Authorization: Bearer <token>" e devolve user_id se a sessão for válida
-// Retorna 1 se ok, 0 se falhou (sem reply, o handler deve responder com 401)
-int auth_require_user(struct mg_connection *c, struct mg_http_message *hm, int *out_user_id);
+// Lê "Authorization: Bearer <token>" e preenche ctx (user_id + role) se a sessão for válida
+// Retorna 1 se ok, 0 se falhou (já respondeu com 401/500)
+int auth_require_user(struct mg_connection *c, struct mg_http_message *hm, struct request_ctx *ctx);
 
-// Middleware: exige sessão válida e devolve user_id, só para admins
-int auth_require_admin(struct mg_connection *c, struct mg_http_message *hm, int *out_user_id);
+// Middleware: exige sessão válida e role=admin (403 caso contrário)
+int auth_require_admin(struct mg_connection *c, struct mg_http_message *hm, struct request_ctx *ctx);
 
-void handle_post_logout(struct mg_connection *c, struct mg_http_message *hm);
+void handle_post_logout(struct mg_connection *c, struct mg_http_message *hm,
+                        const struct request_ctx *ctx);
 
 // POST /signup (criar conta client)
-void handle_post_signup(struct mg_connection *c, struct mg_http_message *hm);
+void handle_post_signup(struct mg_connection *c, struct mg_http_message *hm,
+                        const struct request_ctx *ctx);
 
 // GET /me (ver user logado)
-void handle_get_me(struct mg_connection *c, struct mg_http_message *hm);
+void handle_get_me(struct mg_connection *c, struct mg_http_message *hm,
+                   const struct request_ctx *ctx);
 
 #endif
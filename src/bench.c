@@ -0,0 +1,1043 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <WinSock2.h>
+#include <windows.h>
+#include <mswsock.h>
+
+#include "bench.h"
+#include "mongoose.h"
+#include "worker.h"
+#include "arena.h"
+#include "router.h"
+#include "stats.h"
+#include "colstore.h"
+#include "db.h"
+#include "stmtcache.h"
+#include "password.h"
+
+// --bench-workers / --bench-alloc
+#define BENCH_CLIENT_THREADS 4
+#define BENCH_CLIENT_CONNS   16     // por thread de cliente
+#define BENCH_WARMUP_MS      500
+#define BENCH_MEASURE_MS     3000
+#define BENCH_PORT           18000
+#define BENCH_ALLOC_WARMUP   2000
+#define BENCH_ALLOC_REQUESTS 10000
+
+// --bench-router
+#define BENCH_ROUTES_MAX     128
+#define BENCH_PATH_MAX       96
+#define BENCH_ROUTER_ITERS   1000000
+
+// --bench-colstore
+#define BENCH_REPEAT         10
+#define BENCH_HIST_BINS      20     // o default do /stats/histogram
+
+// --bench-sendfile
+#define BENCH_TRANSMIT_MAX   0x7FFFFFFEu   // máximo do TransmitFile por chamada
+#define BENCH_TEMP_SIZE      (64 * 1024 * 1024)
+#define BENCH_TOTAL          (1024LL * 1024 * 1024)
+#define BENCH_MAX_ROUNDS     100000
+
+// --bench-login / --bench-pages
+#define BENCH_LOGIN_CONNS    16     // ligações a fazer login, por omissão
+#define BENCH_LOGIN_EXERCISES 50
+#define BENCH_PASSWORD       "bench-password"
+#define BENCH_SAMPLES_MAX    (1 << 18)
+#define BENCH_PAGES_ROWS     100000
+#define BENCH_PAGES_LIMIT    50
+#define BENCH_PAGES_SAMPLES  2000   // páginas medidas por rota e tamanho (voltas completas)
+
+// ======================================================
+// api.exe --bench-workers: req/s com 1, 2, 4... workers
+// ======================================================
+struct bench_client {
+  char url[64];
+  int conns;                    // 0 = BENCH_CLIENT_CONNS
+  const char *path;
+  const char *token;
+  const char *body;             // POST com este corpo (NULL = GET)
+  uint64_t measure_from, until;
+  unsigned long done, errors;
+  unsigned long target;         // bench-alloc: respostas a esperar
+};
+
+static void bench_send(struct mg_connection *c, struct bench_client *bc) {
+  mg_printf(c, "%s %s HTTP/1.1\r\nHost: localhost\r\n", bc->body ? "POST" : "GET", bc->path);
+  if (bc->token && bc->token[0]) mg_printf(c, "Authorization: Bearer %s\r\n", bc->token);
+  if (bc->body) {
+    mg_printf(c, "Content-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+              (int) strlen(bc->body), bc->body);
+  } else {
+    mg_printf(c, "\r\n");
+  }
+}
+
+static void bench_fn(struct mg_connection *c, int ev, void *ev_data) {
+  struct bench_client *bc = (struct bench_client *) c->fn_data;
+  if (ev == MG_EV_CONNECT) {
+    bench_send(c, bc);
+  } else if (ev == MG_EV_HTTP_MSG) {
+    struct mg_http_message *hm = (struct mg_http_message *) ev_data;
+    uint64_t now = mg_millis();
+    if (now >= bc->measure_from && now < bc->until) {
+      if (mg_http_status(hm) == 200) bc->done++;
+      else bc->errors++;
+    }
+    if (now < bc->until) bench_send(c, bc);
+    else c->is_draining = 1;
+  } else if (ev == MG_EV_ERROR) {
+    bc->errors++;
+  }
+}
+
+static DWORD WINAPI bench_client_main(LPVOID arg) {
+  struct bench_client *bc = (struct bench_client *) arg;
+  struct mg_mgr mgr;
+  mg_mgr_init(&mgr);
+  int conns = bc->conns > 0 ? bc->conns : BENCH_CLIENT_CONNS;
+  for (int i = 0; i < conns; i++) mg_http_connect(&mgr, bc->url, bench_fn, bc);
+  while (mg_millis() < bc->until + 200) mg_mgr_poll(&mgr, 50);
+  mg_mgr_free(&mgr);
+  return 0;
+}
+
+int bench_workers(int max, const char *path) {
+  if (max < 1) max = 1;
+  if (max > WORKERS_MAX) max = WORKERS_MAX;
+
+  // O log DEBUG do mongoose (default) escreve várias linhas por pedido
+  mg_log_set(MG_LL_ERROR);
+
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  const char *token = getenv("GYM_BENCH_TOKEN");
+  char server_url[64];
+  snprintf(server_url, sizeof(server_url), "http://0.0.0.0:%d", BENCH_PORT);
+
+  printf("bench-workers: GET %s, %d ligações keep-alive, %d CPUs\n", path,
+         BENCH_CLIENT_THREADS * BENCH_CLIENT_CONNS, (int) si.dwNumberOfProcessors);
+  printf("  workers       req/s   erros   vs 1 worker\n");
+
+  double base = 0;
+  // 1, 2, 4... e acaba sempre em max
+  for (int n = 1; n <= max; n = (n < max && n * 2 > max) ? max : n * 2) {
+    if (workers_start(n, server_url) != n) {
+      printf("  %7d  falhou ao arrancar\n", n);
+      return 1;
+    }
+
+    struct bench_client clients[BENCH_CLIENT_THREADS];
+    HANDLE threads[BENCH_CLIENT_THREADS];
+    uint64_t start = mg_millis();
+    for (int i = 0; i < BENCH_CLIENT_THREADS; i++) {
+      memset(&clients[i], 0, sizeof(clients[i]));
+      snprintf(clients[i].url, sizeof(clients[i].url), "http://127.0.0.1:%d", BENCH_PORT);
+      clients[i].path = path;
+      clients[i].token = token;
+      clients[i].measure_from = start + BENCH_WARMUP_MS;
+      clients[i].until = start + BENCH_WARMUP_MS + BENCH_MEASURE_MS;
+      threads[i] = CreateThread(NULL, 0, bench_client_main, &clients[i], 0, NULL);
+    }
+
+    unsigned long done = 0, errors = 0;
+    for (int i = 0; i < BENCH_CLIENT_THREADS; i++) {
+      if (!threads[i]) continue;
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+      done += clients[i].done;
+      errors += clients[i].errors;
+    }
+    workers_stop();
+
+    double rps = done * 1000.0 / BENCH_MEASURE_MS;
+    if (n == 1) base = rps;
+    printf("  %7d  %10.0f  %6lu   %.2fx\n", n, rps, errors, base > 0 ? rps / base : 0.0);
+  }
+  return 0;
+}
+
+// ======================================================
+// api.exe --bench-alloc: alocações no heap por pedido
+// ======================================================
+static void alloc_fn(struct mg_connection *c, int ev, void *ev_data) {
+  struct bench_client *bc = (struct bench_client *) c->fn_data;
+  if (ev == MG_EV_HTTP_MSG) {
+    struct mg_http_message *hm = (struct mg_http_message *) ev_data;
+    int status = mg_http_status(hm);
+    if (status >= 200 && status < 300) bc->done++;
+    else bc->errors++;
+    if (bc->done + bc->errors < bc->target) bench_send(c, bc);
+  } else if (ev == MG_EV_ERROR || ev == MG_EV_CLOSE) {
+    bc->target = 0;
+  }
+}
+
+// n pedidos em sequência na mesma ligação; 0 se a ligação caiu
+static int alloc_run(struct mg_mgr *mgr, struct mg_connection *c, struct bench_client *bc,
+                     unsigned long n) {
+  bc->target = bc->done + bc->errors + n;
+  bench_send(c, bc);
+  uint64_t deadline = mg_millis() + 60000;
+  while (bc->target > 0 && bc->done + bc->errors < bc->target && mg_millis() < deadline) {
+    mg_mgr_poll(mgr, 50);
+  }
+  return bc->target > 0 && bc->done + bc->errors >= bc->target;
+}
+
+int bench_alloc(const char *path, int n) {
+  if (n < 1) n = BENCH_ALLOC_REQUESTS;
+  mg_log_set(MG_LL_ERROR);
+
+  char server_url[64];
+  snprintf(server_url, sizeof(server_url), "http://0.0.0.0:%d", BENCH_PORT);
+  if (workers_start(1, server_url) != 1) {
+    printf("bench-alloc: o worker não arrancou\n");
+    return 1;
+  }
+
+  struct bench_client bc;
+  memset(&bc, 0, sizeof(bc));
+  snprintf(bc.url, sizeof(bc.url), "http://127.0.0.1:%d", BENCH_PORT);
+  bc.path = path;
+  bc.token = getenv("GYM_BENCH_TOKEN");
+  bc.body = getenv("GYM_BENCH_BODY");
+
+  printf("bench-alloc: %s %s, %d de aquecimento + %d pedidos numa ligação keep-alive\n",
+         bc.body ? "POST" : "GET", path, BENCH_ALLOC_WARMUP, n);
+
+  // Cliente nesta thread: as alocações dele também contam (e também param)
+  struct mg_mgr mgr;
+  mg_mgr_init(&mgr);
+  struct mg_connection *c = mg_http_connect(&mgr, bc.url, alloc_fn, &bc);
+  struct alloc_stats a0, a1;
+  int ok = c && alloc_run(&mgr, c, &bc, BENCH_ALLOC_WARMUP);
+  unsigned long done0 = bc.done, errors0 = bc.errors;
+  alloc_stats(&a0);
+  ok = ok && alloc_run(&mgr, c, &bc, (unsigned long) n);
+  alloc_stats(&a1);
+  mg_mgr_free(&mgr);
+  workers_stop();
+
+  if (!ok) {
+    printf("bench-alloc: a ligação falhou\n");
+    return 1;
+  }
+
+  unsigned long mg = a1.mg - a0.mg, sq = a1.sqlite - a0.sqlite, ar = a1.arena - a0.arena;
+  printf("  respostas 2xx: %lu, erros: %lu\n", bc.done - done0, bc.errors - errors0);
+  printf("  alocações no heap       total   por pedido\n");
+  if (a1.mg_counted) {
+    printf("    mongoose + executor %8lu   %10.3f\n", mg, (double) mg / n);
+  } else {
+    printf("    mongoose + executor      n/d   (compilar com -DMG_ENABLE_CUSTOM_CALLOC=1)\n");
+  }
+  printf("    arena               %8lu   %10.3f\n", ar, (double) ar / n);
+  printf("    sqlite              %8lu   %10.3f\n", sq, (double) sq / n);
+
+  // O servidor (e o cliente) não chegam ao heap em regime estável
+  return bc.errors - errors0 > 0 || mg + ar > 0;
+}
+
+// ======================================================
+// api.exe --bench-router: trie vs cadeia linear de mg_match (+ sscanf dos ids)
+// ======================================================
+
+// Path de exemplo (":x" -> 12345, "*" -> app.js) e, para a versão linear,
+// o glob do mg_match (":x" -> "*", "*" -> "#") e o formato do sscanf
+static void bench_strings(const char *path, char *uri, char *glob, char *fmt) {
+  size_t u = 0, g = 0, f = 0;
+  for (const char *p = path; *p && u + 8 < BENCH_PATH_MAX; p++) {
+    if (*p == ':' && p[-1] == '/') {
+      while (p[1] && p[1] != '/') p++;
+      memcpy(uri + u, "12345", 5), u += 5;
+      glob[g++] = '*';
+      memcpy(fmt + f, "%d", 2), f += 2;
+    } else if (*p == '*') {
+      memcpy(uri + u, "app.js", 6), u += 6;
+      glob[g++] = '#';
+    } else {
+      uri[u++] = *p;
+      glob[g++] = *p;
+      fmt[f++] = *p;
+    }
+  }
+  uri[u] = glob[g] = fmt[f] = '\0';
+}
+
+static const struct route *linear_match(const struct route *routes, int n,
+                                        struct mg_http_message *hm, char globs[][BENCH_PATH_MAX],
+                                        char fmts[][BENCH_PATH_MAX], int *param) {
+  for (int i = 0; i < n; i++) {
+    const struct route *r = &routes[i];
+    if (mg_strcmp(hm->method, mg_str(router_method_name(r->method))) != 0) continue;
+    if (!mg_match(hm->uri, mg_str(globs[i]), NULL)) continue;
+    // Como os handlers faziam: sscanf sobre o URI
+    param[0] = param[1] = 0;
+    if (strchr(fmts[i], '%')) sscanf(hm->uri.buf, fmts[i], &param[0], &param[1]);
+    return r;
+  }
+  return NULL;
+}
+
+int bench_router(void) {
+  static char uris[BENCH_ROUTES_MAX][BENCH_PATH_MAX];
+  static char globs[BENCH_ROUTES_MAX][BENCH_PATH_MAX];
+  static char fmts[BENCH_ROUTES_MAX][BENCH_PATH_MAX];
+  const struct route *routes = NULL;
+  int n = router_routes(&routes);
+  if (n > BENCH_ROUTES_MAX) n = BENCH_ROUTES_MAX;
+  int bad = 0;
+  double sum_trie = 0, sum_linear = 0;
+  volatile int sink = 0;
+
+  for (int i = 0; i < n; i++) bench_strings(routes[i].path, uris[i], globs[i], fmts[i]);
+
+  printf("bench-router: %d rotas, %d nós, %d iterações por rota\n", n, router_nodes(), BENCH_ROUTER_ITERS);
+  printf("  %-7s %-32s %9s %11s\n", "método", "path", "trie ns", "linear ns");
+
+  for (int i = 0; i < n; i++) {
+    const struct route *r = &routes[i];
+    struct mg_http_message hm;
+    memset(&hm, 0, sizeof(hm));
+    hm.method = mg_str(router_method_name(r->method));
+    hm.uri = mg_str(uris[i]);
+    int param[REQUEST_MAX_PARAMS];
+
+    // Confirma que a trie chega à própria rota, com os ids
+    const struct route *m = router_match(&hm, param);
+    int want = strchr(r->path, ':') ? 12345 : 0;
+    if (m != r || param[0] != want) {
+      printf("  %-7s %-32s NÃO CASA\n", router_method_name(r->method), r->path);
+      bad++;
+      continue;
+    }
+
+    uint64_t t = mg_millis();
+    for (int k = 0; k < BENCH_ROUTER_ITERS; k++) sink += router_match(&hm, param) != NULL;
+    double ns_trie = (double) (mg_millis() - t) * 1e6 / BENCH_ROUTER_ITERS;
+
+    t = mg_millis();
+    for (int k = 0; k < BENCH_ROUTER_ITERS; k++) sink += linear_match(routes, n, &hm, globs, fmts, param) != NULL;
+    double ns_linear = (double) (mg_millis() - t) * 1e6 / BENCH_ROUTER_ITERS;
+
+    printf("  %-7s %-32s %9.1f %11.1f\n", router_method_name(r->method), r->path, ns_trie, ns_linear);
+    sum_trie += ns_trie;
+    sum_linear += ns_linear;
+  }
+
+  if (n > bad) {
+    printf("  média %42.1f %11.1f  (%.1fx)\n", sum_trie / (n - bad), sum_linear / (n - bad),
+           sum_trie > 0 ? sum_linear / sum_trie : 0.0);
+  }
+  (void) sink;
+  return bad;
+}
+
+// ======================================================
+// api.exe --bench-colstore: SQLite vs colstore nos users com mais sets
+// (volume total, máximos por exercício, histograma). Verifica também que
+// os resultados coincidem.
+// ======================================================
+
+static int bench_close(double a, double b) {
+  double d = a > b ? a - b : b - a;
+  double m = (a > b ? a : b) * 1e-9;
+  return d <= (m > 1e-9 ? m : 1e-9);
+}
+
+int bench_colstore(int users) {
+  if (users <= 0) users = 100;
+  if (!colstore_enabled() && !colstore_load()) return 1;
+
+  int *uids = (int *) calloc((size_t) users, sizeof(int));
+  int *exs = (int *) calloc((size_t) users, sizeof(int));
+  int nu = 0, n_ex = 1;
+  sqlite3_stmt *stmt = NULL;
+
+  // Users com mais sets e o exercício mais frequente de cada um (fora do tempo medido)
+  const char *top_sql =
+    "SELECT w.user_id, COUNT(*) FROM workouts w JOIN workout_exercises we ON we.workout_id = w.id "
+    "WHERE w.user_id IS NOT NULL GROUP BY w.user_id ORDER BY 2 DESC LIMIT ?;";
+  if (!uids || !exs || sqlite3_prepare_v2(db, top_sql, -1, &stmt, NULL) != SQLITE_OK) {
+    free(uids);
+    free(exs);
+    return 1;
+  }
+  sqlite3_bind_int(stmt, 1, users);
+  while (sqlite3_step(stmt) == SQLITE_ROW && nu < users) uids[nu++] = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+
+  const char *ex_sql =
+    "SELECT we.exercise_id FROM workouts w JOIN workout_exercises we ON we.workout_id = w.id "
+    "WHERE w.user_id = ? GROUP BY 1 ORDER BY COUNT(*) DESC LIMIT 1;";
+  sqlite3_prepare_v2(db, ex_sql, -1, &stmt, NULL);
+  for (int i = 0; i < nu; i++) {
+    sqlite3_bind_int(stmt, 1, uids[i]);
+    if (sqlite3_step(stmt) == SQLITE_ROW) exs[i] = sqlite3_column_int(stmt, 0);
+    sqlite3_reset(stmt);
+  }
+  sqlite3_finalize(stmt);
+
+  sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(id), 0) + 1 FROM exercises;", -1, &stmt, NULL);
+  if (sqlite3_step(stmt) == SQLITE_ROW) n_ex = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+
+  double *mw = (double *) calloc((size_t) n_ex, sizeof(double));
+  double *mv = (double *) calloc((size_t) n_ex, sizeof(double));
+  int *mr = (int *) calloc((size_t) n_ex, sizeof(int));
+
+  long long sets = 0;
+  for (int i = 0; i < nu; i++) {
+    long long n;
+    colstore_volume(uids[i], INT64_MIN, INT64_MAX, &n);
+    sets += n;
+  }
+  printf("bench-colstore: %d users, %lld sets\n", nu, sets);
+
+  int bad = 0;
+  uint64_t t_sql, t_col;
+
+  // ---- volume total ----
+  const char *vol_sql =
+    "SELECT COALESCE(SUM(we.reps * we.weight), 0), COUNT(*) "
+    "FROM workouts w JOIN workout_exercises we ON we.workout_id = w.id WHERE w.user_id = ?;";
+  double *vol = (double *) calloc((size_t) nu, sizeof(double));
+  t_sql = mg_millis();
+  for (int i = 0; i < nu; i++) {
+    stmtcache_prepare(vol_sql, &stmt);
+    sqlite3_bind_int(stmt, 1, uids[i]);
+    if (sqlite3_step(stmt) == SQLITE_ROW) vol[i] = sqlite3_column_double(stmt, 0);
+    stmtcache_release(stmt);
+  }
+  t_sql = mg_millis() - t_sql;
+  t_col = mg_millis();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int i = 0; i < nu; i++) {
+      double v = colstore_volume(uids[i], INT64_MIN, INT64_MAX, NULL);
+      if (r == 0 && !bench_close(v, vol[i])) bad++;
+    }
+  }
+  t_col = mg_millis() - t_col;
+  printf("  volume:    sqlite %llu ms, colstore %.2f ms\n",
+         (unsigned long long) t_sql, (double) t_col / BENCH_REPEAT);
+  free(vol);
+
+  // ---- máximos por exercício (PRs) ----
+  const char *pr_sql =
+    "SELECT we.exercise_id, MAX(we.weight), MAX(we.reps), MAX(we.reps * we.weight) "
+    "FROM workouts w JOIN workout_exercises we ON we.workout_id = w.id "
+    "WHERE w.user_id = ? GROUP BY we.exercise_id;";
+  t_sql = mg_millis();
+  for (int i = 0; i < nu; i++) {
+    stmtcache_prepare(pr_sql, &stmt);
+    sqlite3_bind_int(stmt, 1, uids[i]);
+    while (sqlite3_step(stmt) == SQLITE_ROW) { }
+    stmtcache_release(stmt);
+  }
+  t_sql = mg_millis() - t_sql;
+  t_col = mg_millis();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int i = 0; i < nu; i++) colstore_max_by_exercise(uids[i], n_ex, mw, mr, mv);
+  }
+  t_col = mg_millis() - t_col;
+  for (int i = 0; i < nu; i++) {
+    colstore_max_by_exercise(uids[i], n_ex, mw, mr, mv);
+    stmtcache_prepare(pr_sql, &stmt);
+    sqlite3_bind_int(stmt, 1, uids[i]);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      int e = sqlite3_column_int(stmt, 0);
+      if (e < 0 || e >= n_ex || mw[e] != sqlite3_column_double(stmt, 1) ||
+          mr[e] != sqlite3_column_int(stmt, 2) || mv[e] != sqlite3_column_double(stmt, 3)) bad++;
+    }
+    stmtcache_release(stmt);
+  }
+  printf("  prs:       sqlite %llu ms, colstore %.2f ms\n",
+         (unsigned long long) t_sql, (double) t_col / BENCH_REPEAT);
+
+  // ---- histograma (exercício mais frequente, weight, 20 bins) ----
+  unsigned ca[BENCH_HIST_BINS], cb[BENCH_HIST_BINS];
+  double lo_a, w_a, lo_b, w_b;
+  t_sql = mg_millis();
+  for (int i = 0; i < nu; i++) {
+    stats_histogram_sql(uids[i], exs[i], COLSTORE_WEIGHT, 0, BENCH_HIST_BINS, &lo_a, &w_a, ca);
+  }
+  t_sql = mg_millis() - t_sql;
+  t_col = mg_millis();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    for (int i = 0; i < nu; i++) {
+      colstore_histogram(uids[i], exs[i], COLSTORE_WEIGHT, 0, BENCH_HIST_BINS, &lo_b, &w_b, cb);
+    }
+  }
+  t_col = mg_millis() - t_col;
+  for (int i = 0; i < nu; i++) {
+    stats_histogram_sql(uids[i], exs[i], COLSTORE_WEIGHT, 0, BENCH_HIST_BINS, &lo_a, &w_a, ca);
+    colstore_histogram(uids[i], exs[i], COLSTORE_WEIGHT, 0, BENCH_HIST_BINS, &lo_b, &w_b, cb);
+    if (lo_a != lo_b || w_a != w_b || memcmp(ca, cb, sizeof(ca)) != 0) bad++;
+  }
+  printf("  histogram: sqlite %llu ms, colstore %.2f ms\n",
+         (unsigned long long) t_sql, (double) t_col / BENCH_REPEAT);
+
+  printf(bad ? "bench-colstore: %d resultado(s) diferentes\n" : "bench-colstore: resultados iguais\n", bad);
+
+  free(uids);
+  free(exs);
+  free(mw);
+  free(mv);
+  free(mr);
+  return bad ? 1 : 0;
+}
+
+// ======================================================
+// api.exe --bench-sendfile: cópias vs TransmitFile (loopback TCP)
+// ======================================================
+struct drain {
+  SOCKET s;
+  uint64_t expect;
+};
+
+static DWORD WINAPI drain_main(LPVOID arg) {
+  struct drain *d = (struct drain *) arg;
+  static char buf[256 * 1024];
+  uint64_t got = 0;
+  while (got < d->expect) {
+    int n = recv(d->s, buf, (int) sizeof(buf), 0);
+    if (n <= 0) break;
+    got += (uint64_t) n;
+  }
+  return 0;
+}
+
+static int loopback_pair(SOCKET *tx, SOCKET *rx) {
+  struct sockaddr_in sa;
+  int len = sizeof(sa);
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  SOCKET ls = socket(AF_INET, SOCK_STREAM, 0);
+  if (ls == INVALID_SOCKET) return 0;
+  if (bind(ls, (struct sockaddr *) &sa, sizeof(sa)) != 0 || listen(ls, 1) != 0 ||
+      getsockname(ls, (struct sockaddr *) &sa, &len) != 0) {
+    closesocket(ls);
+    return 0;
+  }
+  *tx = socket(AF_INET, SOCK_STREAM, 0);
+  if (*tx == INVALID_SOCKET || connect(*tx, (struct sockaddr *) &sa, sizeof(sa)) != 0) {
+    if (*tx != INVALID_SOCKET) closesocket(*tx);
+    closesocket(ls);
+    return 0;
+  }
+  *rx = accept(ls, NULL, NULL);
+  closesocket(ls);
+  if (*rx == INVALID_SOCKET) {
+    closesocket(*tx);
+    return 0;
+  }
+  return 1;
+}
+
+// CPU (user + kernel) da thread atual
+static double thread_cpu_ms(void) {
+  FILETIME created, exited, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) return 0;
+  uint64_t k = ((uint64_t) kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+  uint64_t u = ((uint64_t) user.dwHighDateTime << 32) | user.dwLowDateTime;
+  return (double) (k + u) / 1e4;
+}
+
+// Envia o ficheiro "rounds" vezes; mode 0 = ReadFile + send de MG_IO_SIZE, 1 = TransmitFile
+static int bench_mode(HANDLE file, uint64_t size, int rounds, int mode, double *ms, double *cpu_ms) {
+  SOCKET tx, rx;
+  if (!loopback_pair(&tx, &rx)) return 0;
+
+  struct drain d = { rx, size * (uint64_t) rounds };
+  HANDLE th = CreateThread(NULL, 0, drain_main, &d, 0, NULL);
+  if (!th) {
+    closesocket(tx);
+    closesocket(rx);
+    return 0;
+  }
+
+  static char buf[MG_IO_SIZE];
+  int ok = 1;
+  uint64_t t = mg_millis();
+  double cpu = thread_cpu_ms();
+  for (int r = 0; r < rounds && ok; r++) {
+    LARGE_INTEGER zero;
+    zero.QuadPart = 0;
+    if (!SetFilePointerEx(file, zero, NULL, FILE_BEGIN)) ok = 0;
+    if (mode == 1) {
+      // Síncrono (sem OVERLAPPED): a partir da posição atual do ficheiro
+      if (ok && !TransmitFile(tx, file, (DWORD) size, 0, NULL, NULL, 0)) ok = 0;
+      continue;
+    }
+    for (uint64_t off = 0; off < size && ok;) {
+      DWORD n = 0;
+      if (!ReadFile(file, buf, sizeof(buf), &n, NULL) || n == 0) {
+        ok = 0;
+        break;
+      }
+      for (DWORD sent = 0; sent < n;) {
+        int k = send(tx, buf + sent, (int) (n - sent), 0);
+        if (k <= 0) {
+          ok = 0;
+          break;
+        }
+        sent += (DWORD) k;
+      }
+      off += n;
+    }
+  }
+  *cpu_ms = thread_cpu_ms() - cpu;
+  shutdown(tx, SD_SEND);
+  WaitForSingleObject(th, INFINITE);
+  CloseHandle(th);
+  *ms = (double) (mg_millis() - t);
+  closesocket(tx);
+  closesocket(rx);
+  return ok;
+}
+
+// Ficheiro temporário de BENCH_TEMP_SIZE bytes, apagado ao fechar
+static HANDLE bench_temp_file(void) {
+  char dir[MAX_PATH], name[MAX_PATH];
+  if (!GetTempPathA(sizeof(dir), dir) || !GetTempFileNameA(dir, "gym", 0, name)) {
+    return INVALID_HANDLE_VALUE;
+  }
+  HANDLE file = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+  if (file == INVALID_HANDLE_VALUE) return file;
+
+  static char block[1 << 16];
+  uint32_t x = 2463534242u;
+  for (size_t i = 0; i < sizeof(block); i++) {
+    x ^= x << 13, x ^= x >> 17, x ^= x << 5;
+    block[i] = (char) x;
+  }
+  for (int i = 0; i < BENCH_TEMP_SIZE / (int) sizeof(block); i++) {
+    DWORD n = 0;
+    if (!WriteFile(file, block, sizeof(block), &n, NULL) || n != sizeof(block)) {
+      CloseHandle(file);
+      return INVALID_HANDLE_VALUE;
+    }
+  }
+  return file;
+}
+
+int bench_sendfile(const char *path) {
+  WSADATA wsa;
+  if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+    printf("bench-sendfile: WSAStartup falhou\n");
+    return 1;
+  }
+
+  HANDLE file;
+  if (path) {
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  } else {
+    file = bench_temp_file();
+    path = "ficheiro temporário";
+  }
+
+  LARGE_INTEGER sz;
+  if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &sz) || sz.QuadPart <= 0 ||
+      (uint64_t) sz.QuadPart > BENCH_TRANSMIT_MAX) {
+    printf("bench-sendfile: não foi possível abrir %s (ou maior que 2 GB)\n", path);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    WSACleanup();
+    return 1;
+  }
+  uint64_t size = (uint64_t) sz.QuadPart;
+  long long rounds = BENCH_TOTAL / (long long) size;
+  if (rounds < 1) rounds = 1;
+  if (rounds > BENCH_MAX_ROUNDS) rounds = BENCH_MAX_ROUNDS;
+
+  printf("bench-sendfile: %s, %llu bytes x %lld envios\n", path,
+         (unsigned long long) size, rounds);
+
+  static const char *names[2] = { "copia", "TransmitFile" };
+  int bad = 0;
+  for (int mode = 0; mode < 2; mode++) {
+    double ms = 0, cpu = 0;
+    double best_ms = 0, best_cpu = 0;
+    // 1ª volta aquece a cache de ficheiros; fica a melhor de 3
+    for (int k = 0; k < 3; k++) {
+      if (!bench_mode(file, size, (int) rounds, mode, &ms, &cpu)) {
+        printf("  %-12s: falhou\n", names[mode]);
+        bad = 1;
+        break;
+      }
+      if (k == 0 || ms < best_ms) best_ms = ms, best_cpu = cpu;
+    }
+    if (bad) break;
+    double mb = (double) size * (double) rounds / (1024.0 * 1024.0);
+    printf("  %-12s: %.0f MB/s, %.0f ms de CPU no envio (%.0f MB)\n", names[mode],
+           best_ms > 0 ? mb / (best_ms / 1000.0) : 0.0, best_cpu, mb);
+  }
+  CloseHandle(file);
+  WSACleanup();
+  return bad;
+}
+
+// ======================================================
+// --bench-login / --bench-pages: BD à parte e pedidos cronometrados
+// ======================================================
+void bench_db_remove(void) {
+  static const char *suffix[3] = { "", "-wal", "-shm" };
+  char path[128];
+  for (int i = 0; i < 3; i++) {
+    snprintf(path, sizeof(path), "%s%s", BENCH_DB_PATH, suffix[i]);
+    remove(path);
+  }
+}
+
+// Um pedido de cada vez numa ligação keep-alive (latência por pedido)
+struct bench_req {
+  const char *token;
+  LARGE_INTEGER sent;
+  double ms;                    // latência da última resposta
+  int status;                   // 0 = à espera
+  int closed;
+  char cursor[32];              // next_cursor da última resposta ("" = null / sem)
+};
+
+static double bench_ms_since(LARGE_INTEGER from) {
+  LARGE_INTEGER now, freq;
+  QueryPerformanceCounter(&now);
+  QueryPerformanceFrequency(&freq);
+  return (double) (now.QuadPart - from.QuadPart) * 1000.0 / (double) freq.QuadPart;
+}
+
+static void req_fn(struct mg_connection *c, int ev, void *ev_data) {
+  struct bench_req *br = (struct bench_req *) c->fn_data;
+  if (ev == MG_EV_HTTP_MSG) {
+    struct mg_http_message *hm = (struct mg_http_message *) ev_data;
+    br->ms = bench_ms_since(br->sent);
+    br->cursor[0] = '\0';
+    char *cursor = mg_json_get_str(hm->body, "$.next_cursor");
+    if (cursor) {
+      snprintf(br->cursor, sizeof(br->cursor), "%s", cursor);
+      mg_free(cursor);
+    }
+    br->status = mg_http_status(hm);
+  } else if (ev == MG_EV_ERROR || ev == MG_EV_CLOSE) {
+    br->closed = 1;
+  }
+}
+
+// GET path e espera pela resposta; devolve o status (0 = a ligação caiu)
+static int req_run(struct mg_mgr *mgr, struct mg_connection *c, struct bench_req *br,
+                   const char *path) {
+  br->status = 0;
+  QueryPerformanceCounter(&br->sent);
+  mg_printf(c, "GET %s HTTP/1.1\r\nHost: localhost\r\n", path);
+  if (br->token) mg_printf(c, "Authorization: Bearer %s\r\n", br->token);
+  mg_printf(c, "\r\n");
+  uint64_t deadline = mg_millis() + 10000;
+  while (!br->status && !br->closed && mg_millis() < deadline) mg_mgr_poll(mgr, 10);
+  return br->status;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *) a, y = *(const double *) b;
+  return x < y ? -1 : x > y;
+}
+
+// p50 / p99 / máximo de n amostras (ordena-as)
+static void bench_percentiles(double *ms, int n, double *p50, double *p99, double *max) {
+  *p50 = *p99 = *max = 0;
+  if (n <= 0) return;
+  qsort(ms, (size_t) n, sizeof(double), cmp_double);
+  *p50 = ms[(n - 1) / 2];
+  *p99 = ms[(int) ((n - 1) * 0.99)];
+  *max = ms[n - 1];
+}
+
+// ======================================================
+// api.exe --bench-login: p99 do GET /exercises com e sem logins em massa
+// ======================================================
+static int login_seed(void) {
+  // O hash como o do signup: o login faz o PBKDF2 completo no hash pool
+  char hash[512];
+  if (!pwd_hash(BENCH_PASSWORD, hash, sizeof(hash))) return 0;
+
+  sqlite3_stmt *stmt = NULL;
+  int ok = sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL) == SQLITE_OK;
+  if (ok && stmtcache_prepare("INSERT INTO users (email, password_hash, name, surname, role) "
+                              "VALUES ('bench-login@bench.local', ?, 'Bench', 'Login', 'client');",
+                              &stmt) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, hash, -1, SQLITE_TRANSIENT);
+    ok = sqlite3_step(stmt) == SQLITE_DONE;
+    stmtcache_release(stmt);
+  } else {
+    ok = 0;
+  }
+  if (ok && stmtcache_prepare("INSERT INTO exercises (name) VALUES (?);", &stmt) == SQLITE_OK) {
+    char name[32];
+    for (int i = 0; i < BENCH_LOGIN_EXERCISES && ok; i++) {
+      snprintf(name, sizeof(name), "Bench %d", i + 1);
+      sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
+      ok = sqlite3_step(stmt) == SQLITE_DONE;
+      sqlite3_reset(stmt);
+    }
+    stmtcache_release(stmt);
+  } else {
+    ok = 0;
+  }
+  sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", NULL, NULL, NULL);
+  return ok;
+}
+
+int bench_login(int workers, int logins) {
+  if (logins < 1) logins = BENCH_LOGIN_CONNS;
+  if (workers < 1) workers = 1;
+  mg_log_set(MG_LL_ERROR);
+
+  if (!login_seed()) {
+    printf("bench-login: não foi possível criar o user de teste\n");
+    return 1;
+  }
+
+  char server_url[64];
+  snprintf(server_url, sizeof(server_url), "http://0.0.0.0:%d", BENCH_PORT);
+  if (workers_start(workers, server_url) != workers) {
+    printf("bench-login: os workers não arrancaram\n");
+    return 1;
+  }
+
+  double *ms = (double *) malloc(BENCH_SAMPLES_MAX * sizeof(double));
+  if (!ms) {
+    workers_stop();
+    return 1;
+  }
+
+  printf("bench-login: GET /exercises numa ligação keep-alive, com e sem POST /login em %d ligações "
+         "(%d worker%s)\n", logins, workers, workers > 1 ? "s" : "");
+  printf("  fase          pedidos    p50 ms    p99 ms    máx ms   logins/s   erros\n");
+
+  int bad = 0;
+  double p99_base = 0;
+  for (int phase = 0; phase < 2 && !bad; phase++) {
+    uint64_t start = mg_millis();
+    struct bench_client flood;
+    HANDLE thread = NULL;
+    memset(&flood, 0, sizeof(flood));
+    flood.measure_from = start + BENCH_WARMUP_MS;
+    flood.until = start + BENCH_WARMUP_MS + BENCH_MEASURE_MS;
+    if (phase == 1) {
+      snprintf(flood.url, sizeof(flood.url), "http://127.0.0.1:%d", BENCH_PORT);
+      flood.conns = logins;
+      flood.path = "/login";
+      flood.body = "{ \"email\": \"bench-login@bench.local\", \"password\": \"" BENCH_PASSWORD "\" }";
+      thread = CreateThread(NULL, 0, bench_client_main, &flood, 0, NULL);
+    }
+
+    // Cliente das latências nesta thread
+    struct bench_req br;
+    memset(&br, 0, sizeof(br));
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", BENCH_PORT);
+    struct mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    struct mg_connection *c = mg_http_connect(&mgr, url, req_fn, &br);
+    int n = 0;
+    unsigned long errors = 0;
+    while (c && !br.closed && mg_millis() < flood.until) {
+      int status = req_run(&mgr, c, &br, "/exercises");
+      if (mg_millis() < flood.measure_from) continue;
+      if (status != 200) errors++;
+      else if (n < BENCH_SAMPLES_MAX) ms[n++] = br.ms;
+    }
+    mg_mgr_free(&mgr);
+
+    if (thread) {
+      WaitForSingleObject(thread, INFINITE);
+      CloseHandle(thread);
+    }
+
+    double p50, p99, max;
+    bench_percentiles(ms, n, &p50, &p99, &max);
+    if (phase == 0) p99_base = p99;
+    printf("  %-10s %10d %9.3f %9.3f %9.3f %10.0f %7lu\n", phase ? "com logins" : "sem logins",
+           n, p50, p99, max, flood.done * 1000.0 / BENCH_MEASURE_MS, errors + flood.errors);
+    if (n == 0 || errors > 0) bad = 1;
+    if (phase == 1 && p99_base > 0) printf("  p99 com/sem logins: %.2fx\n", p99 / p99_base);
+  }
+  free(ms);
+  workers_stop();
+  if (bad) printf("bench-login: pedidos a /exercises falharam\n");
+  return bad;
+}
+
+// ======================================================
+// api.exe --bench-pages: latência por página de GET /workouts e
+// GET /admin/users (keyset) com a tabela pequena e grande
+// ======================================================
+static int pages_exec(const char *sql) {
+  return sqlite3_exec(db, sql, NULL, NULL, NULL) == SQLITE_OK;
+}
+
+// Um admin e um client com sessão (tokens fixos, sem login)
+static int pages_seed_users(void) {
+  return pages_exec("BEGIN;") &&
+         pages_exec("INSERT INTO users (email, password_hash, name, surname, role) VALUES "
+                    "('bench-admin@bench.local', '-', 'Bench', 'Admin', 'admin'),"
+                    "('bench-client@bench.local', '-', 'Bench', 'Client', 'client');") &&
+         pages_exec("INSERT INTO sessions (user_id, token, expires_at) "
+                    "SELECT id, 'bench-' || role, datetime('now', '+1 day') FROM users "
+                    "WHERE email LIKE 'bench-%@bench.local';") &&
+         pages_exec("COMMIT;");
+}
+
+static long long pages_query(const char *sql) {
+  sqlite3_stmt *stmt = NULL;
+  long long v = -1;
+  if (stmtcache_prepare(sql, &stmt) != SQLITE_OK || !stmt) return -1;
+  if (sqlite3_step(stmt) == SQLITE_ROW) v = sqlite3_column_int64(stmt, 0);
+  stmtcache_release(stmt);
+  return v;
+}
+
+// Cresce workouts (todos do client) e users até ids 1..rows em cada tabela
+static int pages_grow(int rows) {
+  long long client = pages_query("SELECT id FROM users WHERE email = 'bench-client@bench.local';");
+  long long workout = pages_query("SELECT COALESCE(MAX(id), 0) FROM workouts;");
+  long long user = pages_query("SELECT COALESCE(MAX(id), 0) FROM users;");
+  if (client <= 0 || workout < 0 || user < 0) return 0;
+
+  sqlite3_stmt *stmt = NULL;
+  int ok = pages_exec("BEGIN;");
+  if (ok && stmtcache_prepare("INSERT INTO workouts (id, user_id) VALUES (?, ?);", &stmt) == SQLITE_OK) {
+    while (ok && workout < rows) {
+      sqlite3_bind_int64(stmt, 1, ++workout);
+      sqlite3_bind_int64(stmt, 2, client);
+      ok = sqlite3_step(stmt) == SQLITE_DONE;
+      sqlite3_reset(stmt);
+    }
+    stmtcache_release(stmt);
+  } else {
+    ok = 0;
+  }
+  if (ok && stmtcache_prepare("INSERT INTO users (id, email, password_hash, name, surname, role) "
+                              "VALUES (?, ?, '-', 'Bench', 'User', 'client');", &stmt) == SQLITE_OK) {
+    char email[64];
+    while (ok && user < rows) {
+      snprintf(email, sizeof(email), "bench-user-%lld@bench.local", ++user);
+      sqlite3_bind_int64(stmt, 1, user);
+      sqlite3_bind_text(stmt, 2, email, -1, SQLITE_TRANSIENT);
+      ok = sqlite3_step(stmt) == SQLITE_DONE;
+      sqlite3_reset(stmt);
+    }
+    stmtcache_release(stmt);
+  } else {
+    ok = 0;
+  }
+  return pages_exec(ok ? "COMMIT;" : "ROLLBACK;") && ok;
+}
+
+// Percorre path até next_cursor = null: uma volta de aquecimento e depois
+// voltas completas até ter BENCH_PAGES_SAMPLES páginas medidas. Devolve o nº
+// de páginas por volta (0 = falhou)
+static int pages_walk(const char *path, const char *token, double *ms, int *n) {
+  char url[64], uri[128];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d", BENCH_PORT);
+  struct bench_req br;
+  memset(&br, 0, sizeof(br));
+  br.token = token;
+  struct mg_mgr mgr;
+  mg_mgr_init(&mgr);
+  struct mg_connection *c = mg_http_connect(&mgr, url, req_fn, &br);
+
+  int pages = 0;
+  *n = 0;
+  for (int walk = 0; c && (walk == 0 || *n < BENCH_PAGES_SAMPLES); walk++) {
+    int walked = 0;
+    br.cursor[0] = '\0';
+    do {
+      if (br.cursor[0]) {
+        snprintf(uri, sizeof(uri), "%s?limit=%d&after_id=%s", path, BENCH_PAGES_LIMIT, br.cursor);
+      } else {
+        snprintf(uri, sizeof(uri), "%s?limit=%d", path, BENCH_PAGES_LIMIT);
+      }
+      if (req_run(&mgr, c, &br, uri) != 200) {
+        walked = 0;
+        break;
+      }
+      if (walk > 0 && *n < BENCH_SAMPLES_MAX) ms[(*n)++] = br.ms;
+      walked++;
+    } while (br.cursor[0]);
+    if (walked == 0 || (pages && walked != pages)) {
+      pages = 0;
+      break;
+    }
+    pages = walked;
+  }
+  mg_mgr_free(&mgr);
+  return pages;
+}
+
+int bench_pages(int workers, int rows) {
+  if (rows < 10 * BENCH_PAGES_LIMIT) rows = BENCH_PAGES_ROWS;
+  if (workers < 1) workers = 1;
+  mg_log_set(MG_LL_ERROR);
+
+  static const struct { const char *path, *token; } routes[2] = {
+    { "/workouts", "bench-client" },
+    { "/admin/users", "bench-admin" },
+  };
+  double *ms = (double *) malloc(BENCH_SAMPLES_MAX * sizeof(double));
+  if (!ms || !pages_seed_users()) {
+    printf("bench-pages: não foi possível criar os users de teste\n");
+    free(ms);
+    return 1;
+  }
+
+  char server_url[64];
+  snprintf(server_url, sizeof(server_url), "http://0.0.0.0:%d", BENCH_PORT);
+  printf("bench-pages: limit=%d, %d worker%s, sem cache de respostas\n", BENCH_PAGES_LIMIT,
+         workers, workers > 1 ? "s" : "");
+  printf("  rota            linhas  páginas    p50 ms    p99 ms    máx ms\n");
+
+  int sizes[2] = { rows / 10, rows };
+  double p99s[2][2] = { { 0, 0 }, { 0, 0 } };
+  int bad = 0;
+  for (int s = 0; s < 2 && !bad; s++) {
+    if (!pages_grow(sizes[s])) {
+      printf("bench-pages: não foi possível inserir %d linhas\n", sizes[s]);
+      bad = 1;
+      break;
+    }
+    if (workers_start(workers, server_url) != workers) {
+      printf("bench-pages: os workers não arrancaram\n");
+      bad = 1;
+      break;
+    }
+    for (int r = 0; r < 2; r++) {
+      int n = 0;
+      int pages = pages_walk(routes[r].path, routes[r].token, ms, &n);
+      double p50, p99, max;
+      bench_percentiles(ms, n, &p50, &p99, &max);
+      p99s[r][s] = p99;
+      // ids 1..linhas: ceil(linhas / limit) páginas em cada volta
+      if (pages != (sizes[s] + BENCH_PAGES_LIMIT - 1) / BENCH_PAGES_LIMIT) {
+        printf("  %-13s %8d  falhou (%d páginas)\n", routes[r].path, sizes[s], pages);
+        bad = 1;
+      } else {
+        printf("  %-13s %8d %8d %9.3f %9.3f %9.3f\n", routes[r].path, sizes[s], pages, p50, p99, max);
+      }
+    }
+    workers_stop();
+  }
+  if (!bad) {
+    printf("  p99 com %d vs %d linhas: %s %.2fx, %s %.2fx\n", sizes[1], sizes[0],
+           routes[0].path, p99s[0][0] > 0 ? p99s[0][1] / p99s[0][0] : 0.0,
+           routes[1].path, p99s[1][0] > 0 ? p99s[1][1] / p99s[1][0] : 0.0);
+  }
+  free(ms);
+  return bad;
+}
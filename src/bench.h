@@ -0,0 +1,47 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Benchmarks de linha de comando (api.exe --bench-*), fora dos módulos que
+// medem: só usam as APIs públicas deles. Retornam 0 se ok, 1 se falhou.
+
+// --bench-workers: para 1, 2, 4... até max workers (porta 18000), carga
+// HTTP em keep-alive sobre path (GYM_BENCH_TOKEN = Bearer opcional)
+// durante alguns segundos. Precisa da BD, executor e hash pool iniciados.
+int bench_workers(int max, const char *path);
+
+// --bench-alloc: alocações no heap por pedido em regime estável (arena.h):
+// 1 worker, n pedidos seguidos a path numa ligação keep-alive depois de um
+// aquecimento (GYM_BENCH_TOKEN = Bearer, GYM_BENCH_BODY = POST com esse
+// corpo). Falha se o mongoose, o executor e a arena alocaram.
+int bench_alloc(const char *path, int n);
+
+// --bench-router: custo por rota da trie vs a cadeia linear de mg_match +
+// sscanf que havia antes. Falha se alguma rota não casa. Depois do
+// http_routes_init.
+int bench_router(void);
+
+// --bench-colstore: SQLite vs colstore nos N users com mais sets. Falha se
+// os resultados diferem.
+int bench_colstore(int users);
+
+// --bench-sendfile: débito por loopback TCP, cópias de MG_IO_SIZE (como o
+// mongoose) vs TransmitFile. path = NULL usa um ficheiro temporário de 64 MB.
+int bench_sendfile(const char *path);
+
+// --bench-login / --bench-pages escrevem dados: correm numa BD à parte,
+// vazia no início (main.c apaga-a antes e depois com bench_db_remove)
+#define BENCH_DB_PATH "db/bench.db"
+void bench_db_remove(void);
+
+// --bench-login: p50/p99 de GET /exercises numa ligação keep-alive, sozinho
+// e com logins (PBKDF2 completo) em contínuo em logins ligações (porta 18000).
+// Precisa da BD, executor e hash pool iniciados.
+int bench_login(int workers, int logins);
+
+// --bench-pages: percorre GET /workouts e GET /admin/users (?limit=&after_id=)
+// até ao fim com rows / 10 e rows linhas em cada tabela e mede a latência por
+// página. Falha se um pedido falha ou o nº de páginas não bate certo. Sem
+// cache de respostas (os inserts não passam pelo executor).
+int bench_pages(int workers, int rows);
+
+#endif
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "check.h"
+#include "mongoose.h"
+#include "agg.h"
+
+// ======================================================
+// api.exe --check-kernels: variantes SIMD do agg vs escalar
+// ======================================================
+#define CHECK_N      1000003    // ímpar: exercita a cauda escalar
+#define CHECK_CASES  64
+#define CHECK_REPEAT 20
+
+static int same_result(const struct agg_result *a, const struct agg_result *b) {
+  double d = fabs(a->volume - b->volume);
+  double m = fabs(a->volume) > fabs(b->volume) ? fabs(a->volume) : fabs(b->volume);
+  return a->count == b->count &&
+         a->min_weight == b->min_weight && a->max_weight == b->max_weight &&
+         a->min_reps == b->min_reps && a->max_reps == b->max_reps &&
+         a->max_volume == b->max_volume &&
+         d <= m * AGG_SUM_TOLERANCE;
+}
+
+int check_kernels(void) {
+  int64_t *ts = (int64_t *) malloc(CHECK_N * sizeof(*ts));
+  int32_t *ex = (int32_t *) malloc(CHECK_N * sizeof(*ex));
+  int32_t *reps = (int32_t *) malloc(CHECK_N * sizeof(*reps));
+  double *weight = (double *) malloc(CHECK_N * sizeof(*weight));
+  if (!ts || !ex || !reps || !weight) {
+    free(ts); free(ex); free(reps); free(weight);
+    return 1;
+  }
+
+  // Dados do género dos reais: ~5 anos de timestamps, pesos com .5 / .25 e
+  // alguns "feios" (não representáveis em binário), reps 1..30
+  srand(12345);
+  int64_t t0 = 1600000000;
+  for (int i = 0; i < CHECK_N; i++) {
+    ts[i] = t0 + (int64_t) rand() * 86400 / RAND_MAX * 1825;
+    ex[i] = 1 + rand() % 20;
+    reps[i] = 1 + rand() % 30;
+    weight[i] = (i % 7 == 0) ? (rand() % 2000) / 10.0 + 0.3 : (rand() % 800) * 0.25;
+  }
+
+  int bad = 0;
+  for (int k = 0; k < CHECK_CASES; k++) {
+    struct agg_input in = { 0 };
+    in.ts = ts; in.exercise_id = ex; in.reps = reps; in.weight = weight;
+    // Tamanhos / janelas / filtros variados (incluindo n pequeno e janelas vazias)
+    in.n = k < 8 ? k : (k % 3 == 0 ? CHECK_N : 1 + rand() % CHECK_N);
+    in.from_ts = k % 4 == 0 ? INT64_MIN : t0 + (int64_t) (rand() % 1825) * 86400;
+    in.to_ts = k % 5 == 0 ? INT64_MAX : in.from_ts + (int64_t) (rand() % 400) * 86400;
+    if (k % 4 == 0 && in.to_ts != INT64_MAX) in.to_ts = t0 + (int64_t) (rand() % 1825) * 86400;
+    in.exercise = k % 2 ? -1 : 1 + rand() % 21;
+
+    struct agg_result ref, r;
+    agg_run_impl(AGG_SCALAR, &in, &ref);
+    for (int impl = AGG_SSE2; impl <= AGG_AVX2; impl++) {
+      if (!agg_run_impl(impl, &in, &r)) continue;
+      if (!same_result(&ref, &r)) {
+        printf("check-kernels: %s difere no caso %d (n=%d, count %lld/%lld, volume %.17g/%.17g)\n",
+               agg_impl_name(impl), k, in.n, ref.count, r.count, ref.volume, r.volume);
+        bad++;
+      }
+    }
+  }
+
+  // Tempo por variante: tudo (volume total) e 1 exercício num ano (histograma)
+  struct agg_input timed[2] = {
+    { CHECK_N, ts, ex, reps, weight, INT64_MIN, INT64_MAX, -1 },
+    { CHECK_N, ts, ex, reps, weight, t0 + 365 * 86400, t0 + 730 * 86400, 3 },
+  };
+  for (int impl = AGG_SCALAR; impl <= AGG_AVX2; impl++) {
+    struct agg_result r;
+    if (!agg_run_impl(impl, &timed[0], &r)) {
+      printf("  %-6s: não suportado neste CPU\n", agg_impl_name(impl));
+      continue;
+    }
+    double ms[2];
+    for (int j = 0; j < 2; j++) {
+      uint64_t t = mg_millis();
+      for (int k = 0; k < CHECK_REPEAT; k++) agg_run_impl(impl, &timed[j], &r);
+      ms[j] = (double) (mg_millis() - t) / CHECK_REPEAT;
+    }
+    printf("  %-6s: %.2f ms (todos) / %.2f ms (1 exercício, 1 ano) em %d sets\n",
+           agg_impl_name(impl), ms[0], ms[1], CHECK_N);
+  }
+
+  free(ts); free(ex); free(reps); free(weight);
+  return bad;
+}
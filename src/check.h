@@ -0,0 +1,11 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Verificações de linha de comando (api.exe --check-*), fora dos módulos
+// que verificam. O --check-plans fica em db.c: também corre no arranque.
+
+// api.exe --check-kernels: compara SSE2/AVX2 com a versão escalar em dados
+// aleatórios e mede cada uma. Retorna o nº de diferenças.
+int check_kernels(void);
+
+#endif
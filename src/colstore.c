@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <windows.h>
+
+#include "colstore.h"
+#include "agg.h"
+#include "mongoose.h"
+#include "db.h"
+#include "stmtcache.h"
+#include "queries.h"
+
+// Colunas de um user. Ordenadas por set_id (os inserts chegam sempre com o
+// maior id, por isso na prática é append).
+struct col_user {
+  int n, cap;
+  int32_t *set_id;
+  int32_t *workout_id;
+  int32_t *exercise_id;
+  int32_t *reps;
+  int64_t *ts;
+  double *weight;
+};
+
+enum { OP_SET_CHANGED = 0, OP_SET_DELETED = 1, OP_WORKOUT_DELETED = 2 };
+
+struct col_op {
+  int kind;
+  int user_id;
+  int id;
+};
+
+static struct col_user *s_users = NULL;   // índice = user_id
+static int s_nusers = 0;
+static int s_loaded = 0;
+static long long s_total = 0;
+
+static struct col_op *s_ops = NULL;       // alterações por aplicar (transação aberta)
+static int s_nops = 0, s_capops = 0;
+
+// Colunas: exclusivo para aplicar o commit, partilhado para os kernels.
+// As s_ops são só do writer, não precisam de lock.
+static SRWLOCK s_rw = SRWLOCK_INIT;
+
+// ======================================================
+// Arrays
+// ======================================================
+static struct col_user *user_get(int user_id, int create) {
+  if (user_id < 0) return NULL;
+  if (user_id < s_nusers) return &s_users[user_id];
+  if (!create) return NULL;
+
+  int n = s_nusers ? s_nusers : 64;
+  while (n <= user_id) n *= 2;
+  struct col_user *p = (struct col_user *) realloc(s_users, (size_t) n * sizeof(*p));
+  if (!p) return NULL;
+  memset(p + s_nusers, 0, (size_t) (n - s_nusers) * sizeof(*p));
+  s_users = p;
+  s_nusers = n;
+  return &s_users[user_id];
+}
+
+#define GROW(field, type) do { \
+    type *p_ = (type *) realloc(u->field, (size_t) cap * sizeof(type)); \
+    if (!p_) return 0; \
+    u->field = p_; \
+  } while (0)
+
+static int user_resize(struct col_user *u, int cap) {
+  GROW(set_id, int32_t);
+  GROW(workout_id, int32_t);
+  GROW(exercise_id, int32_t);
+  GROW(reps, int32_t);
+  GROW(ts, int64_t);
+  GROW(weight, double);
+
+  u->cap = cap;
+  return 1;
+}
+
+static int user_reserve(struct col_user *u, int need) {
+  if (need <= u->cap) return 1;
+  int cap = u->cap ? u->cap : 16;
+  while (cap < need) cap *= 2;
+  return user_resize(u, cap);
+}
+
+// 1ª posição com set_id >= id
+static int user_find(const struct col_user *u, int set_id) {
+  int lo = 0, hi = u->n;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (u->set_id[mid] < set_id) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+#define SHIFT(field, from, to, count) \
+  memmove(u->field + (to), u->field + (from), (size_t) (count) * sizeof(u->field[0]))
+
+static int user_upsert(int user_id, int set_id, int workout_id, int64_t ts,
+                       int exercise_id, int reps, double weight) {
+  struct col_user *u = user_get(user_id, 1);
+  if (!u) return 0;
+
+  int pos = user_find(u, set_id);
+  if (pos == u->n || u->set_id[pos] != set_id) {
+    if (!user_reserve(u, u->n + 1)) return 0;
+    int tail = u->n - pos;
+    if (tail > 0) {
+      SHIFT(set_id, pos, pos + 1, tail);
+      SHIFT(workout_id, pos, pos + 1, tail);
+      SHIFT(exercise_id, pos, pos + 1, tail);
+      SHIFT(reps, pos, pos + 1, tail);
+      SHIFT(ts, pos, pos + 1, tail);
+      SHIFT(weight, pos, pos + 1, tail);
+    }
+    u->n++;
+    s_total++;
+  }
+
+  u->set_id[pos] = set_id;
+  u->workout_id[pos] = workout_id;
+  u->exercise_id[pos] = exercise_id;
+  u->reps[pos] = reps;
+  u->ts[pos] = ts;
+  u->weight[pos] = weight;
+  return 1;
+}
+
+static void user_remove_set(int user_id, int set_id) {
+  struct col_user *u = user_get(user_id, 0);
+  if (!u) return;
+
+  int pos = user_find(u, set_id);
+  if (pos == u->n || u->set_id[pos] != set_id) return;
+
+  int tail = u->n - pos - 1;
+  if (tail > 0) {
+    SHIFT(set_id, pos + 1, pos, tail);
+    SHIFT(workout_id, pos + 1, pos, tail);
+    SHIFT(exercise_id, pos + 1, pos, tail);
+    SHIFT(reps, pos + 1, pos, tail);
+    SHIFT(ts, pos + 1, pos, tail);
+    SHIFT(weight, pos + 1, pos, tail);
+  }
+  u->n--;
+  s_total--;
+}
+
+static void user_remove_workout(int user_id, int workout_id) {
+  struct col_user *u = user_get(user_id, 0);
+  if (!u) return;
+
+  int k = 0;
+  for (int i = 0; i < u->n; i++) {
+    if (u->workout_id[i] == workout_id) continue;
+    u->set_id[k] = u->set_id[i];
+    u->workout_id[k] = u->workout_id[i];
+    u->exercise_id[k] = u->exercise_id[i];
+    u->reps[k] = u->reps[i];
+    u->ts[k] = u->ts[i];
+    u->weight[k] = u->weight[i];
+    k++;
+  }
+  s_total -= u->n - k;
+  u->n = k;
+}
+
+// ======================================================
+// Load / free
+// ======================================================
+int colstore_load(void) {
+  const char *sql =
+    SQL_COLSTORE_ROW
+    "WHERE w.user_id IS NOT NULL "
+    "ORDER BY we.id;";
+
+  colstore_free();
+
+  sqlite3_stmt *stmt = NULL;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK || !stmt) {
+    printf("Erro ao carregar colstore: %s\n", sqlite3_errmsg(db));
+    return 0;
+  }
+
+  uint64_t t0 = mg_millis();
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    int user_id = sqlite3_column_int(stmt, 0);
+    struct col_user *u = user_get(user_id, 1);
+    if (!u || !user_reserve(u, u->n + 1)) {
+      rc = SQLITE_NOMEM;
+      break;
+    }
+
+    // Percorre por we.id: append direto, já fica ordenado
+    int i = u->n++;
+    u->set_id[i] = sqlite3_column_int(stmt, 1);
+    u->workout_id[i] = sqlite3_column_int(stmt, 2);
+    u->ts[i] = sqlite3_column_int64(stmt, 3);
+    u->exercise_id[i] = sqlite3_column_int(stmt, 4);
+    u->reps[i] = sqlite3_column_int(stmt, 5);
+    u->weight[i] = sqlite3_column_double(stmt, 6);
+    s_total++;
+  }
+  sqlite3_finalize(stmt);
+
+  if (rc != SQLITE_DONE) {
+    printf("Erro ao carregar colstore (%d)\n", rc);
+    colstore_free();
+    return 0;
+  }
+
+  // Devolve a folga do crescimento geométrico
+  for (int i = 0; i < s_nusers; i++) {
+    if (s_users[i].n > 0 && s_users[i].n < s_users[i].cap) user_resize(&s_users[i], s_users[i].n);
+  }
+
+  s_loaded = 1;
+  printf("Colstore: %lld sets carregados em %llu ms\n", s_total,
+         (unsigned long long) (mg_millis() - t0));
+  return 1;
+}
+
+int colstore_enabled(void) {
+  return s_loaded;
+}
+
+static void free_all(void) {
+  for (int i = 0; i < s_nusers; i++) {
+    struct col_user *u = &s_users[i];
+    free(u->set_id);
+    free(u->workout_id);
+    free(u->exercise_id);
+    free(u->reps);
+    free(u->ts);
+    free(u->weight);
+  }
+  free(s_users);
+  s_users = NULL;
+  s_nusers = 0;
+  s_total = 0;
+  s_loaded = 0;
+
+  free(s_ops);
+  s_ops = NULL;
+  s_nops = s_capops = 0;
+}
+
+void colstore_free(void) {
+  AcquireSRWLockExclusive(&s_rw);
+  free_all();
+  ReleaseSRWLockExclusive(&s_rw);
+}
+
+// ======================================================
+// Caminho de escrita: regista agora, aplica no commit
+// ======================================================
+static void op_push(int kind, int user_id, int id) {
+  if (!s_loaded) return;
+  if (s_nops == s_capops) {
+    int cap = s_capops ? s_capops * 2 : 64;
+    struct col_op *p = (struct col_op *) realloc(s_ops, (size_t) cap * sizeof(*p));
+    if (!p) {
+      // Sem memória para registar: a cópia deixaria de bater certo com a BD
+      printf("Colstore desligado (sem memória)\n");
+      colstore_free();
+      return;
+    }
+    s_ops = p;
+    s_capops = cap;
+  }
+  s_ops[s_nops].kind = kind;
+  s_ops[s_nops].user_id = user_id;
+  s_ops[s_nops].id = id;
+  s_nops++;
+}
+
+void colstore_set_changed(int user_id, int set_id) {
+  op_push(OP_SET_CHANGED, user_id, set_id);
+}
+
+void colstore_set_deleted(int user_id, int set_id) {
+  op_push(OP_SET_DELETED, user_id, set_id);
+}
+
+void colstore_workout_deleted(int user_id, int workout_id) {
+  op_push(OP_WORKOUT_DELETED, user_id, workout_id);
+}
+
+int colstore_txn_mark(void) {
+  return s_nops;
+}
+
+void colstore_txn_rollback(int mark) {
+  if (mark >= 0 && mark < s_nops) s_nops = mark;
+}
+
+void colstore_txn_abort(void) {
+  s_nops = 0;
+}
+
+// Relê o set (já commitado) e atualiza a cópia
+static int apply_set_changed(const struct col_op *op) {
+  sqlite3_stmt *stmt = NULL;
+  int rc = stmtcache_prepare(SQL_COLSTORE_SET, &stmt);
+  if (rc != SQLITE_OK || !stmt) return 0;
+
+  sqlite3_bind_int(stmt, 1, op->id);
+  rc = sqlite3_step(stmt);
+
+  int ok = 1;
+  if (rc == SQLITE_ROW) {
+    ok = user_upsert(sqlite3_column_int(stmt, 0), op->id,
+                     sqlite3_column_int(stmt, 2), sqlite3_column_int64(stmt, 3),
+                     sqlite3_column_int(stmt, 4), sqlite3_column_int(stmt, 5),
+                     sqlite3_column_double(stmt, 6));
+  } else if (rc == SQLITE_DONE) {
+    user_remove_set(op->user_id, op->id);
+  } else {
+    ok = 0;
+  }
+
+  stmtcache_release(stmt);
+  return ok;
+}
+
+void colstore_txn_commit(void) {
+  if (s_nops == 0) return;
+
+  AcquireSRWLockExclusive(&s_rw);
+  for (int i = 0; i < s_nops && s_loaded; i++) {
+    const struct col_op *op = &s_ops[i];
+    switch (op->kind) {
+      case OP_SET_CHANGED:
+        if (!apply_set_changed(op)) {
+          printf("Colstore desligado (falhou a sincronizar o set %d)\n", op->id);
+          free_all();
+          ReleaseSRWLockExclusive(&s_rw);
+          return;
+        }
+        break;
+      case OP_SET_DELETED:
+        user_remove_set(op->user_id, op->id);
+        break;
+      case OP_WORKOUT_DELETED:
+        user_remove_workout(op->user_id, op->id);
+        break;
+    }
+  }
+  s_nops = 0;
+  ReleaseSRWLockExclusive(&s_rw);
+}
+
+// ======================================================
+// Kernels: volume e mínimo/máximo do histograma vão para o agg (SIMD
+// escolhido no arranque); o resto são loops simples sobre as colunas.
+// ======================================================
+static void user_input(const struct col_user *u, struct agg_input *in) {
+  memset(in, 0, sizeof(*in));
+  in->n = u->n;
+  in->ts = u->ts;
+  in->exercise_id = u->exercise_id;
+  in->reps = u->reps;
+  in->weight = u->weight;
+  in->from_ts = INT64_MIN;
+  in->to_ts = INT64_MAX;
+  in->exercise = -1;
+}
+
+double colstore_volume(int user_id, int64_t from_ts, int64_t to_ts, long long *sets) {
+  if (sets) *sets = 0;
+  AcquireSRWLockShared(&s_rw);
+  const struct col_user *u = s_loaded ? user_get(user_id, 0) : NULL;
+  if (!u) {
+    ReleaseSRWLockShared(&s_rw);
+    return 0;
+  }
+
+  struct agg_input in;
+  struct agg_result r;
+  user_input(u, &in);
+  in.from_ts = from_ts;
+  in.to_ts = to_ts;
+  agg_run(&in, &r);
+  ReleaseSRWLockShared(&s_rw);
+
+  if (sets) *sets = r.count;
+  return r.volume;
+}
+
+long long colstore_max_by_exercise(int user_id, int n_ex, double *max_weight,
+                                   int *max_reps, double *max_volume) {
+  memset(max_weight, 0, (size_t) n_ex * sizeof(*max_weight));
+  memset(max_reps, 0, (size_t) n_ex * sizeof(*max_reps));
+  memset(max_volume, 0, (size_t) n_ex * sizeof(*max_volume));
+
+  AcquireSRWLockShared(&s_rw);
+  const struct col_user *u = s_loaded ? user_get(user_id, 0) : NULL;
+  if (!u) {
+    ReleaseSRWLockShared(&s_rw);
+    return 0;
+  }
+
+  const int32_t *ex = u->exercise_id;
+  const int32_t *reps = u->reps;
+  const double *weight = u->weight;
+  int n = u->n;
+
+  // Scatter por exercício (não vetoriza, mas é um só passo sobre as colunas)
+  for (int i = 0; i < n; i++) {
+    int e = ex[i];
+    if ((unsigned) e >= (unsigned) n_ex) continue;
+    if (weight[i] > max_weight[e]) max_weight[e] = weight[i];
+    if (reps[i] > max_reps[e]) max_reps[e] = reps[i];
+    double v = reps[i] * weight[i];
+    if (v > max_volume[e]) max_volume[e] = v;
+  }
+  ReleaseSRWLockShared(&s_rw);
+  return n;
+}
+
+long long colstore_histogram(int user_id, int exercise_id, int metric, int64_t from_ts,
+                             int bins, double *lo, double *width, unsigned *counts) {
+  memset(counts, 0, (size_t) bins * sizeof(*counts));
+  *lo = 0;
+  *width = 0;
+
+  if (bins <= 0) return 0;
+  AcquireSRWLockShared(&s_rw);
+  const struct col_user *u = s_loaded ? user_get(user_id, 0) : NULL;
+  if (!u) {
+    ReleaseSRWLockShared(&s_rw);
+    return 0;
+  }
+
+  const int32_t *ex = u->exercise_id;
+  const int64_t *ts = u->ts;
+  const int32_t *reps = u->reps;
+  const double *weight = u->weight;
+  int n = u->n;
+
+  // 1º passo: contagem e mínimo / máximo (agg, um só passo)
+  struct agg_input in;
+  struct agg_result r;
+  user_input(u, &in);
+  in.from_ts = from_ts;
+  in.exercise = exercise_id;
+  agg_run(&in, &r);
+
+  long long count = r.count;
+  if (count == 0) {
+    ReleaseSRWLockShared(&s_rw);
+    return 0;
+  }
+  double mn = metric == COLSTORE_REPS ? (double) r.min_reps : r.min_weight;
+  double mx = metric == COLSTORE_REPS ? (double) r.max_reps : r.max_weight;
+
+  double w = (mx - mn) / bins;
+  if (w <= 0) w = 1;
+
+  // 2º passo: contagens (o máximo vai para o último bin)
+  for (int i = 0; i < n; i++) {
+    if (ex[i] != exercise_id || ts[i] < from_ts) continue;
+    double v = metric == COLSTORE_REPS ? (double) reps[i] : weight[i];
+    int b = (int) ((v - mn) / w);
+    counts[b < bins ? b : bins - 1]++;
+  }
+  ReleaseSRWLockShared(&s_rw);
+
+  *lo = mn;
+  *width = w;
+  return count;
+}
+
+void colstore_stats(long long *sets, int *users) {
+  int n = 0;
+  AcquireSRWLockShared(&s_rw);
+  for (int i = 0; i < s_nusers; i++) n += s_users[i].n > 0;
+  if (sets) *sets = s_total;
+  ReleaseSRWLockShared(&s_rw);
+  if (users) *users = n;
+}
@@ -0,0 +1,57 @@
+#ifndef COLSTORE_H
+#define COLSTORE_H
+
+#include <stdint.h>
+
+// Cópia em memória, por colunas, dos sets (workout_exercises + created_at
+// do workout), por user. Opcional (GYM_COLSTORE=1): carrega no arranque e
+// as agregações sobre sets crus (histogramas, volume/PRs ad hoc) passam a
+// ser loops sobre arrays contíguos em vez de scans do SQLite.
+//
+// Sincronização: o caminho de escrita regista as alterações (set_changed,
+// set_deleted, workout_deleted) e elas só são aplicadas no commit; um
+// rollback descarta-as. O caminho de escrita corre na thread do writer
+// (writeq.h); os kernels correm nos leitores do executor (dbexec.h), com um
+// lock partilhado que o commit pede em exclusivo.
+
+// Carrega todos os sets da BD. Retorna 1 se ok, 0 se falhou.
+int colstore_load(void);
+
+// 1 se está carregado (senão os kernels não devem ser usados)
+int colstore_enabled(void);
+
+void colstore_free(void);
+
+// ------------------ Caminho de escrita ------------------
+// Set inserido/alterado: relido da BD no commit
+void colstore_set_changed(int user_id, int set_id);
+void colstore_set_deleted(int user_id, int set_id);
+void colstore_workout_deleted(int user_id, int workout_id);
+
+// Transação: mark antes de um SAVEPOINT, rollback para o mark se ele for
+// desfeito; commit aplica as alterações registadas, abort descarta-as.
+int colstore_txn_mark(void);
+void colstore_txn_rollback(int mark);
+void colstore_txn_commit(void);
+void colstore_txn_abort(void);
+
+// ------------------ Kernels (ts = epoch em segundos) ------------------
+// Volume (reps * weight) e nº de sets do user com from_ts <= ts < to_ts
+double colstore_volume(int user_id, int64_t from_ts, int64_t to_ts, long long *sets);
+
+// Máximos por exercício (arrays com n_ex posições, índice = exercise_id).
+// Exercícios sem sets ficam a 0. Retorna o nº de sets percorridos.
+long long colstore_max_by_exercise(int user_id, int n_ex, double *max_weight,
+                                   int *max_reps, double *max_volume);
+
+enum { COLSTORE_WEIGHT = 0, COLSTORE_REPS = 1 };
+
+// Histograma de weight/reps de um exercício (ts >= from_ts) em "bins"
+// intervalos iguais entre o mínimo e o máximo. Retorna o nº de sets.
+long long colstore_histogram(int user_id, int exercise_id, int metric, int64_t from_ts,
+                             int bins, double *lo, double *width, unsigned *counts);
+
+// Contadores (para /health)
+void colstore_stats(long long *sets, int *users);
+
+#endif
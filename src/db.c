@@ -1,9 +1,135 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include <windows.h>
+
 #include "db.h"
+#include "stmtcache.h"
+#include "worker.h"
+#include "queries.h"
+
+// Ligação da thread atual (event loop, leitor ou writer do executor)
+WORKER_LOCAL sqlite3 *db = NULL;
+
+static struct db_config s_cfg;
+
+// Checkpointer do WAL (thread + ligação própria)
+static sqlite3 *s_ckpt_db = NULL;
+static HANDLE s_ckpt_thread = NULL;
+static CRITICAL_SECTION s_ckpt_lock;
+static CONDITION_VARIABLE s_ckpt_cv;
+static int s_ckpt_stop = 0;
+static int s_ckpt_pending = 0;
+static unsigned long s_ckpt_count = 0;
+static int s_wal_frames = 0;
+static int s_wal_backfilled = 0;   // frames já copiados no último checkpoint
+
+// ======================================================
+// Configuração
+// ======================================================
+void db_config_defaults(struct db_config *cfg) {
+  cfg->path = "db/gym.db";
+  cfg->journal_mode = "WAL";
+  cfg->synchronous = "NORMAL";     // em WAL não perde commits em crash da app, só em falha de energia
+  cfg->temp_store = "MEMORY";
+  cfg->mmap_size = 256LL * 1024 * 1024;
+  cfg->cache_size = -16000;        // ~16 MB por ligação
+  cfg->busy_timeout_ms = 5000;
+  cfg->read_conns = 4;
+  cfg->checkpoint_pages = 1000;    // = wal_autocheckpoint default do SQLite
+  cfg->checkpoint_truncate_pages = 16000;
+  cfg->checkpoint_interval_ms = 30000;
+}
+
+static void env_int(const char *name, int *out) {
+  const char *v = getenv(name);
+  if (v && *v) *out = atoi(v);
+}
+
+// Só aceita palavras (os valores vão parar a um PRAGMA)
+static void env_word(const char *name, const char **out) {
+  const char *v = getenv(name);
+  if (!v || !*v) return;
+  for (const char *p = v; *p; p++) {
+    if (!isalnum((unsigned char) *p)) {
+      printf("Ignorado %s=%s (valor inválido)\n", name, v);
+      return;
+    }
+  }
+  *out = v;
+}
+
+void db_config_from_env(struct db_config *cfg) {
+  const char *path = getenv("GYM_DB_PATH");
+  if (path && *path) cfg->path = path;
 
-// Handle global da base de dados
-sqlite3 *db = NULL;
+  env_word("GYM_DB_JOURNAL_MODE", &cfg->journal_mode);
+  env_word("GYM_DB_SYNCHRONOUS", &cfg->synchronous);
+  env_word("GYM_DB_TEMP_STORE", &cfg->temp_store);
+
+  const char *mmap = getenv("GYM_DB_MMAP_SIZE");
+  if (mmap && *mmap) cfg->mmap_size = atoll(mmap);
+
+  env_int("GYM_DB_CACHE_SIZE", &cfg->cache_size);
+  env_int("GYM_DB_BUSY_TIMEOUT_MS", &cfg->busy_timeout_ms);
+  env_int("GYM_DB_READ_CONNS", &cfg->read_conns);
+  env_int("GYM_DB_CHECKPOINT_PAGES", &cfg->checkpoint_pages);
+  env_int("GYM_DB_CHECKPOINT_TRUNCATE_PAGES", &cfg->checkpoint_truncate_pages);
+  env_int("GYM_DB_CHECKPOINT_INTERVAL_MS", &cfg->checkpoint_interval_ms);
+}
+
+// ======================================================
+// Pragmas por ligação
+// ======================================================
+static int db_pragma(sqlite3 *conn, const char *sql) {
+  char *err = NULL;
+  int rc = sqlite3_exec(conn, sql, NULL, NULL, &err);
+  if (rc != SQLITE_OK) {
+    printf("Erro em \"%s\": %s\n", sql, err ? err : "?");
+    sqlite3_free(err);
+    return 0;
+  }
+  return 1;
+}
+
+static void db_apply_pragmas(sqlite3 *conn, int writer) {
+  char sql[128];
+
+  sqlite3_busy_timeout(conn, s_cfg.busy_timeout_ms);
+
+  if (writer) {
+    snprintf(sql, sizeof(sql), "PRAGMA journal_mode = %s;", s_cfg.journal_mode);
+    db_pragma(conn, sql);
+    snprintf(sql, sizeof(sql), "PRAGMA synchronous = %s;", s_cfg.synchronous);
+    db_pragma(conn, sql);
+    // Depois de um checkpoint completo o WAL é encolhido até este tamanho (páginas de 4 KiB)
+    snprintf(sql, sizeof(sql), "PRAGMA journal_size_limit = %lld;",
+             (long long) s_cfg.checkpoint_pages * 4096);
+    db_pragma(conn, sql);
+  }
+
+  snprintf(sql, sizeof(sql), "PRAGMA temp_store = %s;", s_cfg.temp_store);
+  db_pragma(conn, sql);
+  snprintf(sql, sizeof(sql), "PRAGMA mmap_size = %lld;", s_cfg.mmap_size);
+  db_pragma(conn, sql);
+  snprintf(sql, sizeof(sql), "PRAGMA cache_size = %d;", s_cfg.cache_size);
+  db_pragma(conn, sql);
+}
+
+static int db_is_wal(void) {
+  sqlite3_stmt *stmt = NULL;
+  int wal = 0;
+  if (sqlite3_prepare_v2(db, "PRAGMA journal_mode;", -1, &stmt, NULL) == SQLITE_OK && stmt) {
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      const unsigned char *mode = sqlite3_column_text(stmt, 0);
+      wal = mode && strcmp((const char *) mode, "wal") == 0;
+    }
+  }
+  sqlite3_finalize(stmt);
+  return wal;
+}
 
 // ======================================================
 // Seed admin (INTERNO ao db.c)
@@ -56,21 +182,123 @@ static void db_seed_admin(void) {
 }
 
 // ======================================================
-// Init DB
+// Migrações (PRAGMA user_version)
+// Cada migração corre numa transação e só se user_version < version.
+// Manter a ordem; nunca alterar uma migração já publicada, criar outra.
+// O SQL deve ser idempotente (IF NOT EXISTS) para BDs criadas antes do runner.
 // ======================================================
-void db_init(void) {
-  int rc;
-  char *err = NULL;
+struct migration {
+  int version;
+  const char *name;
+  const char *sql;
+};
 
-  rc = sqlite3_open("db/gym.db", &db);
-  if (rc != SQLITE_OK) {
-    printf("Erro ao abrir BD: %s\n", sqlite3_errmsg(db));
-    sqlite3_close(db);
-    db = NULL;
-    return;
-  }
+// Migração 3 (daily_volume): soma/subtrai um set ao dia do seu workout.
+// Não alterar (uma migração publicada não muda, criar outra).
+#define DV_SET_DELTA(op, reps, weight, workout_id) \
+    "  UPDATE daily_volume SET volume = volume " op " " reps " * " weight ", set_count = set_count " op " 1 " \
+    "  WHERE (user_id, day) = (SELECT user_id, date(created_at) FROM workouts WHERE id = " workout_id "); "
+
+// Migrações 4 e 6: só o set novo / alterado
+#define SET_BY_ID(id) \
+    "  WHERE we.id = " id " "
 
-  const char *sql =
+// Migração 4 (personal_records): INSERT a partir de sets + upsert que
+// guarda o máximo de cada métrica. Partilhado pelos triggers; não alterar
+// (uma migração publicada não muda, criar outra).
+#define PR_INSERT_FROM_SETS \
+    "  INSERT INTO personal_records(user_id, exercise_id, " \
+    "    max_weight, max_weight_set_id, max_weight_at, " \
+    "    max_reps, max_reps_set_id, max_reps_at, " \
+    "    max_volume, max_volume_set_id, max_volume_at) " \
+    "  SELECT w.user_id, we.exercise_id, " \
+    "    we.weight, we.id, w.created_at, " \
+    "    we.reps, we.id, w.created_at, " \
+    "    we.reps * we.weight, we.id, w.created_at " \
+    "  FROM workouts w JOIN workout_exercises we ON we.workout_id = w.id "
+
+// Sets do user para esse exercício, por id (replay do recordista).
+// "+we.exercise_id": percorrer os workouts do user, não todos os sets do exercício.
+#define PR_USER_SETS(user, exercise) \
+    "  WHERE w.user_id = " user " " \
+    "    AND +we.exercise_id = " exercise " " \
+    "  ORDER BY we.id "
+
+#define PR_UPSERT \
+    "  ON CONFLICT(user_id, exercise_id) DO UPDATE SET " \
+    "    max_weight_set_id = CASE WHEN excluded.max_weight > max_weight THEN excluded.max_weight_set_id ELSE max_weight_set_id END, " \
+    "    max_weight_at     = CASE WHEN excluded.max_weight > max_weight THEN excluded.max_weight_at ELSE max_weight_at END, " \
+    "    max_weight        = MAX(max_weight, excluded.max_weight), " \
+    "    max_reps_set_id   = CASE WHEN excluded.max_reps > max_reps THEN excluded.max_reps_set_id ELSE max_reps_set_id END, " \
+    "    max_reps_at       = CASE WHEN excluded.max_reps > max_reps THEN excluded.max_reps_at ELSE max_reps_at END, " \
+    "    max_reps          = MAX(max_reps, excluded.max_reps), " \
+    "    max_volume_set_id = CASE WHEN excluded.max_volume > max_volume THEN excluded.max_volume_set_id ELSE max_volume_set_id END, " \
+    "    max_volume_at     = CASE WHEN excluded.max_volume > max_volume THEN excluded.max_volume_at ELSE max_volume_at END, " \
+    "    max_volume        = MAX(max_volume, excluded.max_volume)"
+
+// Migração 5 (volume_rollup): escalões semana/mês/ano derivados do
+// daily_volume. O período é o 1º dia do bucket (semana começa à segunda).
+// Não alterar (idem).
+#define VR_BUCKETS \
+    "(SELECT 'week' AS bucket UNION ALL SELECT 'month' UNION ALL SELECT 'year') b "
+#define VR_PERIOD(day) \
+    "CASE b.bucket WHEN 'week' THEN date(" day ", 'weekday 0', '-6 days') " \
+    "WHEN 'month' THEN strftime('%Y-%m-01', " day ") " \
+    "ELSE strftime('%Y-01-01', " day ") END"
+// Soma um delta (volume, sets, workouts) aos 3 escalões do dia
+#define VR_ADD(user, day, volume, sets, workouts) \
+    "  INSERT INTO volume_rollup(user_id, bucket, period, volume, set_count, workout_count) " \
+    "  SELECT " user ", b.bucket, " VR_PERIOD(day) ", " volume ", " sets ", " workouts " " \
+    "  FROM " VR_BUCKETS "WHERE 1 " \
+    "  ON CONFLICT(user_id, bucket, period) DO UPDATE SET " \
+    "    volume = volume + excluded.volume, " \
+    "    set_count = set_count + excluded.set_count, " \
+    "    workout_count = workout_count + excluded.workout_count; "
+
+// Migração 6 (daily_e1rm): melhor 1RM estimado por (user, exercício, dia).
+//   Epley:   weight * (1 + reps/30)
+//   Brzycki: weight * 36 / (37 - reps)   (0 a partir de 37 reps: sem estimativa)
+// Com 1 rep as duas dão o próprio peso. Não alterar (idem).
+#define E1RM_INSERT_FROM_SETS \
+    "  INSERT INTO daily_e1rm(user_id, exercise_id, day, " \
+    "    epley, epley_set_id, brzycki, brzycki_set_id) " \
+    "  SELECT w.user_id, we.exercise_id, date(w.created_at), " \
+    "    CASE WHEN we.reps = 1 THEN we.weight ELSE we.weight * (1 + we.reps / 30.0) END, we.id, " \
+    "    CASE WHEN we.reps < 37 THEN we.weight * 36.0 / (37 - we.reps) ELSE 0 END, we.id " \
+    "  FROM workouts w JOIN workout_exercises we ON we.workout_id = w.id "
+
+#define E1RM_UPSERT \
+    "  ON CONFLICT(user_id, exercise_id, day) DO UPDATE SET " \
+    "    epley_set_id   = CASE WHEN excluded.epley > epley THEN excluded.epley_set_id ELSE epley_set_id END, " \
+    "    epley          = MAX(epley, excluded.epley), " \
+    "    brzycki_set_id = CASE WHEN excluded.brzycki > brzycki THEN excluded.brzycki_set_id ELSE brzycki_set_id END, " \
+    "    brzycki        = MAX(brzycki, excluded.brzycki)"
+
+// Sets do user nesse dia para esse exercício (idx_workouts_user_created)
+#define E1RM_DAY_SETS(user, exercise, day) \
+    "  WHERE w.user_id = " user " " \
+    "    AND w.created_at >= " day " AND w.created_at < date(" day ", '+1 day') " \
+    "    AND +we.exercise_id = " exercise " " \
+    "  ORDER BY we.id "
+
+// Set OLD era recordista do dia: apagar a linha e recalcular com os sets que restam
+#define E1RM_OLD_HOLDER \
+    "WHEN EXISTS (SELECT 1 FROM daily_e1rm " \
+    "             WHERE (user_id, day) = (SELECT user_id, date(created_at) FROM workouts WHERE id = OLD.workout_id) " \
+    "               AND exercise_id = OLD.exercise_id " \
+    "               AND OLD.id IN (epley_set_id, brzycki_set_id)) " \
+    "BEGIN " \
+    "  DELETE FROM daily_e1rm " \
+    "  WHERE (user_id, day) = (SELECT user_id, date(created_at) FROM workouts WHERE id = OLD.workout_id) " \
+    "    AND exercise_id = OLD.exercise_id; " \
+    E1RM_INSERT_FROM_SETS \
+    E1RM_DAY_SETS("(SELECT user_id FROM workouts WHERE id = OLD.workout_id)", "OLD.exercise_id", \
+                  "(SELECT date(created_at) FROM workouts WHERE id = OLD.workout_id)") \
+    E1RM_UPSERT \
+    "; END;"
+
+static const struct migration MIGRATIONS[] = {
+  { 1, "schema base",
     "CREATE TABLE IF NOT EXISTS exercises ("
     "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
     "  name TEXT NOT NULL"
@@ -109,18 +337,594 @@ void db_init(void) {
     "  created_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
     "  expires_at DATETIME,"
     "  FOREIGN KEY(user_id) REFERENCES users(id)"
-    ");";
+    ");"
+  },
+
+  { 2, "indices dos caminhos quentes",
+    // Listagem paginada e ownership por user (rowid vem incluído no índice)
+    "CREATE INDEX IF NOT EXISTS idx_workouts_user_id ON workouts(user_id);"
+    // Janelas temporais (stats)
+    "CREATE INDEX IF NOT EXISTS idx_workouts_created_at ON workouts(created_at);"
+    "CREATE INDEX IF NOT EXISTS idx_workouts_user_created ON workouts(user_id, created_at);"
+    // Sets de um workout
+    "CREATE INDEX IF NOT EXISTS idx_we_workout_id ON workout_exercises(workout_id);"
+    // PRs por exercício: covering (não toca na tabela)
+    "CREATE INDEX IF NOT EXISTS idx_we_exercise_cover ON workout_exercises(exercise_id, weight, reps);"
+    // Limpeza / warm-up de sessões
+    "CREATE INDEX IF NOT EXISTS idx_sessions_expires_at ON sessions(expires_at);"
+  },
+
+  { 3, "rollup daily_volume",
+    // Volume por user e dia (dia = date(workouts.created_at), UTC).
+    // workout_count mantém os dias com workouts sem sets (volume 0).
+    "CREATE TABLE IF NOT EXISTS daily_volume ("
+    "  user_id INTEGER NOT NULL,"
+    "  day TEXT NOT NULL,"
+    "  volume REAL NOT NULL DEFAULT 0,"
+    "  set_count INTEGER NOT NULL DEFAULT 0,"
+    "  workout_count INTEGER NOT NULL DEFAULT 0,"
+    "  PRIMARY KEY (user_id, day)"
+    ") WITHOUT ROWID;"
+
+    // Mantido por triggers: cobre todos os caminhos de escrita (sets, batch, delete workout)
+    "CREATE TRIGGER IF NOT EXISTS trg_dv_workout_insert AFTER INSERT ON workouts BEGIN "
+    "  INSERT INTO daily_volume(user_id, day, workout_count) "
+    "  VALUES (NEW.user_id, date(NEW.created_at), 1) "
+    "  ON CONFLICT(user_id, day) DO UPDATE SET workout_count = workout_count + 1; "
+    "END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_dv_workout_delete AFTER DELETE ON workouts BEGIN "
+    "  UPDATE daily_volume SET "
+    "    workout_count = workout_count - 1, "
+    "    volume = volume - (SELECT COALESCE(SUM(reps * weight), 0) FROM workout_exercises WHERE workout_id = OLD.id), "
+    "    set_count = set_count - (SELECT COUNT(*) FROM workout_exercises WHERE workout_id = OLD.id) "
+    "  WHERE user_id = OLD.user_id AND day = date(OLD.created_at); "
+    "  DELETE FROM daily_volume "
+    "  WHERE user_id = OLD.user_id AND day = date(OLD.created_at) AND workout_count <= 0; "
+    "END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_dv_set_insert AFTER INSERT ON workout_exercises BEGIN "
+    DV_SET_DELTA("+", "NEW.reps", "NEW.weight", "NEW.workout_id")
+    "END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_dv_set_update AFTER UPDATE OF reps, weight, workout_id ON workout_exercises BEGIN "
+    DV_SET_DELTA("-", "OLD.reps", "OLD.weight", "OLD.workout_id")
+    DV_SET_DELTA("+", "NEW.reps", "NEW.weight", "NEW.workout_id")
+    "END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_dv_set_delete AFTER DELETE ON workout_exercises BEGIN "
+    DV_SET_DELTA("-", "OLD.reps", "OLD.weight", "OLD.workout_id")
+    "END;"
+
+    // Dados existentes
+    "DELETE FROM daily_volume;"
+    "INSERT INTO daily_volume(user_id, day, volume, set_count, workout_count) "
+    "SELECT w.user_id, date(w.created_at), "
+    "       COALESCE(SUM(s.volume), 0), COALESCE(SUM(s.sets), 0), COUNT(*) "
+    "FROM workouts w "
+    "LEFT JOIN (SELECT workout_id, SUM(reps * weight) AS volume, COUNT(*) AS sets "
+    "           FROM workout_exercises GROUP BY workout_id) s ON s.workout_id = w.id "
+    "WHERE w.user_id IS NOT NULL "
+    "GROUP BY w.user_id, date(w.created_at);"
+  },
+
+  { 4, "tabela personal_records",
+    // Recorde por (user, exercício) com o set que o fez e a data do workout.
+    // Empates: fica o set mais antigo (só substitui com ">").
+    "CREATE TABLE IF NOT EXISTS personal_records ("
+    "  user_id INTEGER NOT NULL,"
+    "  exercise_id INTEGER NOT NULL,"
+    "  max_weight REAL NOT NULL,"
+    "  max_weight_set_id INTEGER NOT NULL,"
+    "  max_weight_at DATETIME,"
+    "  max_reps INTEGER NOT NULL,"
+    "  max_reps_set_id INTEGER NOT NULL,"
+    "  max_reps_at DATETIME,"
+    "  max_volume REAL NOT NULL,"
+    "  max_volume_set_id INTEGER NOT NULL,"
+    "  max_volume_at DATETIME,"
+    "  PRIMARY KEY (user_id, exercise_id)"
+    ") WITHOUT ROWID;"
+
+    // Novo set (ou set alterado): upsert com MAX por métrica
+    "CREATE TRIGGER IF NOT EXISTS trg_pr_set_insert AFTER INSERT ON workout_exercises BEGIN "
+    PR_INSERT_FROM_SETS
+    SET_BY_ID("NEW.id")
+    PR_UPSERT
+    "; END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_pr_set_update AFTER UPDATE OF reps, weight, exercise_id, workout_id "
+    "ON workout_exercises BEGIN "
+    PR_INSERT_FROM_SETS
+    SET_BY_ID("NEW.id")
+    PR_UPSERT
+    "; END;"
+
+    // O set alterado/apagado era o recordista: recalcular a linha a partir
+    // dos sets do user para esse exercício (replay pelo mesmo upsert, por id).
+    "CREATE TRIGGER IF NOT EXISTS trg_pr_set_update_holder AFTER UPDATE OF reps, weight, exercise_id, workout_id "
+    "ON workout_exercises "
+    "WHEN EXISTS (SELECT 1 FROM personal_records "
+    "             WHERE exercise_id = OLD.exercise_id "
+    "               AND user_id = (SELECT user_id FROM workouts WHERE id = OLD.workout_id) "
+    "               AND OLD.id IN (max_weight_set_id, max_reps_set_id, max_volume_set_id)) "
+    "BEGIN "
+    "  DELETE FROM personal_records "
+    "  WHERE exercise_id = OLD.exercise_id "
+    "    AND user_id = (SELECT user_id FROM workouts WHERE id = OLD.workout_id); "
+    PR_INSERT_FROM_SETS
+    PR_USER_SETS("(SELECT user_id FROM workouts WHERE id = OLD.workout_id)", "OLD.exercise_id")
+    PR_UPSERT
+    "; END;"
 
-  rc = sqlite3_exec(db, sql, NULL, NULL, &err);
+    "CREATE TRIGGER IF NOT EXISTS trg_pr_set_delete AFTER DELETE ON workout_exercises "
+    "WHEN EXISTS (SELECT 1 FROM personal_records "
+    "             WHERE exercise_id = OLD.exercise_id "
+    "               AND user_id = (SELECT user_id FROM workouts WHERE id = OLD.workout_id) "
+    "               AND OLD.id IN (max_weight_set_id, max_reps_set_id, max_volume_set_id)) "
+    "BEGIN "
+    "  DELETE FROM personal_records "
+    "  WHERE exercise_id = OLD.exercise_id "
+    "    AND user_id = (SELECT user_id FROM workouts WHERE id = OLD.workout_id); "
+    PR_INSERT_FROM_SETS
+    PR_USER_SETS("(SELECT user_id FROM workouts WHERE id = OLD.workout_id)", "OLD.exercise_id")
+    PR_UPSERT
+    "; END;"
+
+    // Workout apagado: os sets dele deixam de contar (mesma regra do daily_volume)
+    "CREATE TRIGGER IF NOT EXISTS trg_pr_workout_delete AFTER DELETE ON workouts BEGIN "
+    "  DELETE FROM personal_records "
+    "  WHERE user_id = OLD.user_id "
+    "    AND exercise_id IN (SELECT exercise_id FROM workout_exercises WHERE workout_id = OLD.id); "
+    PR_INSERT_FROM_SETS
+    "  WHERE w.user_id = OLD.user_id "
+    "    AND +we.exercise_id IN (SELECT exercise_id FROM workout_exercises WHERE workout_id = OLD.id) "
+    "  ORDER BY we.id "
+    PR_UPSERT
+    "; END;"
+
+    // Dados existentes
+    "DELETE FROM personal_records;"
+    PR_INSERT_FROM_SETS
+    "  WHERE w.user_id IS NOT NULL "
+    "  ORDER BY we.id "
+    PR_UPSERT
+    ";"
+  },
+
+  { 5, "rollups volume_rollup (semana/mês/ano)",
+    // Escalões grossos para /stats/volume com intervalos longos: o nº de
+    // linhas lidas é O(buckets), não O(dias). bucket = 'week'|'month'|'year'.
+    "CREATE TABLE IF NOT EXISTS volume_rollup ("
+    "  user_id INTEGER NOT NULL,"
+    "  bucket TEXT NOT NULL,"
+    "  period TEXT NOT NULL,"
+    "  volume REAL NOT NULL DEFAULT 0,"
+    "  set_count INTEGER NOT NULL DEFAULT 0,"
+    "  workout_count INTEGER NOT NULL DEFAULT 0,"
+    "  PRIMARY KEY (user_id, bucket, period)"
+    ") WITHOUT ROWID;"
+
+    // Triggers no daily_volume (e não nos sets): cada alteração de um dia
+    // propaga o delta da linha, por isso os escalões ficam sempre iguais à
+    // soma dos dias, qualquer que seja o caminho de escrita.
+    "CREATE TRIGGER IF NOT EXISTS trg_vr_day_insert AFTER INSERT ON daily_volume BEGIN "
+    VR_ADD("NEW.user_id", "NEW.day", "NEW.volume", "NEW.set_count", "NEW.workout_count")
+    "END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_vr_day_update AFTER UPDATE ON daily_volume BEGIN "
+    VR_ADD("NEW.user_id", "NEW.day", "NEW.volume - OLD.volume",
+           "NEW.set_count - OLD.set_count", "NEW.workout_count - OLD.workout_count")
+    "END;"
+
+    // Dia removido (último workout do dia apagado): buckets sem workouts saem
+    "CREATE TRIGGER IF NOT EXISTS trg_vr_day_delete AFTER DELETE ON daily_volume BEGIN "
+    VR_ADD("OLD.user_id", "OLD.day", "-OLD.volume", "-OLD.set_count", "-OLD.workout_count")
+    "  DELETE FROM volume_rollup "
+    "  WHERE user_id = OLD.user_id AND workout_count <= 0 "
+    "    AND (bucket, period) IN (SELECT b.bucket, " VR_PERIOD("OLD.day") " FROM " VR_BUCKETS "); "
+    "END;"
+
+    // Dados existentes
+    "DELETE FROM volume_rollup;"
+    "INSERT INTO volume_rollup(user_id, bucket, period, volume, set_count, workout_count) "
+    "SELECT d.user_id, b.bucket, " VR_PERIOD("d.day") " AS period, "
+    "       SUM(d.volume), SUM(d.set_count), SUM(d.workout_count) "
+    "FROM daily_volume d, " VR_BUCKETS
+    "GROUP BY d.user_id, b.bucket, period;"
+  },
+
+  { 6, "tabela daily_e1rm",
+    // Série de 1RM estimado para /stats/e1rm: um ponto por dia com sets do
+    // exercício, mantido pelos triggers (a leitura não toca nos sets).
+    "CREATE TABLE IF NOT EXISTS daily_e1rm ("
+    "  user_id INTEGER NOT NULL,"
+    "  exercise_id INTEGER NOT NULL,"
+    "  day TEXT NOT NULL,"
+    "  epley REAL NOT NULL,"
+    "  epley_set_id INTEGER NOT NULL,"
+    "  brzycki REAL NOT NULL,"
+    "  brzycki_set_id INTEGER NOT NULL,"
+    "  PRIMARY KEY (user_id, exercise_id, day)"
+    ") WITHOUT ROWID;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_e1rm_set_insert AFTER INSERT ON workout_exercises BEGIN "
+    E1RM_INSERT_FROM_SETS
+    SET_BY_ID("NEW.id")
+    E1RM_UPSERT
+    "; END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_e1rm_set_update AFTER UPDATE OF reps, weight, exercise_id, workout_id "
+    "ON workout_exercises BEGIN "
+    E1RM_INSERT_FROM_SETS
+    SET_BY_ID("NEW.id")
+    E1RM_UPSERT
+    "; END;"
+
+    "CREATE TRIGGER IF NOT EXISTS trg_e1rm_set_update_holder AFTER UPDATE OF reps, weight, exercise_id, workout_id "
+    "ON workout_exercises "
+    E1RM_OLD_HOLDER
+
+    "CREATE TRIGGER IF NOT EXISTS trg_e1rm_set_delete AFTER DELETE ON workout_exercises "
+    E1RM_OLD_HOLDER
+
+    // Workout apagado: recalcular os dias/exercícios que ele tocava
+    "CREATE TRIGGER IF NOT EXISTS trg_e1rm_workout_delete AFTER DELETE ON workouts BEGIN "
+    "  DELETE FROM daily_e1rm "
+    "  WHERE user_id = OLD.user_id AND day = date(OLD.created_at) "
+    "    AND exercise_id IN (SELECT exercise_id FROM workout_exercises WHERE workout_id = OLD.id); "
+    E1RM_INSERT_FROM_SETS
+    "  WHERE w.user_id = OLD.user_id "
+    "    AND w.created_at >= date(OLD.created_at) AND w.created_at < date(OLD.created_at, '+1 day') "
+    "    AND +we.exercise_id IN (SELECT exercise_id FROM workout_exercises WHERE workout_id = OLD.id) "
+    "  ORDER BY we.id "
+    E1RM_UPSERT
+    "; END;"
+
+    // Dados existentes
+    "DELETE FROM daily_e1rm;"
+    E1RM_INSERT_FROM_SETS
+    "  WHERE w.user_id IS NOT NULL "
+    "  ORDER BY we.id "
+    E1RM_UPSERT
+    ";"
+  },
+
+  { 7, "índices de leaderboard em personal_records",
+    // Top-K por exercício: o índice já está ordenado pela métrica, por isso
+    // o leaderboard é um range scan de K entradas. Os triggers da migração 4
+    // mantêm-no (só a linha do (user, exercício) afetado muda; apagar o set
+    // recordista recalcula essa linha). Empates: o set mais antigo primeiro.
+    "CREATE INDEX IF NOT EXISTS idx_pr_board_weight "
+    "  ON personal_records(exercise_id, max_weight DESC, max_weight_set_id);"
+    "CREATE INDEX IF NOT EXISTS idx_pr_board_reps "
+    "  ON personal_records(exercise_id, max_reps DESC, max_reps_set_id);"
+    "CREATE INDEX IF NOT EXISTS idx_pr_board_volume "
+    "  ON personal_records(exercise_id, max_volume DESC, max_volume_set_id);"
+  },
+};
+
+static int db_user_version(void) {
+  sqlite3_stmt *stmt = NULL;
+  int v = -1;
+  if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) == SQLITE_OK && stmt) {
+    if (sqlite3_step(stmt) == SQLITE_ROW) v = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_finalize(stmt);
+  return v;
+}
+
+// Retorna 1 se a BD ficou na última versão, 0 se alguma migração falhou
+static int db_migrate(void) {
+  int current = db_user_version();
+  if (current < 0) {
+    printf("Erro ao ler user_version\n");
+    return 0;
+  }
+
+  size_t n = sizeof(MIGRATIONS) / sizeof(MIGRATIONS[0]);
+  for (size_t i = 0; i < n; i++) {
+    const struct migration *m = &MIGRATIONS[i];
+    if (m->version <= current) continue;
+
+    char *err = NULL;
+    char pragma[64];
+    snprintf(pragma, sizeof(pragma), "PRAGMA user_version = %d;", m->version);
+
+    int rc = sqlite3_exec(db, "BEGIN;", NULL, NULL, &err);
+    if (rc == SQLITE_OK) rc = sqlite3_exec(db, m->sql, NULL, NULL, &err);
+    if (rc == SQLITE_OK) rc = sqlite3_exec(db, pragma, NULL, NULL, &err);
+    if (rc == SQLITE_OK) rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, &err);
+
+    if (rc != SQLITE_OK) {
+      printf("Erro na migração %d (%s): %s\n", m->version, m->name, err ? err : "?");
+      sqlite3_free(err);
+      sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+      return 0;
+    }
+
+    printf("Migração %d aplicada: %s\n", m->version, m->name);
+  }
+
+  return 1;
+}
+
+// ======================================================
+// Regressão de planos: as queries quentes não podem fazer full scan.
+// allow_scan = alias/tabela que pode ser percorrida por inteiro (listagens,
+// resultados de subqueries com LIMIT)
+// ======================================================
+struct hot_query {
+  const char *name;
+  const char *sql;
+  const char *allow_scan;
+};
+
+static const struct hot_query HOT_QUERIES[] = {
+  { "auth_require_user",              SQL_SESSION_LOOKUP,    NULL },
+  { "GET /workouts",                  SQL_WORKOUTS_PAGE,     NULL },
+  { "workout ownership",              SQL_WORKOUT_OWNED,     NULL },
+  { "GET /workouts/:id",              SQL_WORKOUT_GET,       NULL },
+  { "GET /workouts/:id sets",         SQL_WORKOUT_SETS,      NULL },
+  { "PUT set",                        SQL_SET_UPDATE,        NULL },
+  { "DELETE set",                     SQL_SET_DELETE,        NULL },
+  { "GET /stats/volume",              SQL_VOLUME_DAILY,      "pts" },
+  { "GET /stats/volume (week/month/year)", SQL_VOLUME_ROLLUP, "pts" },
+  { "GET /stats/prs",                 SQL_PRS,               "e" },
+  { "GET /stats/e1rm",                SQL_E1RM_EPLEY,        "pts" },
+  { "GET /stats/e1rm (brzycki)",      SQL_E1RM_BRZYCKI,      "pts" },
+  { "GET /stats/histogram (range)",   SQL_HIST_RANGE("weight"), NULL },
+  { "GET /stats/histogram (bins)",    SQL_HIST_BINS("weight"),  NULL },
+  { "GET /leaderboards/:id (max_weight)", SQL_BOARD("max_weight"), NULL },
+  { "GET /leaderboards/:id (max_reps)",   SQL_BOARD("max_reps"),   NULL },
+  { "GET /leaderboards/:id (max_volume)", SQL_BOARD("max_volume"), NULL },
+  { "GET /admin/users",               SQL_ADMIN_USERS_PAGE,  NULL },
+  { "colstore: reler set no commit",  SQL_COLSTORE_SET,      NULL },
+
+  // Statements dos triggers, com NEW./OLD. trocados por parâmetros
+  { "trigger: set -> daily_volume",
+    DV_SET_DELTA("+", "?1", "?2", "?3"),
+    NULL },
+  { "trigger: daily_volume -> week/month/year",
+    VR_ADD("?1", "?2", "?3", "?4", "?5"),
+    "b" },
+  { "trigger: PR do set novo",
+    PR_INSERT_FROM_SETS SET_BY_ID("?1") PR_UPSERT ";",
+    NULL },
+  { "trigger: PR recompute",
+    PR_INSERT_FROM_SETS PR_USER_SETS("?1", "?2") PR_UPSERT ";",
+    NULL },
+  { "trigger: e1RM do set novo",
+    E1RM_INSERT_FROM_SETS SET_BY_ID("?1") E1RM_UPSERT ";",
+    NULL },
+  { "trigger: e1RM recompute",
+    E1RM_INSERT_FROM_SETS E1RM_DAY_SETS("?1", "?2", "?3") E1RM_UPSERT ";",
+    NULL },
+};
+
+int db_check_query_plans(void) {
+  int bad = 0;
+  size_t n = sizeof(HOT_QUERIES) / sizeof(HOT_QUERIES[0]);
+
+  for (size_t i = 0; i < n; i++) {
+    const struct hot_query *q = &HOT_QUERIES[i];
+
+    // Os upserts dos triggers passam de 1 KB
+    char *sql = sqlite3_mprintf("EXPLAIN QUERY PLAN %s", q->sql);
+    sqlite3_stmt *stmt = NULL;
+    int rc = sql ? sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) : SQLITE_NOMEM;
+    sqlite3_free(sql);
+    if (rc != SQLITE_OK || !stmt) {
+      printf("PLANO %s: erro a preparar (%s)\n", q->name, sqlite3_errmsg(db));
+      bad++;
+      continue;
+    }
+
+    // Coluna 3 = detail, ex.: "SCAN workouts" / "SEARCH w USING INDEX ..."
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      const char *detail = (const char *) sqlite3_column_text(stmt, 3);
+      if (!detail || strncmp(detail, "SCAN ", 5) != 0) continue;
+      if (strcmp(detail, "SCAN CONSTANT ROW") == 0) continue;   // SELECT sem FROM (VR_BUCKETS)
+
+      const char *table = detail + 5;
+      size_t tlen = strcspn(table, " ");
+      if (q->allow_scan && strlen(q->allow_scan) == tlen &&
+          strncmp(table, q->allow_scan, tlen) == 0) continue;
+
+      printf("PLANO %s: full scan -> %s\n", q->name, detail);
+      bad++;
+    }
+
+    sqlite3_finalize(stmt);
+  }
+
+  return bad;
+}
+
+// ======================================================
+// Checkpointer do WAL
+// O writer não faz checkpoints (o auto-checkpoint corria dentro do COMMIT,
+// no event loop). O wal_hook só avisa esta thread, que faz PASSIVE
+// (não bloqueia ninguém) e TRUNCATE quando o WAL passa do limite.
+// ======================================================
+static int db_wal_hook(void *arg, sqlite3 *conn, const char *name, int frames) {
+  (void) arg; (void) conn; (void) name;
+
+  EnterCriticalSection(&s_ckpt_lock);
+  s_wal_frames = frames;
+  if (frames < s_wal_backfilled) s_wal_backfilled = 0;   // o WAL recomeçou do início
+  // Só acorda quando há checkpoint_pages novas desde o último checkpoint
+  // (se um leitor impedir o checkpoint, não tenta outra vez a cada COMMIT)
+  if (frames - s_wal_backfilled >= s_cfg.checkpoint_pages && !s_ckpt_pending) {
+    s_ckpt_pending = 1;
+    WakeConditionVariable(&s_ckpt_cv);
+  }
+  LeaveCriticalSection(&s_ckpt_lock);
+
+  return SQLITE_OK;
+}
+
+static DWORD WINAPI checkpoint_main(LPVOID arg) {
+  (void) arg;
+
+  for (;;) {
+    EnterCriticalSection(&s_ckpt_lock);
+    if (!s_ckpt_stop && !s_ckpt_pending) {
+      // Acorda por pedido do wal_hook ou pelo intervalo (apanha o que ficou abaixo do limite)
+      SleepConditionVariableCS(&s_ckpt_cv, &s_ckpt_lock, (DWORD) s_cfg.checkpoint_interval_ms);
+    }
+    if (s_ckpt_stop) {
+      LeaveCriticalSection(&s_ckpt_lock);
+      return 0;
+    }
+    int frames = s_wal_frames;
+    int todo = frames - s_wal_backfilled;
+    s_ckpt_pending = 0;
+    LeaveCriticalSection(&s_ckpt_lock);
+
+    if (todo <= 0) continue;
+
+    int log = 0, done = 0;
+    int rc = sqlite3_wal_checkpoint_v2(s_ckpt_db, NULL, SQLITE_CHECKPOINT_PASSIVE, &log, &done);
+
+    // WAL grande demais: esperar pelos leitores e pôr o ficheiro a zero
+    if (rc == SQLITE_OK && log >= s_cfg.checkpoint_truncate_pages) {
+      rc = sqlite3_wal_checkpoint_v2(s_ckpt_db, NULL, SQLITE_CHECKPOINT_TRUNCATE, &log, &done);
+    }
+
+    EnterCriticalSection(&s_ckpt_lock);
+    if (rc == SQLITE_OK && log >= 0) {
+      s_ckpt_count++;
+      // Sem COMMITs entretanto: o WAL tem agora "log" frames (0 depois de TRUNCATE)
+      if (s_wal_frames == frames) {
+        s_wal_frames = log;
+        s_wal_backfilled = done;
+      }
+    }
+    LeaveCriticalSection(&s_ckpt_lock);
+  }
+}
+
+static void db_checkpointer_start(void) {
+  s_ckpt_stop = 0;
+  s_ckpt_pending = 0;
+
+  if (sqlite3_open_v2(s_cfg.path, &s_ckpt_db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
+    printf("Erro ao abrir ligação do checkpointer: %s\n", sqlite3_errmsg(s_ckpt_db));
+    sqlite3_close(s_ckpt_db);
+    s_ckpt_db = NULL;
+    return;
+  }
+  sqlite3_busy_timeout(s_ckpt_db, s_cfg.busy_timeout_ms);
+
+  // Força a ligação a abrir o WAL (senão o 1º checkpoint devolve log = -1)
+  db_pragma(s_ckpt_db, "SELECT 1 FROM sqlite_master LIMIT 1;");
+
+  s_ckpt_thread = CreateThread(NULL, 0, checkpoint_main, NULL, 0, NULL);
+  if (!s_ckpt_thread) {
+    printf("Erro ao criar thread do checkpointer (fica o auto-checkpoint)\n");
+    sqlite3_close(s_ckpt_db);
+    s_ckpt_db = NULL;
+    return;
+  }
+
+  // Substitui o auto-checkpoint do SQLite
+  sqlite3_wal_hook(db, db_wal_hook, NULL);
+}
+
+static void db_checkpointer_stop(void) {
+  if (!s_ckpt_thread) return;
+
+  sqlite3_wal_hook(db, NULL, NULL);
+
+  EnterCriticalSection(&s_ckpt_lock);
+  s_ckpt_stop = 1;
+  WakeAllConditionVariable(&s_ckpt_cv);
+  LeaveCriticalSection(&s_ckpt_lock);
+
+  WaitForSingleObject(s_ckpt_thread, INFINITE);
+  CloseHandle(s_ckpt_thread);
+  s_ckpt_thread = NULL;
+
+  sqlite3_close(s_ckpt_db);
+  s_ckpt_db = NULL;
+}
+
+void db_wal_stats(unsigned long *checkpoints, int *last_wal_frames) {
+  EnterCriticalSection(&s_ckpt_lock);
+  if (checkpoints) *checkpoints = s_ckpt_count;
+  if (last_wal_frames) *last_wal_frames = s_wal_frames;
+  LeaveCriticalSection(&s_ckpt_lock);
+}
+
+// ======================================================
+// Init DB
+// ======================================================
+void db_init(const struct db_config *cfg) {
+  int rc;
+
+  if (cfg) s_cfg = *cfg;
+  else db_config_defaults(&s_cfg);
+
+  InitializeCriticalSection(&s_ckpt_lock);
+  InitializeConditionVariable(&s_ckpt_cv);
+
+  rc = sqlite3_open(s_cfg.path, &db);
   if (rc != SQLITE_OK) {
-    printf("Erro SQL: %s\n", err);
-    sqlite3_free(err);
-  } else {
-    printf("BD pronta.\n");
-    printf("DEBUG: a correr seed admin...\n");
-    db_seed_admin();
-    printf("DEBUG: seed admin feito.\n");
+    printf("Erro ao abrir BD: %s\n", sqlite3_errmsg(db));
+    sqlite3_close(db);
+    db = NULL;
+    return;
+  }
+
+  db_apply_pragmas(db, 1);
+
+  if (!db_migrate()) {
+    sqlite3_close(db);
+    db = NULL;
+    return;
   }
+
+  int wal = db_is_wal();
+
+  // Leitores e checkpointer só depois das migrações (schema final)
+  if (wal) db_checkpointer_start();
+
+  printf("BD pronta (schema v%d, journal %s%s).\n",
+         db_user_version(), wal ? "WAL" : s_cfg.journal_mode,
+         s_ckpt_thread ? ", checkpointer" : "");
+  printf("DEBUG: a correr seed admin...\n");
+  db_seed_admin();
+  printf("DEBUG: seed admin feito.\n");
+}
+
+// ======================================================
+// Ligação de uma thread (as migrações já correram no db_init)
+// ======================================================
+int db_thread_open(int readonly) {
+  int flags = readonly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE;
+  if (sqlite3_open_v2(s_cfg.path, &db, flags, NULL) != SQLITE_OK) {
+    printf("Erro ao abrir BD: %s\n", sqlite3_errmsg(db));
+    sqlite3_close(db);
+    db = NULL;
+    return 0;
+  }
+  db_apply_pragmas(db, !readonly);
+  if (!readonly && s_ckpt_thread) sqlite3_wal_hook(db, db_wal_hook, NULL);
+  return 1;
+}
+
+void db_thread_close(void) {
+  if (!db) return;
+  sqlite3_wal_hook(db, NULL, NULL);
+  stmtcache_clear();
+  sqlite3_close(db);
+  db = NULL;
+}
+
+int db_is_busy(int rc) {
+  rc &= 0xFF;
+  return rc == SQLITE_BUSY || rc == SQLITE_LOCKED;
 }
 
 // ======================================================
@@ -128,6 +932,8 @@ void db_init(void) {
 // ======================================================
 void db_close(void) {
   if (db) {
+    db_checkpointer_stop();
+    stmtcache_clear();
     sqlite3_close(db);
     db = NULL;
   }
@@ -2,12 +2,50 @@
 #define DB_H
 
 #include "./libsqlite3/sqlite3.h"
+#include "worker.h"
 
-// Handle global da base de dados
-extern sqlite3 *db;
+// Ligação da thread atual (cada thread que usa SQLite tem a sua)
+extern WORKER_LOCAL sqlite3 *db;
 
-// Inicializa a base de dados (abre ficheiro e cria tabelas)
-void db_init(void);
+// Configuração da BD. Valores default em db_config_defaults,
+// podem ser alterados por variáveis de ambiente (db_config_from_env).
+struct db_config {
+  const char *path;             // GYM_DB_PATH            (db/gym.db)
+  const char *journal_mode;     // GYM_DB_JOURNAL_MODE    (WAL)
+  const char *synchronous;      // GYM_DB_SYNCHRONOUS     (NORMAL)
+  const char *temp_store;       // GYM_DB_TEMP_STORE      (MEMORY)
+  long long mmap_size;          // GYM_DB_MMAP_SIZE       (bytes, 256 MiB)
+  int cache_size;               // GYM_DB_CACHE_SIZE      (PRAGMA cache_size, negativo = KiB)
+  int busy_timeout_ms;          // GYM_DB_BUSY_TIMEOUT_MS
+  int read_conns;               // GYM_DB_READ_CONNS      (leitores do dbexec, 0 = leituras no event loop)
+  int checkpoint_pages;         // GYM_DB_CHECKPOINT_PAGES (frames no WAL que acordam o checkpointer)
+  int checkpoint_truncate_pages;// GYM_DB_CHECKPOINT_TRUNCATE_PAGES (acima disto faz TRUNCATE)
+  int checkpoint_interval_ms;   // GYM_DB_CHECKPOINT_INTERVAL_MS
+};
+
+void db_config_defaults(struct db_config *cfg);
+void db_config_from_env(struct db_config *cfg);
+
+// Inicializa a base de dados (abre ficheiro, pragmas, migrações).
+// cfg = NULL usa os defaults.
+void db_init(const struct db_config *cfg);
+
+// Ligação própria da thread atual (db), com a mesma configuração do
+// db_init: event loops dos workers e threads do executor (dbexec.h).
+// readonly = 1 para os leitores. Retorna 1 se ok.
+int db_thread_open(int readonly);
+void db_thread_close(void);
+
+// SQLITE_BUSY / SQLITE_LOCKED (e os estendidos): a BD está ocupada, o
+// pedido em si pode estar certo. Responder 503, não 400/500.
+int db_is_busy(int rc);
+
+// Contadores do checkpointer do WAL (para /health)
+void db_wal_stats(unsigned long *checkpoints, int *last_wal_frames);
+
+// Corre EXPLAIN QUERY PLAN nas queries quentes e avisa de full scans.
+// Retorna o nº de planos com full scan (0 = ok)
+int db_check_query_plans(void);
 
 // Fecha a base de dados
 void db_close(void);
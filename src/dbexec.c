@@ -0,0 +1,501 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <windows.h>
+
+#include "dbexec.h"
+#include "db.h"
+#include "worker.h"
+#include "arena.h"
+
+#define DBEXEC_MAX_READERS 32
+#define DBEXEC_JOB_ARG     256            // capacidade mínima do arg de um job
+#define DBEXEC_POOL_MAX    32             // jobs livres guardados por worker
+#define DBEXEC_POOL_KEEP   (128 * 1024)   // buffers maiores não voltam ao pool
+
+static HANDLE s_readers[DBEXEC_MAX_READERS];
+static int s_nreaders = 0;
+static volatile long s_opened = 0, s_failed = 0;
+static int s_stop = 0;
+static int s_read_depth = DBEXEC_DEFAULT_READ_DEPTH;
+static int s_started = 0;
+
+// Fila de leituras (FIFO)
+static CRITICAL_SECTION s_lock;
+static CONDITION_VARIABLE s_cv;
+static struct dbexec_job *s_read_head = NULL, *s_read_tail = NULL;
+static int s_read_count = 0;
+
+// Respostas prontas, à espera do event loop da ligação
+static CRITICAL_SECTION s_done_lock;
+static struct dbexec_job *s_done = NULL;
+
+static volatile long s_reads = 0, s_rejected = 0;
+
+// Ligação "de papel" onde os handlers escrevem a resposta: só o send é usado
+static WORKER_LOCAL struct mg_connection s_shadow;
+
+// Jobs livres do worker, com os buffers do pedido e da resposta: um job é
+// sempre criado e libertado na thread do event loop da sua ligação
+static WORKER_LOCAL struct dbexec_job *s_pool = NULL;
+static WORKER_LOCAL int s_pool_count = 0;
+
+static void *job_arg(struct dbexec_job *job) {
+  return (char *) (job + 1);
+}
+
+// ======================================================
+// Jobs
+// ======================================================
+static void job_destroy(struct dbexec_job *job) {
+  mg_iobuf_free(&job->resp);
+  mg_free(job->req);
+  mg_free(job);
+}
+
+// Primeiro job livre com espaço para o arg, já limpo (buffers mantidos)
+static struct dbexec_job *pool_take(size_t arg_len) {
+  for (struct dbexec_job **pp = &s_pool; *pp; pp = &(*pp)->next) {
+    struct dbexec_job *job = *pp;
+    if (job->arg_size < arg_len) continue;
+    *pp = job->next;
+    s_pool_count--;
+
+    struct mg_iobuf resp = job->resp;
+    char *req = job->req;
+    size_t req_size = job->req_size, arg_size = job->arg_size;
+    memset(job, 0, sizeof(*job));
+    job->resp = resp;
+    job->resp.len = 0;
+    job->req = req;
+    job->req_size = req_size;
+    job->arg_size = arg_size;
+    return job;
+  }
+  return NULL;
+}
+
+struct dbexec_job *dbexec_job_new(struct mg_connection *c, struct mg_http_message *hm,
+                                  const void *arg, size_t arg_len) {
+  struct dbexec_job *job = pool_take(arg_len);
+  if (!job) {
+    size_t size = arg_len > DBEXEC_JOB_ARG ? arg_len : DBEXEC_JOB_ARG;
+    job = (struct dbexec_job *) mg_calloc(1, sizeof(*job) + size);
+    if (!job) return NULL;
+    job->arg_size = size;
+    job->resp.align = MG_IO_SIZE;
+  }
+  job->mgr = c->mgr;
+  job->conn_id = c->id;
+  job->arg_len = arg_len;
+  if (arg_len > 0) memcpy(job_arg(job), arg, arg_len);
+
+  struct mg_str *conn = hm ? mg_http_get_header(hm, "Connection") : NULL;
+  job->close = conn && mg_strcasecmp(*conn, mg_str("close")) == 0;
+  return job;
+}
+
+void dbexec_job_free(struct dbexec_job *job) {
+  if (s_pool_count >= DBEXEC_POOL_MAX) {
+    job_destroy(job);
+    return;
+  }
+  // Uma resposta muito grande não fica presa no pool
+  if (job->resp.size > DBEXEC_POOL_KEEP) mg_iobuf_free(&job->resp);
+  if (job->req_size > DBEXEC_POOL_KEEP) {
+    mg_free(job->req);
+    job->req = NULL;
+    job->req_size = 0;
+  }
+  job->next = s_pool;
+  s_pool = job;
+  s_pool_count++;
+}
+
+void dbexec_thread_free(void) {
+  while (s_pool) {
+    struct dbexec_job *next = s_pool->next;
+    job_destroy(s_pool);
+    s_pool = next;
+  }
+  s_pool_count = 0;
+}
+
+// As mg_str do hm passam a apontar para a cópia em job->req
+static void rebase_str(struct mg_str *s, const char *from, char *to) {
+  if (s->buf) s->buf = to + (s->buf - from);
+}
+
+static int copy_request(struct dbexec_job *job, struct mg_http_message *hm) {
+  if (job->req_size < hm->message.len + 1) {
+    size_t size = (hm->message.len + 1 + 1023) & ~(size_t) 1023;
+    char *req = (char *) mg_calloc(1, size);
+    if (!req) return 0;
+    mg_free(job->req);
+    job->req = req;
+    job->req_size = size;
+  }
+  memcpy(job->req, hm->message.buf, hm->message.len);
+  job->req[hm->message.len] = '\0';
+
+  const char *from = hm->message.buf;
+  job->hm = *hm;
+  rebase_str(&job->hm.method, from, job->req);
+  rebase_str(&job->hm.uri, from, job->req);
+  rebase_str(&job->hm.query, from, job->req);
+  rebase_str(&job->hm.proto, from, job->req);
+  for (int i = 0; i < MG_MAX_HTTP_HEADERS && job->hm.headers[i].name.len > 0; i++) {
+    rebase_str(&job->hm.headers[i].name, from, job->req);
+    rebase_str(&job->hm.headers[i].value, from, job->req);
+  }
+  rebase_str(&job->hm.body, from, job->req);
+  rebase_str(&job->hm.head, from, job->req);
+  rebase_str(&job->hm.message, from, job->req);
+  return 1;
+}
+
+// O handler escreve logo no buffer de resposta do job (que vem do pool com
+// a capacidade dos pedidos anteriores)
+static void shadow_begin(struct dbexec_job *job) {
+  memset(&s_shadow, 0, sizeof(s_shadow));
+  s_shadow.send = job->resp;
+  s_shadow.send.len = 0;
+  s_shadow.is_resp = 1;
+  s_shadow.id = job->conn_id;
+}
+
+static void shadow_take(struct dbexec_job *job) {
+  job->resp = s_shadow.send;
+  memset(&s_shadow.send, 0, sizeof(s_shadow.send));
+
+  // "HTTP/1.1 200 ..."
+  job->status = 0;
+  if (job->resp.len > 12 && memcmp(job->resp.buf, "HTTP/1.1 ", 9) == 0) {
+    job->status = atoi((const char *) job->resp.buf + 9);
+  }
+}
+
+int dbexec_job_run(struct dbexec_job *job) {
+  if (job->cfn) {
+    job->status = job->cfn(job_arg(job));
+    arena_reset();
+    return job->status;
+  }
+
+  shadow_begin(job);
+
+  if (job->fn) {
+    job->fn(&s_shadow, &job->hm, &job->rq);
+  } else {
+    struct writeq_result res = { 500, NULL };
+    job->wfn(job_arg(job), &res);
+    if (res.status == 204 || !res.body) {
+      mg_http_reply(&s_shadow, res.status, "", "");
+    } else {
+      mg_http_reply(&s_shadow, res.status, "Content-Type: application/json\r\n", "%s", res.body);
+    }
+  }
+
+  shadow_take(job);
+  if (job->status == 0) dbexec_job_fail(job, 500, "no response");
+  arena_reset();
+  return job->status;
+}
+
+void dbexec_job_fail(struct dbexec_job *job, int status, const char *error) {
+  shadow_begin(job);
+  mg_http_reply(&s_shadow, status, "Content-Type: application/json\r\n",
+                "{ \"error\": \"%s\" }\n", error);
+  shadow_take(job);
+}
+
+void dbexec_job_done(struct dbexec_job *job) {
+  EnterCriticalSection(&s_done_lock);
+  job->next = s_done;
+  s_done = job;
+  LeaveCriticalSection(&s_done_lock);
+
+  // Acorda o event loop; se a mensagem se perder, dbexec_poll trata
+  mg_wakeup(job->mgr, job->conn_id, "", 0);
+}
+
+// ======================================================
+// Leitores
+// ======================================================
+static DWORD WINAPI reader_main(LPVOID arg) {
+  (void) arg;
+  if (!db_thread_open(1)) {
+    InterlockedIncrement(&s_failed);
+    return 1;
+  }
+  InterlockedIncrement(&s_opened);
+
+  for (;;) {
+    EnterCriticalSection(&s_lock);
+    while (!s_stop && s_read_head == NULL) {
+      SleepConditionVariableCS(&s_cv, &s_lock, INFINITE);
+    }
+    if (s_stop) {
+      LeaveCriticalSection(&s_lock);
+      break;
+    }
+
+    struct dbexec_job *job = s_read_head;
+    s_read_head = job->next;
+    if (!s_read_head) s_read_tail = NULL;
+    s_read_count--;
+    LeaveCriticalSection(&s_lock);
+
+    job->next = NULL;
+    dbexec_job_run(job);
+    InterlockedIncrement(&s_reads);
+    dbexec_job_done(job);
+  }
+
+  db_thread_close();
+  arena_thread_free();
+  return 0;
+}
+
+static int read_push(struct dbexec_job *job) {
+  EnterCriticalSection(&s_lock);
+  if (s_stop || s_read_count >= s_read_depth) {
+    LeaveCriticalSection(&s_lock);
+    return 0;
+  }
+  job->next = NULL;
+  if (s_read_tail) s_read_tail->next = job;
+  else s_read_head = job;
+  s_read_tail = job;
+  s_read_count++;
+  WakeConditionVariable(&s_cv);
+  LeaveCriticalSection(&s_lock);
+  return 1;
+}
+
+// ======================================================
+// Init / stop
+// ======================================================
+int dbexec_init(int readers, int read_depth, int write_depth) {
+  if (readers < 0) readers = 0;
+  if (readers > DBEXEC_MAX_READERS) readers = DBEXEC_MAX_READERS;
+  s_read_depth = read_depth > 0 ? read_depth : DBEXEC_DEFAULT_READ_DEPTH;
+
+  s_stop = 0;
+  s_opened = s_failed = 0;
+  InitializeCriticalSection(&s_lock);
+  InitializeCriticalSection(&s_done_lock);
+  InitializeConditionVariable(&s_cv);
+  s_started = 1;
+
+  if (!writeq_start(write_depth)) {
+    printf("Erro ao arrancar o writer da BD\n");
+    dbexec_stop();
+    return 0;
+  }
+
+  for (int i = 0; i < readers; i++) {
+    s_readers[i] = CreateThread(NULL, 0, reader_main, NULL, 0, NULL);
+    if (!s_readers[i]) {
+      printf("Erro ao criar leitor da BD\n");
+      break;
+    }
+    s_nreaders++;
+  }
+
+  // Só retorna com as ligações abertas
+  while (s_opened + s_failed < s_nreaders) Sleep(1);
+  if (s_failed > 0 || s_nreaders < readers) {
+    dbexec_stop();
+    return 0;
+  }
+
+  printf("Executor da BD: %d leitores (fila %d), 1 writer (fila %d)\n", s_nreaders,
+         s_read_depth, write_depth > 0 ? write_depth : DBEXEC_DEFAULT_WRITE_DEPTH);
+  return 1;
+}
+
+static void free_list(struct dbexec_job *job) {
+  while (job) {
+    struct dbexec_job *next = job->next;
+    job_destroy(job);
+    job = next;
+  }
+}
+
+void dbexec_stop(void) {
+  if (!s_started) return;
+
+  EnterCriticalSection(&s_lock);
+  s_stop = 1;
+  WakeAllConditionVariable(&s_cv);
+  LeaveCriticalSection(&s_lock);
+
+  for (int i = 0; i < s_nreaders; i++) {
+    WaitForSingleObject(s_readers[i], INFINITE);
+    CloseHandle(s_readers[i]);
+  }
+  s_nreaders = 0;
+
+  // O writer faz commit do que ainda está na fila antes de parar
+  writeq_stop();
+
+  free_list(s_read_head);
+  free_list(s_done);
+  s_read_head = s_read_tail = s_done = NULL;
+  s_read_count = 0;
+
+  DeleteCriticalSection(&s_lock);
+  DeleteCriticalSection(&s_done_lock);
+  s_started = 0;
+}
+
+// ======================================================
+// Submit (thread do event loop)
+// ======================================================
+int dbexec_submit(struct mg_connection *c, int queue, struct mg_http_message *hm,
+                  const struct request_ctx *rq, dbexec_fn fn,
+                  dbexec_done_fn done, const void *ctx, size_t ctx_len) {
+  // Sem leitores: a leitura corre já, na ligação do event loop
+  if (queue == DBEXEC_READ && s_nreaders == 0) {
+    size_t start = c->send.len;
+    fn(c, hm, rq);
+    if (done) done(c, hm, start, (void *) ctx);
+    InterlockedIncrement(&s_reads);
+    return 1;
+  }
+
+  struct dbexec_job *job = dbexec_job_new(c, hm, ctx, ctx_len);
+  if (!job || !copy_request(job, hm)) {
+    if (job) dbexec_job_free(job);
+    InterlockedIncrement(&s_rejected);
+    return 0;
+  }
+  job->fn = fn;
+  job->done = done;
+  if (rq) job->rq = *rq;
+
+  int ok = queue == DBEXEC_READ ? read_push(job) : writeq_push(job);
+  if (!ok) {
+    dbexec_job_free(job);
+    InterlockedIncrement(&s_rejected);
+    return 0;
+  }
+  return 1;
+}
+
+int dbexec_call(struct mg_connection *c, struct mg_http_message *hm, dbexec_call_fn fn,
+                dbexec_then_fn then, void *arg, size_t arg_len) {
+  if (s_nreaders == 0) {
+    then(c, fn(arg), arg);
+    InterlockedIncrement(&s_reads);
+    return 1;
+  }
+
+  struct dbexec_job *job = dbexec_job_new(c, hm, arg, arg_len);
+  if (!job) {
+    InterlockedIncrement(&s_rejected);
+    return 0;
+  }
+  job->cfn = fn;
+  job->then = then;
+
+  if (!read_push(job)) {
+    dbexec_job_free(job);
+    InterlockedIncrement(&s_rejected);
+    return 0;
+  }
+  return 1;
+}
+
+// ======================================================
+// Completion (thread do event loop)
+// ======================================================
+
+// Retira da lista de prontos os jobs que satisfazem o filtro (por ordem de chegada)
+static struct dbexec_job *take_done(struct mg_mgr *mgr, unsigned long conn_id) {
+  struct dbexec_job *out = NULL;
+
+  EnterCriticalSection(&s_done_lock);
+  struct dbexec_job **pp = &s_done;
+  while (*pp) {
+    struct dbexec_job *job = *pp;
+    if (job->mgr == mgr && (conn_id == 0 || job->conn_id == conn_id)) {
+      *pp = job->next;
+      job->next = out;
+      out = job;
+    } else {
+      pp = &job->next;
+    }
+  }
+  LeaveCriticalSection(&s_done_lock);
+
+  return out;
+}
+
+static void complete(struct mg_connection *c, struct dbexec_job *job) {
+  if (c && !c->is_closing && job->then) {
+    // A resposta sai no then ou mais tarde (hashpool)
+    job->then(c, job->status, job_arg(job));
+    if (job->close && !c->is_resp) c->is_draining = 1;
+  } else if (c && !c->is_closing) {
+    size_t start = c->send.len;
+    mg_send(c, job->resp.buf, job->resp.len);
+    c->is_resp = 0;
+    if (job->done) job->done(c, &job->hm, start, job_arg(job));
+    if (job->close) c->is_draining = 1;
+  }
+  dbexec_job_free(job);
+}
+
+// O mongoose só retoma pedidos em pipeline se o is_resp mudar durante o
+// MG_EV_POLL da ligação; o wakeup chega noutra altura do loop
+static void resume(struct mg_connection *c) {
+  if (c && !c->is_closing && !c->is_draining && !c->is_resp && c->recv.len > 0) {
+    long n = 0;
+    mg_call(c, MG_EV_READ, &n);
+  }
+}
+
+void dbexec_on_wakeup(struct mg_connection *c) {
+  if (!s_started) return;
+
+  struct dbexec_job *job = take_done(c->mgr, c->id);
+  if (!job) return;
+  while (job) {
+    struct dbexec_job *next = job->next;
+    complete(c, job);
+    job = next;
+  }
+  resume(c);
+}
+
+void dbexec_poll(struct mg_mgr *mgr) {
+  if (!s_started) return;
+
+  struct dbexec_job *job = take_done(mgr, 0);
+  while (job) {
+    struct dbexec_job *next = job->next;
+    struct mg_connection *c = mgr->conns;
+    while (c && c->id != job->conn_id) c = c->next;
+    complete(c, job);
+    resume(c);
+    job = next;
+  }
+}
+
+void dbexec_stats(struct dbexec_stats *st) {
+  unsigned long batches = 0;
+  memset(st, 0, sizeof(*st));
+  st->readers = s_nreaders;
+  if (s_started && s_nreaders > 0) {
+    EnterCriticalSection(&s_lock);
+    st->read_queued = s_read_count;
+    LeaveCriticalSection(&s_lock);
+  }
+  st->write_queued = writeq_queued();
+  st->reads = (unsigned long) s_reads;
+  writeq_stats(&batches, &st->writes);
+  st->rejected = (unsigned long) s_rejected;
+}
@@ -0,0 +1,117 @@
+#ifndef DBEXEC_H
+#define DBEXEC_H
+
+#include "mongoose.h"
+#include "auth.h"
+#include "writeq.h"
+
+// Executor de BD: o SQLite dos handlers sai do event loop, para que uma
+// query lenta (stats, leaderboards) não pare as outras ligações.
+//   - leituras: pool de threads (GYM_DB_READ_CONNS), cada uma com a sua
+//     ligação só de leitura e a sua stmtcache
+//   - escritas: uma thread (o SQLite só tem um writer) com group commit,
+//     ver writeq.h
+// As duas filas são limitadas: com a fila cheia o submit retorna 0 e o
+// router responde 503.
+//
+// submit/complete: o router resolve a identidade e submete o handler com
+// uma cópia do pedido. O handler corre na thread do executor com um "c"
+// que só serve de buffer de resposta (c->send: mg_http_reply, json_begin,
+// mg_printf); não pode usar c->mgr, c->id nem submeter a outras filas. A
+// resposta volta por mg_wakeup e é enviada na thread do event loop, que
+// chama o done (cache de respostas, ETag). Até lá c->is_resp fica a 1 e o
+// mongoose não passa ao pedido seguinte da mesma ligação.
+
+enum { DBEXEC_READ = 0, DBEXEC_WRITE = 1 };
+
+#define DBEXEC_DEFAULT_READ_DEPTH  256
+#define DBEXEC_DEFAULT_WRITE_DEPTH 1024
+
+typedef void (*dbexec_fn)(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *rq);
+
+// Conclusão, na thread do event loop: a resposta já foi acrescentada ao
+// c->send a partir de "start". ctx = cópia dos bytes passados ao submit.
+typedef void (*dbexec_done_fn)(struct mg_connection *c, struct mg_http_message *hm,
+                               size_t start, void *ctx);
+
+// readers = nº de threads de leitura (0 = leituras no event loop, como
+// antes). depth = 0 usa os defaults. Arranca também o writer (writeq).
+// Retorna 1 se ok, 0 se falhou.
+int dbexec_init(int readers, int read_depth, int write_depth);
+void dbexec_stop(void);
+
+// Submete hm (copiado) a uma fila. done pode ser NULL. Retorna 1 se
+// aceite, 0 se a fila está cheia ou sem memória (nada foi escrito em c).
+int dbexec_submit(struct mg_connection *c, int queue, struct mg_http_message *hm,
+                  const struct request_ctx *rq, dbexec_fn fn,
+                  dbexec_done_fn done, const void *ctx, size_t ctx_len);
+
+// Leitura com continuação, para quando a resposta não sai logo da query
+// (p.ex. o login, que a seguir vai ao hashpool). fn corre num leitor sobre
+// a cópia de arg, pode escrever nela o resultado e retorna um status HTTP;
+// then corre depois na thread do event loop com esse status e a cópia, e
+// responde ou submete a outra fila. Sem leitores corre tudo já, sobre o
+// próprio arg. Retorna 0 se a fila está cheia (nada foi escrito em c).
+typedef int (*dbexec_call_fn)(void *arg);
+typedef void (*dbexec_then_fn)(struct mg_connection *c, int status, void *arg);
+int dbexec_call(struct mg_connection *c, struct mg_http_message *hm, dbexec_call_fn fn,
+                dbexec_then_fn then, void *arg, size_t arg_len);
+
+// MG_EV_WAKEUP: envia as respostas prontas desta ligação
+void dbexec_on_wakeup(struct mg_connection *c);
+
+// Chamar no loop de cada mg_mgr: respostas cujo wakeup se perdeu e jobs de
+// ligações que já fecharam
+void dbexec_poll(struct mg_mgr *mgr);
+
+// Contadores (para /health)
+struct dbexec_stats {
+  int readers;
+  int read_queued, write_queued;
+  unsigned long reads, writes;
+  unsigned long rejected;       // 503 por fila cheia
+};
+void dbexec_stats(struct dbexec_stats *st);
+
+// ------------------ Entre dbexec.c e writeq.c ------------------
+struct dbexec_job {
+  struct dbexec_job *next;
+  struct mg_mgr *mgr;           // ids das ligações só são únicos dentro de um mg_mgr
+  unsigned long conn_id;
+  int close;                    // pedido com "Connection: close"
+  int status;                   // status HTTP da resposta (depois de correr)
+  dbexec_fn fn;                 // handler (job do router)
+  writeq_fn wfn;                // ou job do writeq_submit
+  dbexec_call_fn cfn;           // ou job do dbexec_call (sem resposta, volta ao then)
+  dbexec_then_fn then;
+  struct request_ctx rq;
+  struct mg_http_message hm;    // aponta para req
+  char *req;                    // cópia do pedido (cabeçalhos + corpo)
+  size_t req_size;              // capacidade de req (mantida no pool)
+  struct mg_iobuf resp;         // resposta gerada na thread do executor
+  dbexec_done_fn done;
+  size_t arg_len, arg_size;     // seguido de arg_size bytes (ctx do done / arg do wfn)
+};
+
+// Jobs vêm de um pool por worker e voltam lá com os buffers, por isso em
+// regime estável um pedido ao executor não aloca. Só na thread do event
+// loop (jobs e buffers por mg_calloc, contados em alloc_stats).
+// hm = pedido que espera a resposta (só para o "Connection: close"), ou NULL.
+struct dbexec_job *dbexec_job_new(struct mg_connection *c, struct mg_http_message *hm,
+                                  const void *arg, size_t arg_len);
+void dbexec_job_free(struct dbexec_job *job);
+
+// Fim da thread do worker: liberta o pool
+void dbexec_thread_free(void);
+
+// Corre o job na thread atual; retorna o status HTTP da resposta
+int dbexec_job_run(struct dbexec_job *job);
+
+// Troca a resposta por um erro JSON (p.ex. o COMMIT do batch falhou)
+void dbexec_job_fail(struct dbexec_job *job, int status, const char *error);
+
+// Entrega a resposta ao event loop da ligação
+void dbexec_job_done(struct dbexec_job *job);
+
+#endif
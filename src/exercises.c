@@ -2,23 +2,28 @@
 #include <string.h>
 #include "exercises.h"
 #include "db.h"
+#include "stmtcache.h"
 #include "json.h"
+#include "respcache.h"
 
 // ================= GET /exercises =================
-void handle_get_exercises(struct mg_connection *c) {
+void handle_get_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *ctx) {
+  (void) hm;
+  (void) ctx;
   const char *sql = "SELECT id, name FROM exercises ORDER BY id;";
   sqlite3_stmt *stmt = NULL;
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || stmt == NULL) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
     return;
   }
 
-  char json[8192];
-  int pos = 0;
-  pos += snprintf(json + pos, sizeof(json) - pos, "[");
+  struct json_writer w;
+  json_begin(&w, c, 200);
+  json_printf(&w, "[");
 
   int first = 1;
   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
@@ -26,28 +31,24 @@ void handle_get_exercises(struct mg_connection *c) {
     const unsigned char *name_u = sqlite3_column_text(stmt, 1);
     const char *name = name_u ? (const char *)name_u : "";
 
-    char esc[1024];
-    if (!json_escape(name, esc, sizeof(esc))) esc[0] = '\0';
-
-    pos += snprintf(json + pos, sizeof(json) - pos,
-                    "%s{ \"id\": %d, \"name\": \"%s\" }",
-                    first ? "" : ",",
-                    id, esc);
+    json_printf(&w, "%s{ \"id\": %d, \"name\": %M }",
+                first ? "" : ",",
+                id, json_esc, name);
     first = 0;
-
-    if (pos > (int)sizeof(json) - 200) break;
   }
 
-  sqlite3_finalize(stmt);
-  pos += snprintf(json + pos, sizeof(json) - pos, "]\n");
+  stmtcache_release(stmt);
 
-  mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
+  json_printf(&w, "]\n");
+  json_end(&w);
 }
 
 // ================= GET /exercises/:id =================
-void handle_get_exercises_id(struct mg_connection *c, struct mg_http_message *hm) {
-  int id = -1;
-  if (sscanf(hm->uri.buf, "/exercises/%d", &id) != 1 || id <= 0) {
+void handle_get_exercises_id(struct mg_connection *c, struct mg_http_message *hm,
+                             const struct request_ctx *ctx) {
+  (void) hm;
+  int id = ctx->param[0];
+  if (id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid id\" }\n");
     return;
@@ -56,7 +57,7 @@ void handle_get_exercises_id(struct mg_connection *c, struct mg_http_message *hm
   const char *sql = "SELECT id, name FROM exercises WHERE id = ?;";
   sqlite3_stmt *stmt = NULL;
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || stmt == NULL) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
@@ -71,12 +72,9 @@ void handle_get_exercises_id(struct mg_connection *c, struct mg_http_message *hm
     const unsigned char *name_u = sqlite3_column_text(stmt, 1);
     const char *name = name_u ? (const char *)name_u : "";
 
-    char esc[1024];
-    if (!json_escape(name, esc, sizeof(esc))) esc[0] = '\0';
-
     mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-                  "{ \"id\": %d, \"name\": \"%s\" }\n",
-                  row_id, esc);
+                  "{ \"id\": %d, \"name\": %M }\n",
+                  row_id, json_esc, name);
   } else if (rc == SQLITE_DONE) {
     mg_http_reply(c, 404, "Content-Type: application/json\r\n",
                   "{ \"error\": \"not found\" }\n");
@@ -85,23 +83,21 @@ void handle_get_exercises_id(struct mg_connection *c, struct mg_http_message *hm
                   "{ \"error\": \"db step failed\" }\n");
   }
 
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 }
 
 // ================= POST /exercises =================
-void handle_post_exercises(struct mg_connection *c, struct mg_http_message *hm) {
+void handle_post_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                           const struct request_ctx *ctx) {
+  (void) ctx;
   if (hm->body.len == 0 || hm->body.len > 512) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid body\" }\n");
     return;
   }
 
-  char body[513];
-  memcpy(body, hm->body.buf, hm->body.len);
-  body[hm->body.len] = '\0';
-
-  char name[256];
-  if (!json_get_name(body, name, sizeof(name))) {
+  char *name = json_get_str(hm->body, "name", 255);
+  if (!name) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid json\" }\n");
     return;
@@ -110,7 +106,7 @@ void handle_post_exercises(struct mg_connection *c, struct mg_http_message *hm)
   const char *sql = "INSERT INTO exercises(name) VALUES (?);";
   sqlite3_stmt *stmt = NULL;
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || stmt == NULL) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
@@ -119,7 +115,7 @@ void handle_post_exercises(struct mg_connection *c, struct mg_http_message *hm)
 
   sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -128,37 +124,31 @@ void handle_post_exercises(struct mg_connection *c, struct mg_http_message *hm)
   }
 
   sqlite3_int64 id = sqlite3_last_insert_rowid(db);
-
-  char esc[1024];
-  if (!json_escape(name, esc, sizeof(esc))) esc[0] = '\0';
+  respcache_bump_exercises();
 
   mg_http_reply(c, 201, "Content-Type: application/json\r\n",
-                "{ \"id\": %lld, \"name\": \"%s\" }\n",
-                (long long)id, esc);
+                "{ \"id\": %lld, \"name\": %M }\n",
+                (long long)id, json_esc, name);
 }
 
 // ================= PUT /exercises/:id =================
-void handle_put_exercises(struct mg_connection *c,
-                          struct mg_http_message *hm) {
+void handle_put_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *ctx) {
   if (hm->body.len == 0 || hm->body.len > 512) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid body\" }\n");
     return;
   }
 
-  int id = -1;
-  if (sscanf(hm->uri.buf, "/exercises/%d", &id) != 1 || id <= 0) {
+  int id = ctx->param[0];
+  if (id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid id\" }\n");
     return;
   }
 
-  char body[513];
-  memcpy(body, hm->body.buf, hm->body.len);
-  body[hm->body.len] = '\0';
-
-  char name[256];
-  if (!json_get_name(body, name, sizeof(name))) {
+  char *name = json_get_str(hm->body, "name", 255);
+  if (!name) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid json\" }\n");
     return;
@@ -167,7 +157,7 @@ void handle_put_exercises(struct mg_connection *c,
   const char *sql = "UPDATE exercises SET name = ? WHERE id = ?;";
   sqlite3_stmt *stmt = NULL;
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || stmt == NULL) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
@@ -177,7 +167,7 @@ void handle_put_exercises(struct mg_connection *c,
   sqlite3_bind_text(stmt, 1, name, -1, SQLITE_TRANSIENT);
   sqlite3_bind_int(stmt, 2, id);
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -191,19 +181,19 @@ void handle_put_exercises(struct mg_connection *c,
     return;
   }
 
-  char esc[1024];
-  if (!json_escape(name, esc, sizeof(esc))) esc[0] = '\0';
+  respcache_bump_exercises();
 
   mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-                "{ \"id\": %d, \"name\": \"%s\" }\n",
-                id, esc);
+                "{ \"id\": %d, \"name\": %M }\n",
+                id, json_esc, name);
 }
 
 // ================= DELETE /exercises/:id =================
-void handle_delete_exercises(struct mg_connection *c,
-                             struct mg_http_message *hm) {
-  int id = -1;
-  if (sscanf(hm->uri.buf, "/exercises/%d", &id) != 1 || id <= 0) {
+void handle_delete_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                             const struct request_ctx *ctx) {
+  (void) hm;
+  int id = ctx->param[0];
+  if (id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid id\" }\n");
     return;
@@ -212,7 +202,7 @@ void handle_delete_exercises(struct mg_connection *c,
   const char *sql = "DELETE FROM exercises WHERE id = ?;";
   sqlite3_stmt *stmt = NULL;
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || stmt == NULL) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
@@ -221,7 +211,7 @@ void handle_delete_exercises(struct mg_connection *c,
 
   sqlite3_bind_int(stmt, 1, id);
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -235,5 +225,7 @@ void handle_delete_exercises(struct mg_connection *c,
     return;
   }
 
+  respcache_bump_exercises();
+
   mg_http_reply(c, 204, "", "");
 }
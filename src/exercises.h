@@ -2,24 +2,26 @@
 #define EXERCISES_H
 
 #include "mongoose.h"
+#include "auth.h"
 
 // GET /exercises
-void handle_get_exercises(struct mg_connection *c);
+void handle_get_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *ctx);
 
 // GET /exercises/:id
-void handle_get_exercises_id(struct mg_connection *c,
-                             struct mg_http_message *hm);
+void handle_get_exercises_id(struct mg_connection *c, struct mg_http_message *hm,
+                             const struct request_ctx *ctx);
 
 // POST /exercises
-void handle_post_exercises(struct mg_connection *c,
-                           struct mg_http_message *hm);
+void handle_post_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                           const struct request_ctx *ctx);
 
 // PUT /exercises/:id
-void handle_put_exercises(struct mg_connection *c,
-                          struct mg_http_message *hm);
+void handle_put_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *ctx);
 
 // DELETE /exercises/:id
-void handle_delete_exercises(struct mg_connection *c,
-                             struct mg_http_message *hm);
+void handle_delete_exercises(struct mg_connection *c, struct mg_http_message *hm,
+                             const struct request_ctx *ctx);
 
 #endif
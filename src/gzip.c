@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "gzip.h"
+#include "mongoose.h"
+
+#define WINDOW_SIZE 32768
+#define HASH_BITS   15
+#define HASH_SIZE   (1 << HASH_BITS)
+#define MIN_MATCH   3
+#define MAX_MATCH   258
+#define MAX_CHAIN   128     // candidatos por posição (compromisso tempo/ratio)
+
+static const unsigned short LEN_BASE[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char LEN_EXTRA[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short DIST_BASE[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char DIST_EXTRA[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// ======================================================
+// Escrita de bits (LSB primeiro, como o deflate)
+// ======================================================
+struct bitw {
+  unsigned char *buf;
+  size_t len, cap;
+  uint32_t bits;
+  int nbits;
+  int oom;
+};
+
+static void put_byte(struct bitw *w, unsigned char b) {
+  if (w->len == w->cap) {
+    size_t cap = w->cap ? w->cap * 2 : 1024;
+    unsigned char *p = (unsigned char *) realloc(w->buf, cap);
+    if (!p) {
+      w->oom = 1;
+      return;
+    }
+    w->buf = p;
+    w->cap = cap;
+  }
+  w->buf[w->len++] = b;
+}
+
+static void put_bits(struct bitw *w, uint32_t value, int n) {
+  w->bits |= value << w->nbits;
+  w->nbits += n;
+  while (w->nbits >= 8) {
+    put_byte(w, (unsigned char) (w->bits & 0xFF));
+    w->bits >>= 8;
+    w->nbits -= 8;
+  }
+}
+
+static void flush_bits(struct bitw *w) {
+  if (w->nbits > 0) put_byte(w, (unsigned char) (w->bits & 0xFF));
+  w->bits = 0;
+  w->nbits = 0;
+}
+
+// Os códigos Huffman vão do bit mais significativo para o menos
+static void put_code(struct bitw *w, uint32_t code, int n) {
+  uint32_t rev = 0;
+  for (int i = 0; i < n; i++) rev |= ((code >> i) & 1) << (n - 1 - i);
+  put_bits(w, rev, n);
+}
+
+// ======================================================
+// Códigos fixos (RFC 1951, 3.2.6)
+// ======================================================
+static void put_litlen(struct bitw *w, int sym) {
+  if (sym < 144) put_code(w, 0x30 + sym, 8);
+  else if (sym < 256) put_code(w, 0x190 + (sym - 144), 9);
+  else if (sym < 280) put_code(w, sym - 256, 7);
+  else put_code(w, 0xC0 + (sym - 280), 8);
+}
+
+static void put_literal(struct bitw *w, unsigned char b) {
+  put_litlen(w, b);
+}
+
+static void put_match(struct bitw *w, int len, int dist) {
+  int l = 28;
+  while (LEN_BASE[l] > len) l--;
+  put_litlen(w, 257 + l);
+  if (LEN_EXTRA[l]) put_bits(w, (uint32_t) (len - LEN_BASE[l]), LEN_EXTRA[l]);
+
+  int d = 29;
+  while (DIST_BASE[d] > dist) d--;
+  put_code(w, (uint32_t) d, 5);
+  if (DIST_EXTRA[d]) put_bits(w, (uint32_t) (dist - DIST_BASE[d]), DIST_EXTRA[d]);
+}
+
+// ======================================================
+// LZ77
+// ======================================================
+struct lz {
+  const unsigned char *in;
+  size_t len;
+  int *head;      // HASH_SIZE: última posição com esse hash
+  int *prev;      // WINDOW_SIZE: posição anterior com o mesmo hash
+};
+
+static unsigned hash3(const unsigned char *p) {
+  return ((unsigned) p[0] << 10 ^ (unsigned) p[1] << 5 ^ p[2]) & (HASH_SIZE - 1);
+}
+
+static void lz_insert(struct lz *z, size_t pos) {
+  if (pos + MIN_MATCH > z->len) return;
+  unsigned h = hash3(z->in + pos);
+  z->prev[pos & (WINDOW_SIZE - 1)] = z->head[h];
+  z->head[h] = (int) pos;
+}
+
+// Maior match para pos entre as posições já inseridas
+static int lz_longest(const struct lz *z, size_t pos, int *dist) {
+  if (pos + MIN_MATCH > z->len) return 0;
+
+  size_t max = z->len - pos;
+  if (max > MAX_MATCH) max = MAX_MATCH;
+
+  int best = 0;
+  int cand = z->head[hash3(z->in + pos)];
+  for (int chain = 0; cand >= 0 && chain < MAX_CHAIN; chain++) {
+    size_t d = pos - (size_t) cand;
+    if (d == 0 || d > WINDOW_SIZE) break;
+
+    const unsigned char *a = z->in + cand, *b = z->in + pos;
+    if (a[best] == b[best]) {
+      size_t n = 0;
+      while (n < max && a[n] == b[n]) n++;
+      if ((int) n > best) {
+        best = (int) n;
+        *dist = (int) d;
+        if (n == max) break;
+      }
+    }
+
+    int next = z->prev[cand & (WINDOW_SIZE - 1)];
+    if (next >= cand) break;   // entrada reciclada da janela
+    cand = next;
+  }
+  return best >= MIN_MATCH ? best : 0;
+}
+
+static int deflate_fixed(struct bitw *w, const unsigned char *in, size_t len) {
+  struct lz z;
+  z.in = in;
+  z.len = len;
+  z.head = (int *) malloc(HASH_SIZE * sizeof(int));
+  z.prev = (int *) malloc(WINDOW_SIZE * sizeof(int));
+  if (!z.head || !z.prev) {
+    free(z.head);
+    free(z.prev);
+    return 0;
+  }
+  memset(z.head, 0xFF, HASH_SIZE * sizeof(int));   // -1
+  memset(z.prev, 0xFF, WINDOW_SIZE * sizeof(int));
+
+  // Um só bloco final, códigos fixos: BFINAL = 1, BTYPE = 01
+  put_bits(w, 1, 1);
+  put_bits(w, 1, 2);
+
+  size_t pos = 0;
+  while (pos < len) {
+    int dist = 0;
+    int mlen = lz_longest(&z, pos, &dist);
+
+    // Lazy matching: se a posição seguinte tem um match maior, sai um literal
+    if (mlen > 0 && mlen < MAX_MATCH) {
+      lz_insert(&z, pos);
+      int dist2 = 0;
+      int mlen2 = lz_longest(&z, pos + 1, &dist2);
+      if (mlen2 > mlen) {
+        put_literal(w, in[pos]);
+        pos++;
+        continue;
+      }
+      put_match(w, mlen, dist);
+      for (size_t k = 1; k < (size_t) mlen; k++) lz_insert(&z, pos + k);
+      pos += (size_t) mlen;
+    } else if (mlen > 0) {
+      put_match(w, mlen, dist);
+      for (size_t k = 0; k < (size_t) mlen; k++) lz_insert(&z, pos + k);
+      pos += (size_t) mlen;
+    } else {
+      lz_insert(&z, pos);
+      put_literal(w, in[pos]);
+      pos++;
+    }
+  }
+
+  put_litlen(w, 256);   // fim do bloco
+  flush_bits(w);
+
+  free(z.head);
+  free(z.prev);
+  return !w->oom;
+}
+
+// ======================================================
+// gzip: header + deflate + CRC32 + tamanho
+// ======================================================
+int gzip_compress(const void *in, size_t len, unsigned char **out, size_t *out_len) {
+  static const unsigned char header[10] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 255 };
+  struct bitw w;
+  memset(&w, 0, sizeof(w));
+
+  *out = NULL;
+  *out_len = 0;
+
+  for (int i = 0; i < 10; i++) put_byte(&w, header[i]);
+  if (!deflate_fixed(&w, (const unsigned char *) in, len)) {
+    free(w.buf);
+    return 0;
+  }
+
+  uint32_t crc = mg_crc32(0, (const char *) in, len);
+  uint32_t size = (uint32_t) len;
+  for (int i = 0; i < 4; i++) put_byte(&w, (unsigned char) (crc >> (8 * i)));
+  for (int i = 0; i < 4; i++) put_byte(&w, (unsigned char) (size >> (8 * i)));
+  if (w.oom) {
+    free(w.buf);
+    return 0;
+  }
+
+  *out = w.buf;
+  *out_len = w.len;
+  return 1;
+}
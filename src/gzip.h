@@ -0,0 +1,13 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <stddef.h>
+
+// Compressão gzip (RFC 1952) sem dependências: LZ77 com hash chains e
+// blocos deflate com códigos Huffman fixos. Fica a ~10-20% do "gzip -9"
+// em texto; serve para pré-comprimir os assets uma vez no arranque.
+//
+// Retorna 1 e *out (malloc, libertar com free) / *out_len, 0 se falhou.
+int gzip_compress(const void *in, size_t len, unsigned char **out, size_t *out_len);
+
+#endif
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <windows.h>
+
+#include "hashpool.h"
+#include "password.h"
+
+#define HASHPOOL_MAX_THREADS 8
+#define HASHPOOL_MAX_PENDING 256
+
+enum { HASHPOOL_HASH = 1, HASHPOOL_VERIFY = 2 };
+
+struct hash_job {
+  int op;
+  struct mg_mgr *mgr;        // ids das ligações só são únicos dentro de um mg_mgr
+  unsigned long conn_id;
+  char password[256];
+  char stored[512];   // verify: hash guardado | hash: resultado
+  int ok;
+  hashpool_done_fn done;
+  void *ctx;
+  struct hash_job *next;
+};
+
+static HANDLE s_threads[HASHPOOL_MAX_THREADS];
+static int s_nthreads = 0;
+static int s_stop = 0;
+
+static CRITICAL_SECTION s_lock;
+static CONDITION_VARIABLE s_cv;
+
+// Fila de jobs por calcular (FIFO) e lista de jobs terminados
+static struct hash_job *s_pending_head = NULL, *s_pending_tail = NULL;
+static int s_pending_count = 0;
+static struct hash_job *s_done = NULL;
+
+static void job_free(struct hash_job *job) {
+  memset(job->password, 0, sizeof(job->password));
+  free(job);
+}
+
+// ======================================================
+// Worker
+// ======================================================
+static DWORD WINAPI worker_main(LPVOID arg) {
+  (void) arg;
+
+  for (;;) {
+    EnterCriticalSection(&s_lock);
+    while (!s_stop && s_pending_head == NULL) {
+      SleepConditionVariableCS(&s_cv, &s_lock, INFINITE);
+    }
+    if (s_stop) {
+      LeaveCriticalSection(&s_lock);
+      return 0;
+    }
+
+    struct hash_job *job = s_pending_head;
+    s_pending_head = job->next;
+    if (!s_pending_head) s_pending_tail = NULL;
+    s_pending_count--;
+    LeaveCriticalSection(&s_lock);
+
+    // Trabalho pesado fora do lock
+    if (job->op == HASHPOOL_VERIFY) {
+      job->ok = pwd_verify(job->password, job->stored);
+    } else {
+      job->ok = pwd_hash(job->password, job->stored, sizeof(job->stored));
+      if (!job->ok) job->stored[0] = '\0';
+    }
+    memset(job->password, 0, sizeof(job->password));
+
+    EnterCriticalSection(&s_lock);
+    job->next = s_done;
+    s_done = job;
+    LeaveCriticalSection(&s_lock);
+
+    // Acorda o event loop; se a mensagem se perder, hashpool_poll trata
+    mg_wakeup(job->mgr, job->conn_id, "", 0);
+  }
+}
+
+// ======================================================
+// Init / stop
+// ======================================================
+int hashpool_init(int nthreads) {
+  if (nthreads <= 0) {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    nthreads = (int) si.dwNumberOfProcessors - 1;
+    if (nthreads < 1) nthreads = 1;
+  }
+  if (nthreads > HASHPOOL_MAX_THREADS) nthreads = HASHPOOL_MAX_THREADS;
+
+  s_stop = 0;
+  InitializeCriticalSection(&s_lock);
+  InitializeConditionVariable(&s_cv);
+
+  for (int i = 0; i < nthreads; i++) {
+    s_threads[i] = CreateThread(NULL, 0, worker_main, NULL, 0, NULL);
+    if (!s_threads[i]) {
+      printf("Erro ao criar worker de hashing\n");
+      break;
+    }
+    s_nthreads++;
+  }
+
+  if (s_nthreads == 0) {
+    DeleteCriticalSection(&s_lock);
+    return 0;
+  }
+
+  printf("Hash pool: %d workers\n", s_nthreads);
+  return 1;
+}
+
+void hashpool_stop(void) {
+  if (s_nthreads == 0) return;
+
+  EnterCriticalSection(&s_lock);
+  s_stop = 1;
+  WakeAllConditionVariable(&s_cv);
+  LeaveCriticalSection(&s_lock);
+
+  for (int i = 0; i < s_nthreads; i++) {
+    WaitForSingleObject(s_threads[i], INFINITE);
+    CloseHandle(s_threads[i]);
+  }
+  s_nthreads = 0;
+
+  struct hash_job *lists[2] = { s_pending_head, s_done };
+  for (int i = 0; i < 2; i++) {
+    struct hash_job *job = lists[i];
+    while (job) {
+      struct hash_job *next = job->next;
+      free(job->ctx);
+      job_free(job);
+      job = next;
+    }
+  }
+  s_pending_head = s_pending_tail = s_done = NULL;
+  s_pending_count = 0;
+
+  DeleteCriticalSection(&s_lock);
+}
+
+// ======================================================
+// Submit
+// ======================================================
+static int submit(int op, struct mg_connection *c, const char *password,
+                  const char *stored, hashpool_done_fn done, void *ctx) {
+  if (s_nthreads == 0 || !password || strlen(password) >= 256) return 0;
+
+  struct hash_job *job = (struct hash_job *) calloc(1, sizeof(*job));
+  if (!job) return 0;
+
+  job->op = op;
+  job->mgr = c->mgr;
+  job->conn_id = c->id;
+  job->done = done;
+  job->ctx = ctx;
+  snprintf(job->password, sizeof(job->password), "%s", password);
+  if (stored) snprintf(job->stored, sizeof(job->stored), "%s", stored);
+
+  EnterCriticalSection(&s_lock);
+  if (s_pending_count >= HASHPOOL_MAX_PENDING) {
+    LeaveCriticalSection(&s_lock);
+    job_free(job);
+    return 0;
+  }
+  if (s_pending_tail) s_pending_tail->next = job;
+  else s_pending_head = job;
+  s_pending_tail = job;
+  s_pending_count++;
+  WakeConditionVariable(&s_cv);
+  LeaveCriticalSection(&s_lock);
+
+  return 1;
+}
+
+int hashpool_submit_hash(struct mg_connection *c, const char *password,
+                         hashpool_done_fn done, void *ctx) {
+  return submit(HASHPOOL_HASH, c, password, NULL, done, ctx);
+}
+
+int hashpool_submit_verify(struct mg_connection *c, const char *password,
+                           const char *stored, hashpool_done_fn done, void *ctx) {
+  return submit(HASHPOOL_VERIFY, c, password, stored, done, ctx);
+}
+
+// ======================================================
+// Completion (thread do event loop)
+// ======================================================
+
+// Retira da lista de terminados os jobs que satisfazem o filtro
+static struct hash_job *take_done(struct mg_mgr *mgr, unsigned long conn_id) {
+  struct hash_job *out = NULL;
+
+  EnterCriticalSection(&s_lock);
+  struct hash_job **pp = &s_done;
+  while (*pp) {
+    struct hash_job *job = *pp;
+    if (job->mgr == mgr && (conn_id == 0 || job->conn_id == conn_id)) {
+      *pp = job->next;
+      job->next = out;
+      out = job;
+    } else {
+      pp = &job->next;
+    }
+  }
+  LeaveCriticalSection(&s_lock);
+
+  return out;
+}
+
+static void complete(struct mg_connection *c, struct hash_job *job) {
+  if (c && !c->is_closing) {
+    job->done(c, job->ok, job->op == HASHPOOL_HASH ? job->stored : "", job->ctx);
+  } else {
+    free(job->ctx);
+  }
+  job_free(job);
+}
+
+void hashpool_on_wakeup(struct mg_connection *c) {
+  if (s_nthreads == 0) return;
+
+  struct hash_job *job = take_done(c->mgr, c->id);
+  while (job) {
+    struct hash_job *next = job->next;
+    complete(c, job);
+    job = next;
+  }
+}
+
+void hashpool_poll(struct mg_mgr *mgr) {
+  if (s_nthreads == 0) return;
+
+  struct hash_job *job = take_done(mgr, 0);
+  while (job) {
+    struct hash_job *next = job->next;
+    struct mg_connection *c = mgr->conns;
+    while (c && c->id != job->conn_id) c = c->next;
+    complete(c, job);
+    job = next;
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef HASHPOOL_H
+#define HASHPOOL_H
+
+#include "mongoose.h"
+
+// Pool de threads para PBKDF2 (pwd_hash / pwd_verify) fora do event loop.
+// Os workers só calculam hashes; o callback "done" corre sempre na thread
+// do mg_mgr_poll (via mg_wakeup), por isso pode usar SQLite e mg_http_reply.
+// Um só pool para todos os workers (--workers): cada job volta ao mg_mgr
+// da ligação que o submeteu.
+
+// ok = resultado (verify: password certa; hash: hash gerado)
+// hash = hash gerado (só para HASHPOOL_HASH, "" caso contrário)
+// ctx = ponteiro do handler (malloc), o callback é dono dele e faz free
+typedef void (*hashpool_done_fn)(struct mg_connection *c, int ok,
+                                 const char *hash, void *ctx);
+
+// Arranca N threads (0 = automático pelo nº de CPUs). Cada mg_mgr que
+// submete jobs precisa de mg_wakeup_init. Retorna 1 se ok, 0 se falhou.
+int hashpool_init(int nthreads);
+
+// Pára os workers e liberta jobs pendentes
+void hashpool_stop(void);
+
+// Submete jobs. Retorna 1 se aceite, 0 se a fila está cheia (responder 503).
+// Em caso de 0, ctx continua a ser do chamador.
+int hashpool_submit_hash(struct mg_connection *c, const char *password,
+                         hashpool_done_fn done, void *ctx);
+int hashpool_submit_verify(struct mg_connection *c, const char *password,
+                           const char *stored, hashpool_done_fn done, void *ctx);
+
+// MG_EV_WAKEUP: completa os jobs terminados desta ligação
+void hashpool_on_wakeup(struct mg_connection *c);
+
+// Chamar no loop de cada mg_mgr: completa os jobs dele cujo wakeup se
+// perdeu e liberta os de ligações que já fecharam
+void hashpool_poll(struct mg_mgr *mgr);
+
+#endif
@@ -1,13 +1,29 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include "mongoose.h"
 #include "http.h"
+#include "db.h"
 #include "exercises.h"
 #include "workouts.h"
 #include "stats.h"
 #include "admin.h"
 #include "auth.h"
+#include "hashpool.h"
+#include "stmtcache.h"
+#include "sesscache.h"
+#include "writeq.h"
+#include "colstore.h"
+#include "agg.h"
+#include "respcache.h"
+#include "assets.h"
+#include "sendfile.h"
+#include "worker.h"
+#include "dbexec.h"
+#include "router.h"
+#include "arena.h"
 
 // ---------- Helpers HTTP ----------
 int is_get(struct mg_http_message *hm)    { return mg_match(hm->method, mg_str("GET"), NULL); }
@@ -15,10 +31,148 @@ int is_post(struct mg_http_message *hm)   { return mg_match(hm->method, mg_str("
 int is_put(struct mg_http_message *hm)    { return mg_match(hm->method, mg_str("PUT"), NULL); }
 int is_delete(struct mg_http_message *hm) { return mg_match(hm->method, mg_str("DELETE"), NULL); }
 
+// ---------- Paginação ----------
+static int parse_positive_int(const char *s, int *out) {
+  char *end = NULL;
+  long v = strtol(s, &end, 10);
+  if (end == s || *end != '\0' || v <= 0 || v > 2147483647L) return 0;
+  *out = (int) v;
+  return 1;
+}
+
+int get_page_params(struct mg_http_message *hm, int *limit, int *after_id) {
+  char buf[32];
+
+  *limit = PAGE_LIMIT_DEFAULT;
+  *after_id = 0;
+
+  if (mg_http_get_var(&hm->query, "limit", buf, sizeof(buf)) > 0) {
+    if (!parse_positive_int(buf, limit)) return 0;
+    if (*limit > PAGE_LIMIT_MAX) *limit = PAGE_LIMIT_MAX;
+  }
+
+  if (mg_http_get_var(&hm->query, "after_id", buf, sizeof(buf)) > 0) {
+    if (!parse_positive_int(buf, after_id)) return 0;
+  }
+
+  return 1;
+}
+
+// If-None-Match com a tag atual: lista separada por vírgulas, cada entrada
+// comparada inteira (comparação fraca: W/ ignorado dos dois lados), "*" casa sempre
+int etag_matches(struct mg_http_message *hm, const char *etag) {
+  struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+  if (!inm) return 0;
+  if (strncmp(etag, "W/", 2) == 0) etag += 2;
+  size_t n = strlen(etag);
+
+  const char *p = inm->buf, *end = inm->buf + inm->len;
+  while (p < end) {
+    const char *comma = (const char *) memchr(p, ',', (size_t) (end - p));
+    const char *e = comma ? comma : end;
+    while (p < e && (*p == ' ' || *p == '\t')) p++;
+    while (e > p && (e[-1] == ' ' || e[-1] == '\t')) e--;
+    if (e - p == 1 && *p == '*') return 1;
+    if (e - p >= 2 && p[0] == 'W' && p[1] == '/') p += 2;
+    if ((size_t) (e - p) == n && memcmp(p, etag, n) == 0) return 1;
+    if (!comma) break;
+    p = comma + 1;
+  }
+  return 0;
+}
+
+// Acrescenta ETag (e revalidação obrigatória) a uma resposta 200 escrita desde start
+static void add_etag_header(struct mg_connection *c, size_t start, const char *etag) {
+  struct mg_iobuf *io = &c->send;
+  if (io->len < start + 13 || memcmp(io->buf + start, "HTTP/1.1 200 ", 13) != 0) return;
+
+  size_t eol = start;
+  while (eol + 1 < io->len && !(io->buf[eol] == '\r' && io->buf[eol + 1] == '\n')) eol++;
+  if (eol + 1 >= io->len) return;
+
+  char header[96];
+  int n = snprintf(header, sizeof(header), "ETag: %s\r\nCache-Control: private, no-cache\r\n", etag);
+  if (n > 0 && (size_t) n < sizeof(header)) mg_iobuf_add(io, eol + 2, header, (size_t) n);
+}
+
+// Conclusão de um GET cacheável, já com a resposta do executor em c->send
+struct cache_ctx {
+  int scope, user;
+  long long deadline;
+  struct respcache_gen gen;
+  char etag[64];
+};
+
+static void cache_done(struct mg_connection *c, struct mg_http_message *hm, size_t start, void *arg) {
+  struct cache_ctx *cc = (struct cache_ctx *) arg;
+  add_etag_header(c, start, cc->etag);
+  respcache_store(c, start, cc->scope, cc->user, hm->uri, hm->query, cc->deadline, &cc->gen);
+}
+
+// ---------- Executor de BD ----------
+static void reply_busy(struct mg_connection *c) {
+  mg_http_reply(c, 503, "Content-Type: application/json\r\n",
+                "{ \"error\": \"server busy, try again\" }\n");
+}
+
+// Handler para o executor (cc = NULL: resposta não vai para a cache)
+static void submit(struct mg_connection *c, int queue, struct mg_http_message *hm,
+                   const struct request_ctx *rq, dbexec_fn fn, const struct cache_ctx *cc) {
+  int ok = cc ? dbexec_submit(c, queue, hm, rq, fn, cache_done, cc, sizeof(*cc))
+              : dbexec_submit(c, queue, hm, rq, fn, NULL, NULL, 0);
+  if (!ok) reply_busy(c);
+}
+
 // ---------- Handlers genéricos ----------
-void handle_health(struct mg_connection *c) {
+void handle_health(struct mg_connection *c, struct mg_http_message *hm,
+                   const struct request_ctx *rq) {
+  (void) hm;
+  (void) rq;
+  unsigned long hits = 0, misses = 0, s_hits = 0, s_misses = 0, checkpoints = 0;
+  unsigned long batches = 0;
+  struct dbexec_stats ex;
+  int wal_frames = 0, col_users = 0;
+  long long col_sets = 0;
+  stmtcache_stats(&hits, &misses);
+  sesscache_stats(&s_hits, &s_misses);
+  db_wal_stats(&checkpoints, &wal_frames);
+  writeq_stats(&batches, NULL);
+  dbexec_stats(&ex);
+  colstore_stats(&col_sets, &col_users);
+  struct respcache_stats rc;
+  respcache_stats(&rc);
+  unsigned long lookups = rc.hits + rc.misses;
+  struct assets_stats as;
+  assets_stats(&as);
+  struct alloc_stats al;
+  alloc_stats(&al);
+  char mg_allocs[24];
+  if (al.mg_counted) snprintf(mg_allocs, sizeof(mg_allocs), "%lu", al.mg);
+  else snprintf(mg_allocs, sizeof(mg_allocs), "null");
+
   mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-                "{ \"status\": \"ok\" }\n");
+                "{ \"status\": \"ok\", \"worker\": %d, \"workers\": %d, "
+                "\"stmt_cache\": { \"hits\": %lu, \"misses\": %lu }, "
+                "\"session_cache\": { \"hits\": %lu, \"misses\": %lu }, "
+                "\"wal\": { \"checkpoints\": %lu, \"frames\": %d }, "
+                "\"db_executor\": { \"readers\": %d, \"read_queued\": %d, \"write_queued\": %d, "
+                "\"reads\": %lu, \"writes\": %lu, \"rejected\": %lu, \"batches\": %lu }, "
+                "\"colstore\": { \"enabled\": %s, \"sets\": %lld, \"users\": %d, \"simd\": \"%s\" }, "
+                "\"response_cache\": { \"hits\": %lu, \"misses\": %lu, \"hit_ratio\": %.3f, "
+                "\"entries\": %lu, \"bytes\": %lu, \"budget\": %lu, \"evictions\": %lu }, "
+                "\"static_assets\": { \"files\": %lu, \"bytes\": %lu, \"gzip_bytes\": %lu, "
+                "\"br_bytes\": %lu, \"reloads\": %lu }, "
+                "\"heap_allocs\": { \"mongoose\": %s, \"sqlite\": %lu, \"arena\": %lu } }\n",
+                worker_id(), worker_count(),
+                hits, misses, s_hits, s_misses, checkpoints, wal_frames,
+                ex.readers, ex.read_queued, ex.write_queued, ex.reads, ex.writes, ex.rejected, batches,
+                colstore_enabled() ? "true" : "false", col_sets, col_users,
+                agg_impl_name(agg_impl()),
+                rc.hits, rc.misses, lookups ? (double) rc.hits / lookups : 0.0,
+                rc.entries, (unsigned long) rc.bytes, (unsigned long) rc.budget, rc.evictions,
+                as.files, (unsigned long) as.bytes, (unsigned long) as.gzip_bytes,
+                (unsigned long) as.br_bytes, as.reloads,
+                mg_allocs, al.sqlite, al.arena);
 }
 
 void handle_not_found(struct mg_connection *c) {
@@ -27,16 +181,31 @@ void handle_not_found(struct mg_connection *c) {
 }
 
 // ---------- Static files ----------
-static int serve_static(struct mg_connection *c, struct mg_http_message *hm) {
+static int uri_is_plain(struct mg_str uri) {
+  for (size_t i = 0; i < uri.len; i++) {
+    if (uri.buf[i] == '%' || uri.buf[i] == '\\') return 0;
+    if (uri.buf[i] == '.' && i + 1 < uri.len && uri.buf[i + 1] == '.') return 0;
+  }
+  return 1;
+}
+
+// Rotas do frontend e GETs sem rota: assets em memória (pré-comprimidos),
+// páginas e css/js do disco; o resto é 404
+static void handle_static(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *rq) {
+  (void) rq;
   struct mg_http_serve_opts opts = {
     .root_dir = "public",
     .fs = &mg_fs_posix
   };
 
+  if (assets_serve(c, hm)) return;
+
   // "/" -> index.html
   if (mg_match(hm->uri, mg_str("/"), NULL)) {
+    if (sendfile_serve(c, hm, "public/index.html", assets_mime_type("index.html"))) return;
     mg_http_serve_file(c, hm, "public/index.html", &opts);  // <-- const char*
-    return 1;
+    return;
   }
 
   // Páginas e assets
@@ -45,135 +214,125 @@ static int serve_static(struct mg_connection *c, struct mg_http_message *hm) {
       mg_match(hm->uri, mg_str("/admin.html"), NULL) ||
       mg_match(hm->uri, mg_str("/css/#"), NULL) ||
       mg_match(hm->uri, mg_str("/js/#"), NULL)) {
+    // TransmitFile só com caminhos simples; %xx e ".." ficam para o mongoose, que os normaliza
+    char path[MG_PATH_MAX];
+    if (hm->uri.len + 7 < sizeof(path) && uri_is_plain(hm->uri)) {
+      snprintf(path, sizeof(path), "public%.*s", (int) hm->uri.len, hm->uri.buf);
+      if (sendfile_serve(c, hm, path, assets_mime_type(path))) return;
+    }
     mg_http_serve_dir(c, hm, &opts);
-    return 1;
+    return;
   }
 
-  return 0;
+  handle_not_found(c);
 }
 
 // ---------- Router ----------
-void ev_handler(struct mg_connection *c, int ev, void *ev_data) {
-  if (ev != MG_EV_HTTP_MSG) return;
-
-  struct mg_http_message *hm = (struct mg_http_message *) ev_data;
+// Compilada numa trie no arranque (router.h). Âmbito da cache: as stats usam
+// date('now') e por isso, além das gerações, valem só até à meia-noite UTC.
+#define NO_CACHE -1
+
+static const struct route s_routes[] = {
+  // Frontend
+  { ROUTE_GET,    "/",                               handle_static,                  ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_GET,    "/index.html",                     handle_static,                  ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_GET,    "/dashboard.html",                 handle_static,                  ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_GET,    "/admin.html",                     handle_static,                  ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_GET,    "/css/*",                          handle_static,                  ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_GET,    "/js/*",                           handle_static,                  ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+
+  // Públicas / sessão
+  { ROUTE_GET,    "/health",                         handle_health,                  ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_POST,   "/login",                          handle_post_login,              ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_POST,   "/signup",                         handle_post_signup,             ROUTE_PUBLIC, ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_POST,   "/logout",                         handle_post_logout,             ROUTE_USER,   ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_GET,    "/me",                             handle_get_me,                  ROUTE_USER,   ROUTE_READ,   NO_CACHE, 0 },
+
+  // Exercises
+  { ROUTE_GET,    "/exercises",                      handle_get_exercises,           ROUTE_PUBLIC, ROUTE_READ,   RESPCACHE_PUBLIC, 0 },
+  { ROUTE_GET,    "/exercises/:id",                  handle_get_exercises_id,        ROUTE_PUBLIC, ROUTE_READ,   RESPCACHE_PUBLIC, 0 },
+  { ROUTE_POST,   "/exercises",                      handle_post_exercises,          ROUTE_ADMIN,  ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_PUT,    "/exercises/:id",                  handle_put_exercises,           ROUTE_ADMIN,  ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_DELETE, "/exercises/:id",                  handle_delete_exercises,        ROUTE_ADMIN,  ROUTE_WRITE,  NO_CACHE, 0 },
+
+  // Workouts e sets
+  { ROUTE_GET,    "/workouts",                       handle_get_workouts,            ROUTE_USER,   ROUTE_READ,   RESPCACHE_USER, 0 },
+  { ROUTE_GET,    "/workouts/:id",                   handle_get_workouts_id,         ROUTE_USER,   ROUTE_READ,   RESPCACHE_USER, 0 },
+  { ROUTE_POST,   "/workouts",                       handle_post_workouts,           ROUTE_USER,   ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_PUT,    "/workouts/:id",                   handle_put_workouts,            ROUTE_USER,   ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_DELETE, "/workouts/:id",                   handle_delete_workouts,         ROUTE_USER,   ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_POST,   "/workouts/:id/sets",              handle_post_workout_set,        ROUTE_USER,   ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_POST,   "/workouts/:id/sets:batch",        handle_post_workout_sets_batch, ROUTE_USER,   ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_PUT,    "/workouts/:id/sets/:set_id",      handle_put_workout_set,         ROUTE_USER,   ROUTE_WRITE,  NO_CACHE, 0 },
+  { ROUTE_DELETE, "/workouts/:id/sets/:set_id",      handle_delete_workout_set,      ROUTE_USER,   ROUTE_WRITE,  NO_CACHE, 0 },
+
+  // Stats e leaderboards
+  { ROUTE_GET,    "/stats/volume",                   handle_get_stats_volume,        ROUTE_USER,   ROUTE_READ,   RESPCACHE_USER, 1 },
+  { ROUTE_GET,    "/stats/prs",                      handle_get_stats_prs,           ROUTE_USER,   ROUTE_READ,   RESPCACHE_USER, 1 },
+  { ROUTE_GET,    "/stats/e1rm",                     handle_get_stats_e1rm,          ROUTE_USER,   ROUTE_READ,   RESPCACHE_USER, 1 },
+  { ROUTE_GET,    "/stats/histogram",                handle_get_stats_histogram,     ROUTE_USER,   ROUTE_READ,   RESPCACHE_USER, 1 },
+  { ROUTE_GET,    "/leaderboards/:exercise_id",      handle_get_leaderboard,         ROUTE_ADMIN,  ROUTE_READ,   RESPCACHE_ALL_USERS, 0 },
+
+  // Admin
+  { ROUTE_POST,   "/admin/users",                    handle_post_admin_users,        ROUTE_ADMIN,  ROUTE_INLINE, NO_CACHE, 0 },
+  { ROUTE_GET,    "/admin/users",                    handle_get_admin_users,         ROUTE_ADMIN,  ROUTE_READ,   NO_CACHE, 0 },
+};
+
+int http_routes_init(void) {
+  return router_init(s_routes, (int) (sizeof(s_routes) / sizeof(s_routes[0])));
+}
 
-  // Servir frontend (antes da API)
-  if (is_get(hm) && serve_static(c, hm)) return;
+static void dispatch(struct mg_connection *c, struct mg_http_message *hm) {
+  // Identidade do pedido (auth_require_*) e ids do path, passados aos handlers
+  struct request_ctx rq = { 0 };
 
-  // 1) Público: /health
-  if (is_get(hm) && mg_match(hm->uri, mg_str("/health"), NULL)) {
-    handle_health(c);
+  const struct route *r = router_match(hm, rq.param);
+  if (!r) {
+    // GET sem rota: pode ser outro ficheiro do public/ carregado em memória
+    if (is_get(hm)) handle_static(c, hm, &rq);
+    else handle_not_found(c);
     return;
   }
 
-  // 2) Público: /login
-  if (is_post(hm) && mg_match(hm->uri, mg_str("/login"), NULL)) {
-    handle_post_login(c, hm);
-    return;
-  }
+  if (r->auth == ROUTE_USER && !auth_require_user(c, hm, &rq)) return;
+  if (r->auth == ROUTE_ADMIN && !auth_require_admin(c, hm, &rq)) return;
 
-  // 3) Público: /signup (auto-login no handler)
-  if (is_post(hm) && mg_match(hm->uri, mg_str("/signup"), NULL)) {
-    handle_post_signup(c, hm);
+  if (r->exec == ROUTE_INLINE) {
+    r->fn(c, hm, &rq);
     return;
   }
 
-  // 4) /logout (exige sessão)
-  if (is_post(hm) && mg_match(hm->uri, mg_str("/logout"), NULL)) {
-    int uid = 0;
-    if (!auth_require_user(c, hm, &uid)) return;
-    handle_post_logout(c, hm);
-    return;
+  // Cache de respostas e ETag (só GETs; a identidade já foi resolvida acima).
+  // Tag ainda válida: 304 sem tocar no SQLite nem gerar JSON.
+  struct cache_ctx cc = { 0 };
+  cc.scope = r->cache;
+  cc.user = cc.scope == RESPCACHE_USER ? rq.user_id : 0;
+  if (r->cache_daily) cc.deadline = ((long long) time(NULL) / 86400 + 1) * 86400;
+  if (cc.scope >= 0) {
+    respcache_etag(cc.scope, cc.user, cc.deadline, cc.etag, sizeof(cc.etag));
+    if (etag_matches(hm, cc.etag)) {
+      mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: private, no-cache\r\n\r\n", cc.etag);
+      c->is_resp = 0;
+      return;
+    }
+    if (respcache_serve(c, cc.scope, cc.user, hm->uri, hm->query, &cc.gen)) return;
   }
 
-  // 5) /me (exige sessão)
-  if (is_get(hm) && mg_match(hm->uri, mg_str("/me"), NULL)) {
-    handle_get_me(c, hm);
-    return;
-  }
-
-  // 6) Workouts e sets: exigem sessão
-  if (mg_match(hm->uri, mg_str("/workouts"), NULL) ||
-      mg_match(hm->uri, mg_str("/workouts/#"), NULL) ||
-      mg_match(hm->uri, mg_str("/workouts/#/sets"), NULL) ||
-      mg_match(hm->uri, mg_str("/workouts/#/sets/#"), NULL)) {
-
-    int uid = 0;
-    if (!auth_require_user(c, hm, &uid)) return;
-  }
-
-  // 7) Admin: exige sessão + role=admin
-  if (mg_match(hm->uri, mg_str("/admin/#"), NULL)) {
-    int uid = 0;
-    if (!auth_require_admin(c, hm, &uid)) return;
-  }
-
-  // ======== ROUTES ========
-
-  // -------- Exercises --------
-  if (is_get(hm) && mg_match(hm->uri, mg_str("/exercises"), NULL)) {
-    handle_get_exercises(c);
-
-  } else if (is_get(hm) && mg_match(hm->uri, mg_str("/exercises/#"), NULL)) {
-    handle_get_exercises_id(c, hm);
-
-  } else if (is_post(hm) && mg_match(hm->uri, mg_str("/exercises"), NULL)) {
-    int uid = 0;
-    if (!auth_require_admin(c, hm, &uid)) return;
-    handle_post_exercises(c, hm);
-
-  } else if (is_put(hm) && mg_match(hm->uri, mg_str("/exercises/#"), NULL)) {
-    int uid = 0;
-    if (!auth_require_admin(c, hm, &uid)) return;
-    handle_put_exercises(c, hm);
-
-  } else if (is_delete(hm) && mg_match(hm->uri, mg_str("/exercises/#"), NULL)) {
-    int uid = 0;
-    if (!auth_require_admin(c, hm, &uid)) return;
-    handle_delete_exercises(c, hm);
-
-  // -------- Workouts (sets primeiro) --------
-  } else if (is_post(hm) && mg_match(hm->uri, mg_str("/workouts/#/sets"), NULL)) {
-    handle_post_workout_set(c, hm);
-
-  } else if (is_put(hm) && mg_match(hm->uri, mg_str("/workouts/#/sets/#"), NULL)) {
-    handle_put_workout_set(c, hm);
-
-  } else if (is_delete(hm) && mg_match(hm->uri, mg_str("/workouts/#/sets/#"), NULL)) {
-    handle_delete_workout_set(c, hm);
-
-  // -------- Workouts --------
-  } else if (is_get(hm) && mg_match(hm->uri, mg_str("/workouts"), NULL)) {
-    handle_get_workouts(c, hm);
-
-  } else if (is_get(hm) && mg_match(hm->uri, mg_str("/workouts/#"), NULL)) {
-    handle_get_workouts_id(c, hm);
-
-  } else if (is_post(hm) && mg_match(hm->uri, mg_str("/workouts"), NULL)) {
-    handle_post_workouts(c, hm);
-
-  } else if (is_put(hm) && mg_match(hm->uri, mg_str("/workouts/#"), NULL)) {
-    handle_put_workouts(c, hm);
-
-  } else if (is_delete(hm) && mg_match(hm->uri, mg_str("/workouts/#"), NULL)) {
-    handle_delete_workouts(c, hm);
-
-  // -------- Stats --------
-  } else if (is_get(hm) && mg_match(hm->uri, mg_str("/stats/volume"), NULL)) {
-    handle_get_stats_volume(c, hm);
-
-  } else if (is_get(hm) && mg_match(hm->uri, mg_str("/stats/prs"), NULL)) {
-    handle_get_stats_prs(c, hm);
-
-  // -------- Admin --------
-  } else if (is_post(hm) && mg_match(hm->uri, mg_str("/admin/users"), NULL)) {
-    handle_post_admin_users(c, hm);
-
-  } else if (is_get(hm) && mg_match(hm->uri, mg_str("/admin/users"), NULL)) {
-    handle_get_admin_users(c);
+  submit(c, r->exec == ROUTE_WRITE ? DBEXEC_WRITE : DBEXEC_READ, hm, &rq, r->fn,
+         cc.scope >= 0 ? &cc : NULL);
+}
 
+void ev_handler(struct mg_connection *c, int ev, void *ev_data) {
+  if (ev == MG_EV_WAKEUP) {
+    // Resultado do hashpool (login/signup/admin users) ou do executor de BD pronto
+    hashpool_on_wakeup(c);
+    dbexec_on_wakeup(c);
+  } else if (ev == MG_EV_HTTP_MSG) {
+    dispatch(c, (struct mg_http_message *) ev_data);
   } else {
-    handle_not_found(c);
+    return;
   }
+
+  // Fim do pedido: o que os handlers tiraram da arena volta ao bloco
+  arena_reset();
 }
@@ -2,6 +2,7 @@
 #define HTTP_H
 
 #include "mongoose.h"
+#include "auth.h"
 
 // Helpers de método HTTP
 int is_get(struct mg_http_message *hm);
@@ -9,13 +10,25 @@ int is_post(struct mg_http_message *hm);
 int is_put(struct mg_http_message *hm);
 int is_delete(struct mg_http_message *hm);
 
+// Paginação por cursor: ?limit=N&after_id=<cursor>
+// limit por omissão PAGE_LIMIT_DEFAULT, máximo PAGE_LIMIT_MAX; after_id = 0 se ausente
+// Retorna 1 se ok, 0 se os parâmetros forem inválidos (o handler responde 400)
+#define PAGE_LIMIT_DEFAULT 50
+#define PAGE_LIMIT_MAX     200
+int get_page_params(struct mg_http_message *hm, int *limit, int *after_id);
+
+// 1 se o If-None-Match do pedido lista o ETag (com aspas) ou é "*"
+int etag_matches(struct mg_http_message *hm, const char *etag);
+
 // Handlers genéricos
-void handle_health(struct mg_connection *c);
+void handle_health(struct mg_connection *c, struct mg_http_message *hm,
+                   const struct request_ctx *rq);
 void handle_not_found(struct mg_connection *c);
 
+// Compila a tabela de rotas (router.h). Chamar antes dos workers; retorna 1 se ok.
+int http_routes_init(void);
+
 // Router principal
 void ev_handler(struct mg_connection *c, int ev, void *ev_data);
 
-static int serve_static(struct mg_connection *c, struct mg_http_message *hm);
-
 #endif
@@ -1,33 +1,44 @@
 #include <string.h>
 #include <stdio.h>
 #include "json.h"
+#include "arena.h"
 
-// Extrai e faz unescape do "name" num JSON simples
-int json_get_name(const char *json, char *out, size_t out_size) {
-  const char *key = "\"name\"";
-  const char *p = strstr(json, key);
-  if (!p) return 0;
+// Valor string de "field" (primeira ocorrência da chave), com unescape, na arena
+char *json_get_str(struct mg_str json, const char *field, size_t max) {
+  size_t klen = strlen(field);
+  const char *p = NULL, *end = json.buf + json.len;
+  for (const char *k = json.buf; k && k + klen + 2 <= end; k++) {
+    k = (const char *) memchr(k, '"', (size_t) (end - k));
+    if (!k || k + klen + 2 > end) break;
+    if (memcmp(k + 1, field, klen) == 0 && k[klen + 1] == '"') {
+      p = k + klen + 2;
+      break;
+    }
+  }
+  if (!p) return NULL;
 
-  p += strlen(key);
-  while (*p && *p != ':') p++;
-  if (*p != ':') return 0;
+  while (p < end && *p != ':') p++;
+  if (p >= end) return NULL;
   p++;
 
-  while (*p == ' ' || *p == '\t') p++;
-  if (*p != '"') return 0;
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  if (p >= end || *p != '"') return NULL;
   p++; // dentro da string
 
+  // O valor escapado nunca é mais curto do que o resultado
+  const char *q = p;
+  while (q < end && *q != '"') q += (*q == '\\' && q + 1 < end) ? 2 : 1;
+  if (q >= end || (size_t) (q - p) > 2 * max) return NULL;
+
+  char *out = (char *) arena_alloc((size_t) (q - p) + 1);
+  if (!out) return NULL;
+
   size_t o = 0;
-  while (*p && o < out_size - 1) {
-    if (*p == '"') {  // fim
-      out[o] = '\0';
-      return 1;
-    }
+  while (p < q) {
+    if (o >= max) return NULL;
 
     if (*p == '\\') { // escape
       p++;
-      if (!*p) return 0;
-
       char ch;
       switch (*p) {
         case '"':  ch = '"';  break;
@@ -38,7 +49,7 @@ int json_get_name(const char *json, char *out, size_t out_size) {
         case 'b':  ch = '\b'; break;
         case 'f':  ch = '\f'; break;
         default:
-          return 0; // não suporta \uXXXX
+          return NULL; // não suporta \uXXXX
       }
       out[o++] = ch;
       p++;
@@ -46,47 +57,104 @@ int json_get_name(const char *json, char *out, size_t out_size) {
       out[o++] = *p++;
     }
   }
+  out[o] = '\0';
+  return out;
+}
+
+// ======================================================
+// Writer de respostas JSON (direto no c->send)
+// ======================================================
 
-  return 0;
+// Garante espaço livre com crescimento geométrico (o mg_pfn_iobuf
+// só cresce MG_IO_SIZE de cada vez, o que fica quadrático em respostas grandes)
+static void json_reserve(struct mg_iobuf *io, size_t need) {
+  if (io->size - io->len >= need) return;
+  size_t want = io->size * 2;
+  if (want < io->len + need) want = io->len + need;
+  mg_iobuf_resize(io, want);
 }
 
-// Escapa string para JSON
-int json_escape(const char *in, char *out, size_t out_size) {
-  size_t o = 0;
+void json_begin(struct json_writer *w, struct mg_connection *c, int status) {
+  json_begin_headers(w, c, status, "");
+}
+void json_begin_headers(struct json_writer *w, struct mg_connection *c, int status,
+                        const char *headers) {
+  w->c = c;
+  w->start = c->send.len;
+
+  // Content-Length com 10 espaços, preenchido em json_end (como o mg_http_reply)
+  mg_printf(c, "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n%s"
+               "Content-Length:           \r\n\r\n",
+            status, status == 201 ? "Created" : "OK", headers ? headers : "");
+  w->body = c->send.len;
+}
 
-  for (size_t i = 0; in[i] != '\0'; i++) {
-    unsigned char ch = (unsigned char)in[i];
-    const char *rep = NULL;
-    char tmp[7];
-
-    switch (ch) {
-      case '\"': rep = "\\\""; break;
-      case '\\': rep = "\\\\"; break;
-      case '\b': rep = "\\b";  break;
-      case '\f': rep = "\\f";  break;
-      case '\n': rep = "\\n";  break;
-      case '\r': rep = "\\r";  break;
-      case '\t': rep = "\\t";  break;
-      default:
-        if (ch < 0x20) {
-          snprintf(tmp, sizeof(tmp), "\\u%04X", ch);
-          rep = tmp;
-        }
-        break;
+void json_printf(struct json_writer *w, const char *fmt, ...) {
+  va_list ap;
+  json_reserve(&w->c->send, 1024);
+  va_start(ap, fmt);
+  mg_vxprintf(mg_pfn_iobuf, &w->c->send, fmt, &ap);
+  va_end(ap);
+}
+
+void json_end(struct json_writer *w) {
+  struct mg_iobuf *io = &w->c->send;
+  unsigned long n = (unsigned long) (io->len - w->body);
+
+  // Posição dos 10 espaços: "Content-Length: " + 10 + "\r\n\r\n"
+  char *p = (char *) io->buf + w->body - 14;
+  char digits[11];
+  int k = snprintf(digits, sizeof(digits), "%lu", n);
+  memcpy(p, digits, (size_t) k);
+
+  w->c->is_resp = 0;
+}
+
+void json_abort(struct json_writer *w) {
+  w->c->send.len = w->start;
+}
+
+size_t json_esc(void (*out)(char, void *), void *arg, va_list *ap) {
+  const char *in = va_arg(*ap, const char *);
+  static const char *hex = "0123456789ABCDEF";
+  size_t n = 2;
+
+  out('"', arg);
+  for (const unsigned char *p = (const unsigned char *) (in ? in : ""); *p; p++) {
+    char rep = 0;
+    switch (*p) {
+      case '\"': rep = '"';  break;
+      case '\\': rep = '\\'; break;
+      case '\b': rep = 'b';  break;
+      case '\f': rep = 'f';  break;
+      case '\n': rep = 'n';  break;
+      case '\r': rep = 'r';  break;
+      case '\t': rep = 't';  break;
+      default: break;
     }
 
     if (rep) {
-      size_t rlen = strlen(rep);
-      if (o + rlen >= out_size) return 0;
-      memcpy(out + o, rep, rlen);
-      o += rlen;
+      out('\\', arg); out(rep, arg);
+      n += 2;
+    } else if (*p < 0x20) {
+      out('\\', arg); out('u', arg); out('0', arg); out('0', arg);
+      out(hex[*p >> 4], arg); out(hex[*p & 0xF], arg);
+      n += 6;
     } else {
-      if (o + 1 >= out_size) return 0;
-      out[o++] = (char)ch;
+      out((char) *p, arg);
+      n++;
     }
   }
+  out('"', arg);
 
-  if (o >= out_size) return 0;
-  out[o] = '\0';
-  return 1;
+  return n;
+}
+
+size_t json_num(void (*out)(char, void *), void *arg, va_list *ap) {
+  double v = va_arg(*ap, double);
+  char tmp[64];
+  int k = snprintf(tmp, sizeof(tmp), "%.3f", v);
+  if (k < 0) return 0;
+  for (int i = 0; i < k && tmp[i]; i++) out(tmp[i], arg);
+  return (size_t) k;
 }
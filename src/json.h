@@ -2,14 +2,51 @@
 #define JSON_H
 
 #include <stddef.h>
+#include <stdarg.h>
+#include "mongoose.h"
 
-// Extrai e faz unescape do "name" num JSON simples: { "name": "..." }
+// Valor da string "field" num objeto JSON simples (o corpo do pedido, sem
+// '\0'), sem aspas e com unescape, alocado na arena do pedido (arena.h).
 // Suporta escapes: \" \\ \n \r \t \b \f
-// Retorna 1 se sucesso, 0 se erro.
-int json_get_name(const char *json, char *out, size_t out_size);
+// NULL se não existir, não for string, tiver mais de max bytes ou um
+// escape não suportado (\uXXXX).
+char *json_get_str(struct mg_str json, const char *field, size_t max);
 
-// Escapa uma string para ser segura dentro de "..." em JSON
-// Retorna 1 se coube em out, 0 se não coube.
-int json_escape(const char *in, char *out, size_t out_size);
+// ------------------ Writer de respostas JSON ------------------
+// Escreve a resposta HTTP diretamente no c->send (mg_iobuf), sem buffer
+// intermédio nem cópia extra do mg_http_reply("%s"). O buffer cresce em
+// blocos geométricos, por isso não há limite de tamanho.
+//
+//   struct json_writer w;
+//   json_begin(&w, c, 200);
+//   json_printf(&w, "{ \"id\": %d, \"name\": %M }", id, json_esc, name);
+//   json_end(&w);
+struct json_writer {
+  struct mg_connection *c;
+  size_t start;     // c->send.len antes do header (para json_abort)
+  size_t body;      // início do corpo (para o Content-Length)
+};
+
+// Escreve status line + headers (Content-Type: application/json)
+void json_begin(struct json_writer *w, struct mg_connection *c, int status);
+
+// Idem, com headers extra (cada um terminado em "\r\n")
+void json_begin_headers(struct json_writer *w, struct mg_connection *c, int status,
+                        const char *headers);
+
+// printf para o corpo (formatos do mg_xprintf; %M com json_esc/json_num)
+void json_printf(struct json_writer *w, const char *fmt, ...);
+
+// Fecha a resposta (preenche o Content-Length)
+void json_end(struct json_writer *w);
+
+// Descarta tudo o que foi escrito desde json_begin
+void json_abort(struct json_writer *w);
+
+// Para usar com %M:
+//   json_esc: (const char *) -> "string escapada" (com aspas)
+//   json_num: (double)       -> número com 3 casas decimais (como "%.3f")
+size_t json_esc(void (*out)(char, void *), void *arg, va_list *ap);
+size_t json_num(void (*out)(char, void *), void *arg, va_list *ap);
 
 #endif
@@ -1,23 +1,174 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
 #include "mongoose.h"
 #include "db.h"
 #include "http.h"
+#include "hashpool.h"
+#include "sesscache.h"
+#include "dbexec.h"
+#include "stats.h"
+#include "colstore.h"
+#include "agg.h"
+#include "respcache.h"
+#include "assets.h"
+#include "worker.h"
+#include "arena.h"
+#include "bench.h"
+#include "check.h"
 
-int main(void) {
-  struct mg_mgr mgr;
+int main(int argc, char **argv) {
+  // Contagem das alocações do SQLite (/health, --bench-alloc): antes de qualquer sqlite3_*
+  alloc_stats_init();
 
-  db_init();
+  // api.exe --workers N: N event loops na porta 8000 (um listener reparte as ligações), default 1
+  int nworkers = 1;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--workers") == 0) nworkers = atoi(argv[i + 1]);
+  }
+  if (nworkers < 1) nworkers = 1;
+
+  // api.exe --check-kernels: variantes SIMD do agg vs escalar (não precisa da BD)
+  if (argc > 1 && strcmp(argv[1], "--check-kernels") == 0) {
+    agg_init();
+    int bad = check_kernels();
+    printf(bad ? "check-kernels: %d diferença(s)\n" : "check-kernels: ok\n", bad);
+    return bad ? 1 : 0;
+  }
+
+  // api.exe --bench-sendfile [ficheiro]: cópias de MG_IO_SIZE vs TransmitFile por loopback
+  if (argc > 1 && strcmp(argv[1], "--bench-sendfile") == 0) {
+    return bench_sendfile(argc > 2 ? argv[2] : NULL);
+  }
+
+  // Rotas da API compiladas numa trie (router.h)
+  if (!http_routes_init()) return 1;
+
+  // api.exe --bench-router: custo do dispatch por rota, trie vs cadeia de mg_match
+  if (argc > 1 && strcmp(argv[1], "--bench-router") == 0) {
+    return bench_router();
+  }
+
+  // Pragmas / leitores / checkpoints: defaults + variáveis GYM_DB_*
+  struct db_config cfg;
+  db_config_defaults(&cfg);
+  db_config_from_env(&cfg);
+
+  // api.exe --bench-login / --bench-pages: criam users, sessões e workouts numa BD à parte
+  int bench_db = argc > 1 && (strcmp(argv[1], "--bench-login") == 0 ||
+                              strcmp(argv[1], "--bench-pages") == 0);
+  if (bench_db) {
+    bench_db_remove();
+    cfg.path = BENCH_DB_PATH;
+  }
+
+  db_init(&cfg);
   if (!db) return 1;
 
-  mg_mgr_init(&mgr);
-  printf("Listening on http://localhost:8000\n");
-  mg_http_listen(&mgr, "http://0.0.0.0:8000", ev_handler, NULL);
+  // api.exe --check-plans: regressão dos planos das queries quentes (exit 1 se houver full scan)
+  if (argc > 1 && strcmp(argv[1], "--check-plans") == 0) {
+    int bad = db_check_query_plans();
+    printf(bad ? "check-plans: %d full scan(s)\n" : "check-plans: ok\n", bad);
+    db_close();
+    return bad ? 1 : 0;
+  }
+
+  // api.exe --rebuild-rollups: regenera daily_volume/volume_rollup a partir dos sets
+  if (argc > 1 && strcmp(argv[1], "--rebuild-rollups") == 0) {
+    int rows = stats_rebuild_daily_volume();
+    if (rows >= 0) printf("rebuild-rollups: daily_volume com %d linhas\n", rows);
+    db_close();
+    return rows >= 0 ? 0 : 1;
+  }
+
+  // api.exe --bench-colstore [N]: SQLite vs colstore nos N users com mais sets
+  if (argc > 1 && strcmp(argv[1], "--bench-colstore") == 0) {
+    int bad = bench_colstore(argc > 2 ? atoi(argv[2]) : 100);
+    colstore_free();
+    db_close();
+    return bad ? 1 : 0;
+  }
+
+  if (db_check_query_plans() > 0) {
+    printf("AVISO: há queries quentes sem índice (ver acima)\n");
+  }
+
+  sesscache_warm();
+
+  // api.exe --bench-workers [max] [path]: req/s com 1, 2, 4... até max workers
+  int do_bench_workers = argc > 1 && strcmp(argv[1], "--bench-workers") == 0;
+  if (do_bench_workers) nworkers = argc > 2 ? atoi(argv[2]) : 16;
+
+  // api.exe --bench-alloc [path] [n]: alocações no heap por pedido em regime estável
+  int do_bench_alloc = argc > 1 && strcmp(argv[1], "--bench-alloc") == 0;
+  if (do_bench_alloc) nworkers = 1;
+
+  // api.exe --bench-login [ligações]: p99 de GET /exercises com e sem logins em contínuo
+  int do_bench_login = argc > 1 && strcmp(argv[1], "--bench-login") == 0;
+
+  // api.exe --bench-pages [linhas]: latência por página de /workouts e /admin/users
+  int do_bench_pages = argc > 1 && strcmp(argv[1], "--bench-pages") == 0;
+
+  // GYM_COLSTORE=1: cópia em colunas dos sets para as agregações sobre sets crus
+  // (atualizada pelo writer do executor, lida pelos leitores)
+  const char *colstore = getenv("GYM_COLSTORE");
+  if (colstore && strcmp(colstore, "1") == 0) colstore_load();
+  agg_init();
+
+  // GYM_RESPCACHE_MB: limite da cache de respostas dos GETs (0 desliga)
+  const char *respcache_mb = getenv("GYM_RESPCACHE_MB");
+  int mb = respcache_mb ? atoi(respcache_mb) : RESPCACHE_DEFAULT_MB;
+  if (do_bench_pages) mb = 0;   // cada página tem de ir à BD
+  respcache_init(mb > 0 ? (size_t) mb * 1024 * 1024 : 0);
+
+  // Frontend em memória (gzip/br); GYM_ASSETS_WATCH=1 recarrega ao editar (só com 1 worker)
+  const char *assets_watch = getenv("GYM_ASSETS_WATCH");
+  assets_init(nworkers == 1 && assets_watch && strcmp(assets_watch, "1") == 0);
+
+  // Hashing PBKDF2 em threads; resultados voltam ao loop de cada worker por mg_wakeup
+  if (!hashpool_init(0)) {
+    printf("Erro ao iniciar hash pool\n");
+    return 1;
+  }
+
+  // SQLite fora do event loop: GYM_DB_READ_CONNS leitores + 1 writer, cada um com a
+  // sua ligação. GYM_DB_READ_QUEUE / GYM_DB_WRITE_QUEUE: pedidos em espera antes do 503
+  const char *read_queue = getenv("GYM_DB_READ_QUEUE");
+  const char *write_queue = getenv("GYM_DB_WRITE_QUEUE");
+  if (!dbexec_init(cfg.read_conns, read_queue ? atoi(read_queue) : 0,
+                   write_queue ? atoi(write_queue) : 0)) {
+    printf("Erro ao iniciar o executor da BD\n");
+    hashpool_stop();
+    return 1;
+  }
 
-  for (;;) {
-    mg_mgr_poll(&mgr, 1000);
+  int rc = 0;
+  if (do_bench_workers) {
+    rc = bench_workers(nworkers, argc > 3 ? argv[3] : "/exercises");
+  } else if (do_bench_alloc) {
+    rc = bench_alloc(argc > 2 ? argv[2] : "/exercises", argc > 3 ? atoi(argv[3]) : 0);
+  } else if (do_bench_login) {
+    rc = bench_login(nworkers, argc > 2 ? atoi(argv[2]) : 0);
+  } else if (do_bench_pages) {
+    rc = bench_pages(nworkers, argc > 2 ? atoi(argv[2]) : 0);
+  } else {
+    // Cada worker: mg_mgr, ligação SQLite (auth / sessões) e cache de respostas
+    int n = workers_start(nworkers, "http://0.0.0.0:8000");
+    if (n > 0) {
+      printf("Listening on http://localhost:8000 (%d worker%s)\n", n, n > 1 ? "s" : "");
+      workers_wait();
+    } else {
+      printf("Erro ao iniciar workers\n");
+      rc = 1;
+    }
   }
 
+  // Depois dos workers: o writer ainda faz commit do que ficou na fila
+  dbexec_stop();
+  hashpool_stop();
+  assets_free();
+  colstore_free();
   db_close();
-  mg_mgr_free(&mgr);
-  return 0;
+  if (bench_db) bench_db_remove();
+  return rc;
 }
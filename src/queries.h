@@ -0,0 +1,135 @@
+#ifndef QUERIES_H
+#define QUERIES_H
+
+// SQL dos caminhos quentes, partilhado pelos handlers e pelo --check-plans
+// (db_check_query_plans): o plano verificado é o da query que corre. Os
+// statements dos triggers ficam com as migrações em db.c.
+//
+// O texto é também a chave da stmtcache: uma query, uma macro.
+
+// ------------------ Sessões ------------------
+// auth_require_user: user, role e expiração (epoch, 0 = sem) de um token válido
+#define SQL_SESSION_LOOKUP \
+  "SELECT s.user_id, u.role, " \
+  "       COALESCE(CAST(strftime('%s', s.expires_at) AS INTEGER), 0) " \
+  "FROM sessions s " \
+  "JOIN users u ON u.id = s.user_id " \
+  "WHERE s.token = ? AND (s.expires_at IS NULL OR s.expires_at > CURRENT_TIMESTAMP) " \
+  "LIMIT 1;"
+
+// ------------------ Workouts e sets ------------------
+// Range scan em idx_workouts_user_id (user_id, rowid)
+#define SQL_WORKOUTS_PAGE \
+  "SELECT id, created_at " \
+  "FROM workouts " \
+  "WHERE user_id = ? AND id < ? " \
+  "ORDER BY id DESC " \
+  "LIMIT ?;"
+
+#define SQL_WORKOUT_OWNED \
+  "SELECT 1 FROM workouts WHERE id = ? AND user_id = ? LIMIT 1;"
+
+#define SQL_WORKOUT_GET \
+  "SELECT id, created_at " \
+  "FROM workouts " \
+  "WHERE id = ? AND user_id = ? " \
+  "LIMIT 1;"
+
+#define SQL_WORKOUT_SETS \
+  "SELECT we.id, we.exercise_id, e.name, we.reps, we.weight " \
+  "FROM workout_exercises we " \
+  "JOIN exercises e ON e.id = we.exercise_id " \
+  "WHERE we.workout_id = ? " \
+  "ORDER BY we.id;"
+
+#define SQL_SET_UPDATE \
+  "UPDATE workout_exercises " \
+  "SET reps = ?, weight = ? " \
+  "WHERE id = ? AND workout_id = ?;"
+
+#define SQL_SET_DELETE \
+  "DELETE FROM workout_exercises " \
+  "WHERE id = ? AND workout_id = ?;"
+
+// ------------------ Stats ------------------
+// /stats/volume: ?1 user, ?2 bucket, ?3 "-N days", ?4 pontos. Os N mais
+// recentes, devolvidos por ordem cronológica. Buckets grossos: o 1º é o que
+// contém o dia inicial, inteiro.
+#define SQL_VOLUME_DAILY \
+  "SELECT day, volume FROM (" \
+  "  SELECT day, volume FROM daily_volume " \
+  "  WHERE user_id = ?1 AND day >= date('now', ?3) " \
+  "  ORDER BY day DESC LIMIT ?4" \
+  ") pts ORDER BY day;"
+
+#define SQL_VOLUME_ROLLUP \
+  "SELECT period, volume FROM (" \
+  "  SELECT period, volume FROM volume_rollup " \
+  "  WHERE user_id = ?1 AND bucket = ?2 AND period >= " \
+  "    CASE ?2 WHEN 'week' THEN date('now', ?3, 'weekday 0', '-6 days') " \
+  "            WHEN 'month' THEN date('now', ?3, 'start of month') " \
+  "            ELSE date('now', ?3, 'start of year') END " \
+  "  ORDER BY period DESC LIMIT ?4" \
+  ") pts ORDER BY period;"
+
+// Exercícios sem sets do user aparecem com 0 e set_id/data a null
+#define SQL_PRS \
+  "SELECT " \
+  "  e.id, e.name, " \
+  "  COALESCE(pr.max_weight, 0), pr.max_weight_set_id, pr.max_weight_at, " \
+  "  COALESCE(pr.max_reps, 0), pr.max_reps_set_id, pr.max_reps_at, " \
+  "  COALESCE(pr.max_volume, 0), pr.max_volume_set_id, pr.max_volume_at " \
+  "FROM exercises e " \
+  "LEFT JOIN personal_records pr ON pr.user_id = ? AND pr.exercise_id = e.id " \
+  "ORDER BY e.id;"
+
+// Os N dias mais recentes, por ordem cronológica. Brzycki 0 = sem estimativa.
+#define SQL_E1RM_EPLEY \
+  "SELECT day, epley, epley_set_id, julianday(day) FROM (" \
+  "  SELECT day, epley, epley_set_id FROM daily_e1rm " \
+  "  WHERE user_id = ? AND exercise_id = ? AND day >= date('now', ?) " \
+  "  ORDER BY day DESC LIMIT ?" \
+  ") pts ORDER BY day;"
+
+#define SQL_E1RM_BRZYCKI \
+  "SELECT day, brzycki, brzycki_set_id, julianday(day) FROM (" \
+  "  SELECT day, brzycki, brzycki_set_id FROM daily_e1rm " \
+  "  WHERE user_id = ? AND exercise_id = ? AND day >= date('now', ?) AND brzycki > 0 " \
+  "  ORDER BY day DESC LIMIT ?" \
+  ") pts ORDER BY day;"
+
+// Sets do user para o exercício desde from (texto 'YYYY-MM-DD HH:MM:SS'),
+// com o valor da métrica como "v"
+#define SQL_HIST_SETS(col) \
+  "SELECT we." col " AS v FROM workouts w JOIN workout_exercises we ON we.workout_id = w.id " \
+  "WHERE w.user_id = ?1 AND w.created_at >= datetime(?2, 'unixepoch') AND +we.exercise_id = ?3"
+
+#define SQL_HIST_RANGE(col) \
+  "SELECT MIN(v), MAX(v), COUNT(*) FROM (" SQL_HIST_SETS(col) ");"
+
+#define SQL_HIST_BINS(col) \
+  "SELECT MIN(CAST((v - ?4) / ?5 AS INTEGER), ?6), COUNT(*) FROM (" SQL_HIST_SETS(col) ") GROUP BY 1;"
+
+// Top-K de um exercício pelos índices idx_pr_board_*
+#define SQL_BOARD(metric) \
+  "SELECT pr.user_id, u.name, u.surname, pr." metric ", pr." metric "_set_id, pr." metric "_at " \
+  "FROM personal_records pr JOIN users u ON u.id = pr.user_id " \
+  "WHERE pr.exercise_id = ? AND pr." metric " > 0 " \
+  "ORDER BY pr." metric " DESC, pr." metric "_set_id LIMIT ?;"
+
+// ------------------ Colstore ------------------
+#define SQL_COLSTORE_ROW \
+  "SELECT w.user_id, we.id, we.workout_id, CAST(strftime('%s', w.created_at) AS INTEGER), " \
+  "       we.exercise_id, we.reps, we.weight " \
+  "FROM workout_exercises we JOIN workouts w ON w.id = we.workout_id "
+
+// Reler um set alterado no commit do writer
+#define SQL_COLSTORE_SET SQL_COLSTORE_ROW "WHERE we.id = ?;"
+
+// ------------------ Admin ------------------
+// Range scan na PK (rowid)
+#define SQL_ADMIN_USERS_PAGE \
+  "SELECT id, email, role, name, surname FROM users " \
+  "WHERE id > ? ORDER BY id LIMIT ?;"
+
+#endif
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <windows.h>
+
+#include "respcache.h"
+#include "worker.h"
+
+#define RESPCACHE_BUCKETS    4096   // potência de 2, listas ligadas
+#define RESPCACHE_USER_GENS  4096   // potência de 2: users que colidem partilham a geração
+#define RESPCACHE_MAX_KEY    512
+#define RESPCACHE_MAX_SHARE  8      // uma resposta não ocupa mais de 1/8 do limite
+#define RESPCACHE_TXN_USERS  64     // users distintos por batch antes de invalidar tudo
+
+struct rc_entry {
+  struct rc_entry *next;                  // mesmo bucket
+  struct rc_entry *lru_prev, *lru_next;   // lru_prev = mais recente
+  unsigned long hash;
+  int scope;
+  unsigned gen_ex, gen_data;              // gerações no momento em que foi guardada
+  long long deadline;
+  size_t key_len, resp_len;
+  char data[1];                           // chave + resposta
+};
+
+// Tabela, LRU e contadores: um por worker
+static WORKER_LOCAL struct rc_entry *s_buckets[RESPCACHE_BUCKETS];
+static WORKER_LOCAL struct rc_entry *s_lru_head = NULL, *s_lru_tail = NULL;   // head = mais recente
+static WORKER_LOCAL size_t s_budget = 0, s_bytes = 0;
+static WORKER_LOCAL unsigned long s_entries = 0;
+static WORKER_LOCAL unsigned long s_hits = 0, s_misses = 0, s_evictions = 0;
+
+// Gerações: partilhadas por todos os workers
+static volatile long s_gen_ex = 0;                       // exercícios
+static volatile long s_gen_all = 0;                      // sets de qualquer user
+static volatile long s_gen_user[RESPCACHE_USER_GENS];    // sets por user
+static long long s_boot = 0;                             // as gerações recomeçam a cada arranque
+static size_t s_budget_total = 0;
+
+// Bumps à espera do COMMIT do batch atual (thread do writer)
+static WORKER_LOCAL int s_txn_open = 0, s_txn_count = 0, s_txn_overflow = 0, s_txn_ex = 0;
+static WORKER_LOCAL int s_txn_users[RESPCACHE_TXN_USERS];
+
+// ======================================================
+// Chave / gerações
+// ======================================================
+static size_t make_key(char *buf, int user_id, struct mg_str uri, struct mg_str query) {
+  int n = snprintf(buf, RESPCACHE_MAX_KEY, "%d %.*s?%.*s", user_id,
+                   (int) uri.len, uri.buf, (int) query.len, query.buf);
+  if (n < 0 || n >= RESPCACHE_MAX_KEY) return 0;
+  return (size_t) n;
+}
+
+// FNV-1a
+static unsigned long key_hash(const char *key, size_t len) {
+  unsigned long h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char) key[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static unsigned gen_data(int scope, int user_id) {
+  if (scope == RESPCACHE_USER) return (unsigned) s_gen_user[(unsigned) user_id & (RESPCACHE_USER_GENS - 1)];
+  if (scope == RESPCACHE_ALL_USERS) return (unsigned) s_gen_all;
+  return 0;
+}
+
+static size_t entry_size(const struct rc_entry *e) {
+  return sizeof(*e) + e->key_len + e->resp_len;
+}
+
+// ======================================================
+// Tabela + LRU
+// ======================================================
+static void lru_unlink(struct rc_entry *e) {
+  if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+  else s_lru_head = e->lru_next;
+  if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+  else s_lru_tail = e->lru_prev;
+  e->lru_prev = e->lru_next = NULL;
+}
+
+static void lru_push_front(struct rc_entry *e) {
+  e->lru_prev = NULL;
+  e->lru_next = s_lru_head;
+  if (s_lru_head) s_lru_head->lru_prev = e;
+  s_lru_head = e;
+  if (!s_lru_tail) s_lru_tail = e;
+}
+
+static void entry_remove(struct rc_entry *e) {
+  struct rc_entry **pp = &s_buckets[e->hash & (RESPCACHE_BUCKETS - 1)];
+  while (*pp && *pp != e) pp = &(*pp)->next;
+  if (*pp) *pp = e->next;
+
+  lru_unlink(e);
+  s_bytes -= entry_size(e);
+  s_entries--;
+  free(e);
+}
+
+static struct rc_entry *entry_find(const char *key, size_t key_len, unsigned long h) {
+  for (struct rc_entry *e = s_buckets[h & (RESPCACHE_BUCKETS - 1)]; e; e = e->next) {
+    if (e->hash == h && e->key_len == key_len && memcmp(e->data, key, key_len) == 0) return e;
+  }
+  return NULL;
+}
+
+static int entry_valid(const struct rc_entry *e, const struct respcache_gen *gen) {
+  if (e->gen_ex != gen->ex) return 0;
+  if (e->gen_data != gen->data) return 0;
+  if (e->deadline > 0 && e->deadline <= (long long) time(NULL)) return 0;
+  return 1;
+}
+
+void respcache_init(size_t budget) {
+  s_boot = (long long) time(NULL);
+  s_budget_total = budget;
+  if (budget > 0) printf("Cache de respostas: %lu KB\n", (unsigned long) (budget / 1024));
+}
+
+void respcache_worker_init(int nworkers) {
+  respcache_free();
+  s_budget = s_budget_total / (size_t) (nworkers > 0 ? nworkers : 1);
+}
+
+void respcache_free(void) {
+  while (s_lru_head) entry_remove(s_lru_head);
+  memset(s_buckets, 0, sizeof(s_buckets));
+  s_bytes = 0;
+  s_entries = 0;
+}
+
+// ======================================================
+// Lookup / store
+// ======================================================
+int respcache_serve(struct mg_connection *c, int scope, int user_id,
+                    struct mg_str uri, struct mg_str query, struct respcache_gen *gen) {
+  // Fotografia das gerações antes da query: o store usa estas
+  gen->ex = (unsigned) s_gen_ex;
+  gen->data = gen_data(scope, user_id);
+  if (s_budget == 0) return 0;
+
+  char key[RESPCACHE_MAX_KEY];
+  size_t key_len = make_key(key, user_id, uri, query);
+  if (key_len == 0) return 0;
+
+  unsigned long h = key_hash(key, key_len);
+  struct rc_entry *e = entry_find(key, key_len, h);
+  if (e && (e->scope != scope || !entry_valid(e, gen))) {
+    entry_remove(e);
+    e = NULL;
+  }
+  if (!e) {
+    s_misses++;
+    return 0;
+  }
+
+  s_hits++;
+  lru_unlink(e);
+  lru_push_front(e);
+
+  mg_send(c, e->data + e->key_len, e->resp_len);
+  c->is_resp = 0;
+  return 1;
+}
+
+void respcache_store(struct mg_connection *c, size_t start, int scope, int user_id,
+                     struct mg_str uri, struct mg_str query, long long deadline,
+                     const struct respcache_gen *gen) {
+  if (s_budget == 0 || c->send.len <= start) return;
+
+  const char *resp = (const char *) c->send.buf + start;
+  size_t resp_len = c->send.len - start;
+  if (resp_len < 13 || memcmp(resp, "HTTP/1.1 200 ", 13) != 0) return;
+
+  char key[RESPCACHE_MAX_KEY];
+  size_t key_len = make_key(key, user_id, uri, query);
+  if (key_len == 0) return;
+
+  size_t size = sizeof(struct rc_entry) + key_len + resp_len;
+  if (size > s_budget / RESPCACHE_MAX_SHARE) return;
+
+  unsigned long h = key_hash(key, key_len);
+  struct rc_entry *old = entry_find(key, key_len, h);
+  if (old) entry_remove(old);
+
+  // Abrir espaço: sai o menos usado
+  while (s_lru_tail && s_bytes + size > s_budget) {
+    entry_remove(s_lru_tail);
+    s_evictions++;
+  }
+
+  struct rc_entry *e = (struct rc_entry *) malloc(size);
+  if (!e) return;
+  e->hash = h;
+  e->scope = scope;
+  e->gen_ex = gen->ex;
+  e->gen_data = gen->data;
+  e->deadline = deadline;
+  e->key_len = key_len;
+  e->resp_len = resp_len;
+  memcpy(e->data, key, key_len);
+  memcpy(e->data + key_len, resp, resp_len);
+
+  struct rc_entry **bucket = &s_buckets[h & (RESPCACHE_BUCKETS - 1)];
+  e->next = *bucket;
+  *bucket = e;
+  lru_push_front(e);
+  s_bytes += size;
+  s_entries++;
+}
+
+void respcache_etag(int scope, int user_id, long long deadline, char *buf, size_t len) {
+  snprintf(buf, len, "\"%llx.%x.%d.%x.%llx\"", s_boot, (unsigned) s_gen_ex,
+           scope == RESPCACHE_USER ? user_id : 0, gen_data(scope, user_id), deadline);
+}
+
+// ======================================================
+// Invalidação
+// ======================================================
+void respcache_bump_exercises(void) {
+  if (s_txn_open) s_txn_ex = 1;
+  else InterlockedIncrement(&s_gen_ex);
+}
+
+static void bump_user_now(int user_id) {
+  InterlockedIncrement(&s_gen_user[(unsigned) user_id & (RESPCACHE_USER_GENS - 1)]);
+  InterlockedIncrement(&s_gen_all);
+}
+
+void respcache_bump_user(int user_id) {
+  if (!s_txn_open) {
+    bump_user_now(user_id);
+    return;
+  }
+  for (int i = 0; i < s_txn_count; i++) {
+    if (s_txn_users[i] == user_id) return;
+  }
+  if (s_txn_count < RESPCACHE_TXN_USERS) s_txn_users[s_txn_count++] = user_id;
+  else s_txn_overflow = 1;
+}
+
+void respcache_txn_begin(void) {
+  s_txn_open = 1;
+  s_txn_count = 0;
+  s_txn_overflow = 0;
+  s_txn_ex = 0;
+}
+
+void respcache_txn_end(void) {
+  // Também depois de um ROLLBACK: um bump a mais só custa um miss
+  s_txn_open = 0;
+  for (int i = 0; i < s_txn_count; i++) bump_user_now(s_txn_users[i]);
+  if (s_txn_overflow) {
+    // Demasiados users no batch: invalida tudo (incluindo os que não couberam)
+    s_txn_ex = 1;
+    InterlockedIncrement(&s_gen_all);
+  }
+  if (s_txn_ex) InterlockedIncrement(&s_gen_ex);
+  s_txn_count = 0;
+  s_txn_overflow = 0;
+  s_txn_ex = 0;
+}
+
+void respcache_stats(struct respcache_stats *st) {
+  st->hits = s_hits;
+  st->misses = s_misses;
+  st->evictions = s_evictions;
+  st->entries = s_entries;
+  st->bytes = s_bytes;
+  st->budget = s_budget;
+}
@@ -0,0 +1,77 @@
+#ifndef RESPCACHE_H
+#define RESPCACHE_H
+
+#include <stddef.h>
+#include "mongoose.h"
+
+// Cache de respostas dos GETs que só dependem da BD (exercícios, workout
+// por id, stats, leaderboards). Chave = (user_id, uri, query); guarda a
+// resposta HTTP inteira (status + headers + corpo) e serve-a com um memcpy.
+//
+// Invalidação por contadores de geração, sem percorrer a cache: cada
+// entrada guarda as gerações de que depende e deixa de valer quando uma
+// delas muda. Os handlers de escrita fazem o bump:
+//   - exercícios (nomes aparecem em workouts/stats): invalida tudo
+//   - sets/workouts de um user: as entradas desse user e os leaderboards
+// Entradas inválidas saem no próximo lookup ou pelo LRU. Limite em bytes
+// (GYM_RESPCACHE_MB); ao passar, sai a entrada usada há mais tempo.
+//
+// Com vários workers cada um tem a sua tabela/LRU (budget a dividir por
+// eles) e as gerações são partilhadas (incrementos atómicos). Um GET guarda
+// as gerações que leu antes de ir à BD (respcache_gen, que acompanha o
+// pedido até ao executor e volta); um bump dentro de um batch do writer só é
+// aplicado depois do COMMIT, senão um leitor podia ler os dados antigos já
+// com a geração nova e guardá-los como válidos.
+
+#define RESPCACHE_DEFAULT_MB 16
+
+enum {
+  RESPCACHE_PUBLIC = 0,     // igual para todos (user_id 0), só depende dos exercícios
+  RESPCACHE_USER = 1,       // dados de um user
+  RESPCACHE_ALL_USERS = 2,  // dados de todos os users (leaderboards)
+};
+
+// budget = bytes no total (0 desliga a cache); chamar antes dos workers
+void respcache_init(size_t budget);
+
+// Na thread de cada worker: tabela própria com budget / nworkers
+void respcache_worker_init(int nworkers);
+void respcache_free(void);
+
+// Gerações vistas por um pedido antes da query
+struct respcache_gen {
+  unsigned ex, data;
+};
+
+// Hit: escreve a resposta guardada em c->send e retorna 1.
+// Preenche sempre gen (para o respcache_store do miss).
+int respcache_serve(struct mg_connection *c, int scope, int user_id,
+                    struct mg_str uri, struct mg_str query, struct respcache_gen *gen);
+
+// Guarda o que o handler escreveu em c->send desde "start" (só respostas 200).
+// deadline = epoch em que deixa de valer mesmo sem escritas (0 = nunca).
+void respcache_store(struct mg_connection *c, size_t start, int scope, int user_id,
+                     struct mg_str uri, struct mg_str query, long long deadline,
+                     const struct respcache_gen *gen);
+
+// ETag forte (com aspas) da versão atual dos dados de um âmbito: arranque do
+// servidor + gerações (+ user_id e deadline). Igual enquanto nada mudar.
+void respcache_etag(int scope, int user_id, long long deadline, char *buf, size_t len);
+
+// ------------------ Invalidação ------------------
+void respcache_bump_exercises(void);
+void respcache_bump_user(int user_id);
+
+// Batch do writer: os bumps entre begin e end ficam pendentes até ao end
+void respcache_txn_begin(void);
+void respcache_txn_end(void);
+
+// Contadores (para /health)
+struct respcache_stats {
+  unsigned long hits, misses, evictions;
+  unsigned long entries;
+  size_t bytes, budget;
+};
+void respcache_stats(struct respcache_stats *st);
+
+#endif
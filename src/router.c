@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "router.h"
+
+#define ROUTER_MAX_NODES   128
+#define ROUTER_MAX_SEGS    16
+
+struct route_node {
+  struct mg_str seg;                  // segmento literal (vazio na raiz / parâmetro / resto)
+  struct route_node *child, *next;    // filhos literais (lista) e irmão seguinte
+  struct route_node *param;           // ":nome"
+  struct route_node *rest;            // "*" (folha)
+  int nparams;                        // parâmetros no caminho até aqui
+  const struct route *route[ROUTE_METHODS];
+};
+
+// Nós num array estático: compilados uma vez, nunca libertados
+static struct route_node s_nodes[ROUTER_MAX_NODES];
+static int s_nnodes = 0;
+static struct route_node *s_root = NULL;
+
+static const struct route *s_routes = NULL;
+static int s_nroutes = 0;
+
+static const char *METHOD_NAMES[ROUTE_METHODS] = { "GET", "POST", "PUT", "DELETE" };
+
+static int method_index(struct mg_str m) {
+  switch (m.len) {
+    case 3:
+      if (memcmp(m.buf, "GET", 3) == 0) return ROUTE_GET;
+      if (memcmp(m.buf, "PUT", 3) == 0) return ROUTE_PUT;
+      return -1;
+    case 4: return memcmp(m.buf, "POST", 4) == 0 ? ROUTE_POST : -1;
+    case 6: return memcmp(m.buf, "DELETE", 6) == 0 ? ROUTE_DELETE : -1;
+    default: return -1;
+  }
+}
+
+// Inteiro > 0 só com dígitos; qualquer outra coisa dá 0
+static int parse_param(const char *s, size_t len) {
+  if (len == 0 || len > 10) return 0;
+  long long v = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (s[i] < '0' || s[i] > '9') return 0;
+    v = v * 10 + (s[i] - '0');
+  }
+  return v > 0 && v <= INT_MAX ? (int) v : 0;
+}
+
+// ======================================================
+// Compilação
+// ======================================================
+static struct route_node *node_new(struct mg_str seg, int nparams) {
+  if (s_nnodes >= ROUTER_MAX_NODES) return NULL;
+  struct route_node *n = &s_nodes[s_nnodes++];
+  memset(n, 0, sizeof(*n));
+  n->seg = seg;
+  n->nparams = nparams;
+  return n;
+}
+
+static struct route_node *child_literal(struct route_node *n, struct mg_str seg) {
+  struct route_node *ch;
+  for (ch = n->child; ch; ch = ch->next) {
+    if (ch->seg.len == seg.len && memcmp(ch->seg.buf, seg.buf, seg.len) == 0) return ch;
+  }
+  ch = node_new(seg, n->nparams);
+  if (!ch) return NULL;
+  ch->next = n->child;
+  n->child = ch;
+  return ch;
+}
+
+static int add_route(const struct route *r) {
+  const char *p = r->path;
+  if (!p || p[0] != '/' || r->method < 0 || r->method >= ROUTE_METHODS) return 0;
+
+  struct route_node *n = s_root;
+  p++;
+  while (*p && n) {
+    const char *end = strchr(p, '/');
+    if (!end) end = p + strlen(p);
+    struct mg_str seg = mg_str_n(p, (size_t) (end - p));
+
+    if (seg.len == 1 && seg.buf[0] == '*') {
+      if (*end) return 0;             // "*" só no fim
+      if (!n->rest) n->rest = node_new(mg_str_n(NULL, 0), n->nparams);
+      n = n->rest;
+    } else if (seg.len > 1 && seg.buf[0] == ':') {
+      if (n->nparams >= REQUEST_MAX_PARAMS) return 0;
+      if (!n->param) n->param = node_new(mg_str_n(NULL, 0), n->nparams + 1);
+      n = n->param;
+    } else if (seg.len > 0) {
+      n = child_literal(n, seg);
+    } else {
+      return 0;                       // "//" ou "/" no fim
+    }
+    p = *end ? end + 1 : end;
+  }
+  if (!n || n->route[r->method]) return 0;
+  n->route[r->method] = r;
+  return 1;
+}
+
+int router_init(const struct route *routes, int n) {
+  s_nnodes = 0;
+  s_root = node_new(mg_str_n(NULL, 0), 0);
+  s_routes = routes;
+  s_nroutes = n;
+
+  for (int i = 0; i < n; i++) {
+    if (!add_route(&routes[i])) {
+      printf("Erro no router: %s %s (repetida, inválida ou sem espaço)\n",
+             routes[i].method >= 0 && routes[i].method < ROUTE_METHODS
+               ? METHOD_NAMES[routes[i].method] : "?",
+             routes[i].path ? routes[i].path : "");
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// ======================================================
+// Match: um passo por segmento, literal > parâmetro > resto
+// ======================================================
+static int has_route(const struct route_node *n) {
+  for (int m = 0; m < ROUTE_METHODS; m++) {
+    if (n->route[m]) return 1;
+  }
+  return 0;
+}
+
+static const struct route_node *match(const struct route_node *n, const struct mg_str *seg,
+                                      int nseg, int *param) {
+  if (nseg == 0) return has_route(n) ? n : NULL;
+
+  for (const struct route_node *ch = n->child; ch; ch = ch->next) {
+    if (ch->seg.len == seg->len && memcmp(ch->seg.buf, seg->buf, seg->len) == 0) {
+      const struct route_node *m = match(ch, seg + 1, nseg - 1, param);
+      if (m) return m;
+      break;
+    }
+  }
+
+  if (n->param) {
+    param[n->nparams] = parse_param(seg->buf, seg->len);
+    const struct route_node *m = match(n->param, seg + 1, nseg - 1, param);
+    if (m) return m;
+    param[n->nparams] = 0;
+  }
+
+  return n->rest;
+}
+
+const struct route *router_match(struct mg_http_message *hm, int *param) {
+  for (int i = 0; i < REQUEST_MAX_PARAMS; i++) param[i] = 0;
+  int m = method_index(hm->method);
+  if (m < 0 || !s_root || hm->uri.len == 0 || hm->uri.buf[0] != '/') return NULL;
+
+  // "/" = raiz sem segmentos; "/a/" = "a" + segmento vazio
+  struct mg_str seg[ROUTER_MAX_SEGS];
+  int nseg = 0;
+  const char *p = hm->uri.buf + 1, *end = hm->uri.buf + hm->uri.len;
+  while (p < end || (nseg > 0 && p == end && p[-1] == '/')) {
+    if (nseg == ROUTER_MAX_SEGS) return NULL;
+    const char *slash = (const char *) memchr(p, '/', (size_t) (end - p));
+    const char *seg_end = slash ? slash : end;
+    seg[nseg++] = mg_str_n(p, (size_t) (seg_end - p));
+    if (!slash) break;
+    p = slash + 1;
+  }
+
+  const struct route_node *n = match(s_root, seg, nseg, param);
+  return n ? n->route[m] : NULL;
+}
+
+int router_routes(const struct route **routes) {
+  *routes = s_routes;
+  return s_nroutes;
+}
+
+int router_nodes(void) {
+  return s_nnodes;
+}
+
+const char *router_method_name(int method) {
+  return method >= 0 && method < ROUTE_METHODS ? METHOD_NAMES[method] : "?";
+}
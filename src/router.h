@@ -0,0 +1,52 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include "mongoose.h"
+#include "auth.h"
+
+// Tabela de rotas compilada no arranque numa trie de segmentos do path.
+// Um pedido percorre o URI uma só vez: em cada segmento tenta o filho
+// literal, depois o parâmetro (":nome", guardado como inteiro em
+// rq->param) e por fim o resto ("*", só no fim). No nó final escolhe a rota
+// pelo método. A trie só é lida depois do router_init (partilhada pelos
+// workers sem lock).
+//
+// Parâmetros: inteiro > 0 ou 0 se o segmento não for um (vazio, "abc",
+// "-1", overflow); os handlers respondem 400 a 0, como antes.
+
+enum { ROUTE_GET = 0, ROUTE_POST = 1, ROUTE_PUT = 2, ROUTE_DELETE = 3, ROUTE_METHODS = 4 };
+
+// Identidade exigida antes do handler (auth_require_*)
+enum { ROUTE_PUBLIC = 0, ROUTE_USER = 1, ROUTE_ADMIN = 2 };
+
+// Onde corre o handler: no event loop ou no executor de BD (dbexec.h)
+enum { ROUTE_INLINE = 0, ROUTE_READ = 1, ROUTE_WRITE = 2 };
+
+typedef void (*route_fn)(struct mg_connection *c, struct mg_http_message *hm,
+                         const struct request_ctx *rq);
+
+struct route {
+  int method;               // ROUTE_GET...
+  const char *path;         // "/workouts/:id/sets/:id", "/js/*"
+  route_fn fn;
+  int auth;                 // ROUTE_PUBLIC / ROUTE_USER / ROUTE_ADMIN
+  int exec;                 // ROUTE_INLINE / ROUTE_READ / ROUTE_WRITE
+  int cache;                // âmbito da cache de respostas (RESPCACHE_*), -1 = não
+  int cache_daily;          // 1 = a entrada da cache vale só até à meia-noite UTC
+};
+
+// Compila a tabela (routes tem de viver até ao fim). Retorna 1 se ok, 0 se
+// houver rotas repetidas, paths inválidos ou demasiados nós / parâmetros.
+int router_init(const struct route *routes, int n);
+
+// Rota do pedido (NULL = 404). param recebe os REQUEST_MAX_PARAMS inteiros
+// do path (os que a rota não usa ficam a 0).
+const struct route *router_match(struct mg_http_message *hm, int *param);
+
+// Tabela compilada (retorna o nº de rotas), nós usados na trie e nome do
+// método ("GET"...): para o --bench-router (bench.h)
+int router_routes(const struct route **routes);
+int router_nodes(void);
+const char *router_method_name(int method);
+
+#endif
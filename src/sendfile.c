@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <WinSock2.h>
+#include <windows.h>
+#include <mswsock.h>
+
+#include "sendfile.h"
+#include "http.h"
+
+#define TRANSMIT_MAX     0x7FFFFFFEu   // máximo do TransmitFile por chamada
+
+struct sf_state {
+  HANDLE file;
+  OVERLAPPED ov;              // TransmitFile em curso; ov.hEvent fica assinalado no fim
+  HANDLE wait;                // espera do thread pool sobre ov.hEvent (NULL = nenhuma)
+  DWORD chunk;                // bytes pedidos ao TransmitFile em curso (0 = nenhum)
+  uint64_t off, remaining;
+  struct mg_mgr *mgr;
+  unsigned long conn_id;
+  void (*prev_pfn)(struct mg_connection *, int, void *);
+  void *prev_pfn_data;
+};
+
+static SOCKET conn_socket(struct mg_connection *c) {
+  return (SOCKET) (size_t) c->fd;
+}
+
+// ======================================================
+// Range
+// ======================================================
+// "bytes=a-b", "bytes=a-", "bytes=-n". Retorna 1 com [from, to], 0 se não há
+// Range utilizável (ausente, vários intervalos, mal formado: serve-se tudo),
+// -1 se está fora do ficheiro (416)
+static int parse_range(struct mg_http_message *hm, uint64_t size, uint64_t *from, uint64_t *to) {
+  struct mg_str *h = mg_http_get_header(hm, "Range");
+  if (!h || h->len < 7 || strncmp(h->buf, "bytes=", 6) != 0) return 0;
+  for (size_t i = 6; i < h->len; i++) {
+    if (h->buf[i] == ',') return 0;
+  }
+
+  char spec[64];
+  if (h->len - 6 >= sizeof(spec)) return 0;
+  memcpy(spec, h->buf + 6, h->len - 6);
+  spec[h->len - 6] = '\0';
+
+  char *dash = strchr(spec, '-');
+  if (!dash) return 0;
+  *dash = '\0';
+  char *end = NULL;
+
+  if (spec[0] == '\0') {
+    unsigned long long n = strtoull(dash + 1, &end, 10);
+    if (end == dash + 1 || *end != '\0') return 0;
+    if (n == 0 || size == 0) return -1;
+    *from = n >= size ? 0 : size - n;
+    *to = size - 1;
+    return 1;
+  }
+
+  unsigned long long a = strtoull(spec, &end, 10);
+  if (end == spec || *end != '\0') return 0;
+  unsigned long long b = size ? size - 1 : 0;
+  if (dash[1] != '\0') {
+    b = strtoull(dash + 1, &end, 10);
+    if (*end != '\0' || b < a) return 0;
+    if (size && b >= size) b = size - 1;
+  }
+  if (a >= size) return -1;
+  *from = a;
+  *to = b;
+  return 1;
+}
+
+// ======================================================
+// Envio
+// ======================================================
+// Thread pool do Windows: o TransmitFile acabou, acordar o event loop da
+// ligação (o MG_EV_WAKEUP chega ao sendfile_cb). Se o wakeup se perder, o
+// MG_EV_POLL seguinte vê o fim na mesma.
+static VOID CALLBACK transmit_done(PVOID arg, BOOLEAN timed_out) {
+  struct sf_state *st = (struct sf_state *) arg;
+  (void) timed_out;
+  mg_wakeup(st->mgr, st->conn_id, "", 0);
+}
+
+// Espera o fim do transmit_done, se estiver a correr
+static void transmit_unwait(struct sf_state *st) {
+  if (st->wait) {
+    UnregisterWaitEx(st->wait, INVALID_HANDLE_VALUE);
+    st->wait = NULL;
+  }
+}
+
+// Próximo troço a partir de st->off. Retorna 0 se o TransmitFile falhou logo.
+static int transmit_start(struct mg_connection *c, struct sf_state *st) {
+  HANDLE ev = st->ov.hEvent;
+  memset(&st->ov, 0, sizeof(st->ov));
+  st->ov.hEvent = ev;
+  st->ov.Offset = (DWORD) st->off;
+  st->ov.OffsetHigh = (DWORD) (st->off >> 32);
+  st->chunk = st->remaining < TRANSMIT_MAX ? (DWORD) st->remaining : TRANSMIT_MAX;
+  ResetEvent(ev);
+
+  if (!TransmitFile(conn_socket(c), st->file, st->chunk, 0, &st->ov, NULL, 0)) {
+    int err = WSAGetLastError();
+    if (err != WSA_IO_PENDING && err != ERROR_IO_PENDING) {
+      st->chunk = 0;
+      return 0;
+    }
+  }
+  // Manual-reset: se já acabou, a espera dispara logo
+  if (!RegisterWaitForSingleObject(&st->wait, ev, transmit_done, st, INFINITE,
+                                   WT_EXECUTEONLYONCE)) {
+    st->wait = NULL;          // sem wakeup: o fim é visto no MG_EV_POLL
+  }
+  return 1;
+}
+
+// 1 = não há TransmitFile em curso (ou acabou bem), 0 = ainda a enviar, -1 = erro
+static int transmit_poll(struct mg_connection *c, struct sf_state *st) {
+  if (st->chunk == 0) return 1;
+
+  DWORD n = 0, flags = 0;
+  if (!WSAGetOverlappedResult(conn_socket(c), &st->ov, &n, FALSE, &flags)) {
+    if (WSAGetLastError() == WSA_IO_INCOMPLETE) return 0;
+    n = 0;
+  }
+  transmit_unwait(st);
+  int ok = n == st->chunk;    // menos = o ficheiro encolheu ou o cliente saiu
+  st->off += n;
+  st->remaining -= n;
+  st->chunk = 0;
+  return ok ? 1 : -1;
+}
+
+static void sf_finish(struct mg_connection *c) {
+  struct sf_state *st = (struct sf_state *) c->pfn_data;
+  if (st->chunk) {
+    // Ligação a fechar a meio do envio: o kernel larga o OVERLAPPED antes do free
+    DWORD n = 0, flags = 0;
+    CancelIoEx((HANDLE) conn_socket(c), &st->ov);
+    WSAGetOverlappedResult(conn_socket(c), &st->ov, &n, TRUE, &flags);
+  }
+  transmit_unwait(st);
+  CloseHandle(st->ov.hEvent);
+  CloseHandle(st->file);
+  c->pfn = st->prev_pfn;
+  c->pfn_data = st->prev_pfn_data;
+  c->is_resp = 0;
+  free(st);
+}
+
+static void sendfile_cb(struct mg_connection *c, int ev, void *ev_data) {
+  struct sf_state *st = (struct sf_state *) c->pfn_data;
+  (void) ev_data;
+
+  if (ev == MG_EV_CLOSE) {
+    sf_finish(c);
+    return;
+  }
+  if (ev != MG_EV_POLL && ev != MG_EV_WRITE && ev != MG_EV_WAKEUP) return;
+  if (c->send.len > 0) return;    // headers ainda a sair
+
+  int rc = transmit_poll(c, st);
+  if (rc == 0) return;
+  if (rc > 0 && st->remaining > 0 && transmit_start(c, st)) return;
+
+  // Erro: o Content-Length já saiu, só resta fechar
+  if (rc < 0 || st->remaining > 0) c->is_closing = 1;
+  sf_finish(c);
+}
+
+int sendfile_serve(struct mg_connection *c, struct mg_http_message *hm,
+                   const char *path, const char *mime) {
+  if (c->is_tls) return 0;
+
+  // Diretórios falham aqui (sem FILE_FLAG_BACKUP_SEMANTICS)
+  HANDLE file = CreateFileA(path, GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE) return 0;
+  BY_HANDLE_FILE_INFORMATION fi;
+  if (!GetFileInformationByHandle(file, &fi) || (fi.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+    CloseHandle(file);
+    return 0;
+  }
+  uint64_t size = ((uint64_t) fi.nFileSizeHigh << 32) | fi.nFileSizeLow;
+
+  // Mesmo formato do mongoose ("mtime.size", mtime em segundos Unix): o ETag
+  // não muda ao trocar de caminho
+  uint64_t ft = ((uint64_t) fi.ftLastWriteTime.dwHighDateTime << 32) |
+                fi.ftLastWriteTime.dwLowDateTime;
+  long long mtime = (long long) (ft / 10000000ULL) - 11644473600LL;
+  char etag[64];
+  snprintf(etag, sizeof(etag), "\"%lld.%lld\"", mtime, (long long) size);
+  if (etag_matches(hm, etag)) {
+    CloseHandle(file);
+    mg_printf(c, "HTTP/1.1 304 Not Modified\r\nEtag: %s\r\nContent-Length: 0\r\n\r\n", etag);
+    c->is_resp = 0;
+    return 1;
+  }
+
+  uint64_t from = 0, to = size ? size - 1 : 0;
+  int range = parse_range(hm, size, &from, &to);
+  if (range < 0) {
+    CloseHandle(file);
+    char header[64];
+    snprintf(header, sizeof(header), "Content-Range: bytes */%llu\r\n", (unsigned long long) size);
+    mg_http_reply(c, 416, header, "");
+    return 1;
+  }
+  uint64_t length = size ? to - from + 1 : 0;
+
+  if (range > 0) {
+    mg_printf(c, "HTTP/1.1 206 Partial Content\r\nContent-Type: %s\r\nEtag: %s\r\n"
+                 "Content-Range: bytes %llu-%llu/%llu\r\nAccept-Ranges: bytes\r\n"
+                 "Content-Length: %llu\r\n\r\n",
+              mime, etag, (unsigned long long) from, (unsigned long long) to,
+              (unsigned long long) size, (unsigned long long) length);
+  } else {
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nEtag: %s\r\nAccept-Ranges: bytes\r\n"
+                 "Content-Length: %llu\r\n\r\n",
+              mime, etag, (unsigned long long) length);
+  }
+
+  struct sf_state *st = length ? (struct sf_state *) calloc(1, sizeof(*st)) : NULL;
+  if (st) st->ov.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+  if (!st || !st->ov.hEvent) {
+    free(st);
+    CloseHandle(file);
+    if (length) c->is_closing = 1;   // sem memória: os headers já prometem um corpo
+    c->is_resp = 0;
+    return 1;
+  }
+  st->file = file;
+  st->off = from;
+  st->remaining = length;
+  st->mgr = c->mgr;
+  st->conn_id = c->id;
+  st->prev_pfn = c->pfn;
+  st->prev_pfn_data = c->pfn_data;
+  c->pfn = sendfile_cb;
+  c->pfn_data = st;
+  return 1;   // o TransmitFile arranca no MG_EV_WRITE/POLL, com os headers já enviados
+}
@@ -0,0 +1,22 @@
+#ifndef SENDFILE_H
+#define SENDFILE_H
+
+#include "mongoose.h"
+
+// Ficheiros do disco enviados com TransmitFile: o conteúdo vai da cache de
+// ficheiros do Windows para o socket sem passar pelo send buffer do
+// mongoose, que no mg_http_serve_dir é cheio com cópias de MG_IO_SIZE
+// bytes. Suporta Range (um intervalo, 206/416) e If-None-Match com o mesmo
+// ETag do mongoose.
+//
+// O TransmitFile é overlapped: o event loop não bloqueia. Uma espera do
+// thread pool sobre o evento do OVERLAPPED faz mg_wakeup à ligação quando
+// acaba (o MG_EV_POLL também o vê, se o wakeup se perder). Ligar com -lmswsock.
+
+// GET de path: responde (200/206/304/416) e retorna 1. Retorna 0 sem
+// escrever nada se não se aplica (TLS, não existe, diretório): o chamador
+// usa o caminho normal.
+int sendfile_serve(struct mg_connection *c, struct mg_http_message *hm,
+                   const char *path, const char *mime);
+
+#endif
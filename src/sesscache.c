@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <windows.h>
+
+#include "sesscache.h"
+#include "db.h"
+#include "stmtcache.h"
+#include "worker.h"
+#include "writeq.h"
+
+// Capacidade fixa (potência de 2), open addressing com linear probing
+#define SESSCACHE_SLOTS     4096
+#define SESSCACHE_MAX_PROBE 32
+#define SESSCACHE_TTL       300   // segundos até revalidar na BD
+
+enum { SLOT_EMPTY = 0, SLOT_LIVE = 1, SLOT_TOMBSTONE = 2 };
+
+struct sess_entry {
+  int state;
+  unsigned long hash;
+  char token[65];
+  int user_id;
+  char role[16];
+  long long deadline;   // epoch: min(now + TTL, expires_at)
+};
+
+// Partilhada pelos workers: lookups em paralelo (lock partilhado), put/evict
+// com lock exclusivo
+static struct sess_entry s_slots[SESSCACHE_SLOTS];
+static SRWLOCK s_lock = SRWLOCK_INIT;
+static volatile long s_hits = 0, s_misses = 0;
+
+// Sobe a cada revogação (com o lock exclusivo): um put com uma geração
+// anterior pode trazer uma sessão já apagada
+static volatile long s_revoke_gen = 0;
+
+// Revogações do batch do writer, à espera do COMMIT (um logout por job)
+static WORKER_LOCAL int s_txn_open = 0, s_txn_count = 0, s_txn_overflow = 0;
+static WORKER_LOCAL char s_txn_tokens[WRITEQ_MAX_BATCH][65];
+
+// FNV-1a
+static unsigned long token_hash(const char *token) {
+  unsigned long h = 2166136261u;
+  for (const unsigned char *p = (const unsigned char *) token; *p; p++) {
+    h ^= *p;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static struct sess_entry *find_live(const char *token, unsigned long h) {
+  for (unsigned long i = 0; i < SESSCACHE_MAX_PROBE; i++) {
+    struct sess_entry *e = &s_slots[(h + i) & (SESSCACHE_SLOTS - 1)];
+    if (e->state == SLOT_EMPTY) return NULL;
+    if (e->state == SLOT_LIVE && e->hash == h && strcmp(e->token, token) == 0) return e;
+  }
+  return NULL;
+}
+
+int sesscache_lookup(const char *token, struct request_ctx *ctx) {
+  AcquireSRWLockShared(&s_lock);
+  struct sess_entry *e = find_live(token, token_hash(token));
+
+  // Expirada: fica como está, o put já a trata como livre
+  if (!e || e->deadline <= (long long) time(NULL)) {
+    ReleaseSRWLockShared(&s_lock);
+    InterlockedIncrement(&s_misses);
+    return 0;
+  }
+
+  if (ctx) {
+    ctx->user_id = e->user_id;
+    snprintf(ctx->role, sizeof(ctx->role), "%s", e->role);
+  }
+  ReleaseSRWLockShared(&s_lock);
+  InterlockedIncrement(&s_hits);
+  return 1;
+}
+
+unsigned long sesscache_gen(void) {
+  return (unsigned long) InterlockedCompareExchange(&s_revoke_gen, 0, 0);
+}
+
+void sesscache_put(const char *token, int user_id, const char *role, long long expires_at,
+                   unsigned long gen) {
+  if (!token || strlen(token) >= sizeof(s_slots[0].token)) return;
+
+  long long now = (long long) time(NULL);
+  long long deadline = now + SESSCACHE_TTL;
+  if (expires_at > 0 && expires_at < deadline) deadline = expires_at;
+  if (deadline <= now) return;
+
+  unsigned long h = token_hash(token);
+  AcquireSRWLockExclusive(&s_lock);
+  if ((unsigned long) s_revoke_gen != gen) {
+    ReleaseSRWLockExclusive(&s_lock);
+    return;
+  }
+  struct sess_entry *target = NULL;   // 1º slot livre (vazio/tombstone/expirado)
+  struct sess_entry *oldest = NULL;   // vítima se a janela de probing estiver cheia
+
+  for (unsigned long i = 0; i < SESSCACHE_MAX_PROBE; i++) {
+    struct sess_entry *e = &s_slots[(h + i) & (SESSCACHE_SLOTS - 1)];
+
+    if (e->state == SLOT_LIVE && e->hash == h && strcmp(e->token, token) == 0) {
+      target = e;   // atualizar a própria entrada
+      break;
+    }
+    if (e->state != SLOT_LIVE || e->deadline <= now) {
+      if (!target) target = e;
+      if (e->state == SLOT_EMPTY) break;   // o token não está mais à frente
+      continue;
+    }
+    if (!oldest || e->deadline < oldest->deadline) oldest = e;
+  }
+
+  if (!target) target = oldest;
+  if (!target) {
+    ReleaseSRWLockExclusive(&s_lock);
+    return;
+  }
+
+  target->state = SLOT_LIVE;
+  target->hash = h;
+  snprintf(target->token, sizeof(target->token), "%s", token);
+  target->user_id = user_id;
+  snprintf(target->role, sizeof(target->role), "%s", role ? role : "");
+  target->deadline = deadline;
+  ReleaseSRWLockExclusive(&s_lock);
+}
+
+static void evict_now(const char *token) {
+  struct sess_entry *e = find_live(token, token_hash(token));
+  if (e) e->state = SLOT_TOMBSTONE;
+}
+
+void sesscache_evict(const char *token) {
+  if (s_txn_open) {
+    if (s_txn_count < WRITEQ_MAX_BATCH && strlen(token) < sizeof(s_txn_tokens[0])) {
+      snprintf(s_txn_tokens[s_txn_count++], sizeof(s_txn_tokens[0]), "%s", token);
+    } else {
+      s_txn_overflow = 1;
+    }
+    return;
+  }
+
+  AcquireSRWLockExclusive(&s_lock);
+  evict_now(token);
+  s_revoke_gen++;
+  ReleaseSRWLockExclusive(&s_lock);
+}
+
+void sesscache_txn_begin(void) {
+  s_txn_open = 1;
+  s_txn_count = 0;
+  s_txn_overflow = 0;
+}
+
+void sesscache_txn_end(int committed) {
+  s_txn_open = 0;
+  if (committed && (s_txn_count > 0 || s_txn_overflow)) {
+    AcquireSRWLockExclusive(&s_lock);
+    if (s_txn_overflow) {
+      // Token que não coube: revalidar tudo na BD
+      for (int i = 0; i < SESSCACHE_SLOTS; i++) {
+        if (s_slots[i].state == SLOT_LIVE) s_slots[i].state = SLOT_TOMBSTONE;
+      }
+    } else {
+      for (int i = 0; i < s_txn_count; i++) evict_now(s_txn_tokens[i]);
+    }
+    s_revoke_gen++;
+    ReleaseSRWLockExclusive(&s_lock);
+  }
+  s_txn_count = 0;
+  s_txn_overflow = 0;
+}
+
+void sesscache_stats(unsigned long *hits, unsigned long *misses) {
+  if (hits) *hits = (unsigned long) s_hits;
+  if (misses) *misses = (unsigned long) s_misses;
+}
+
+// ======================================================
+// Warm-up: sessões válidas mais recentes (metade da capacidade)
+// ======================================================
+void sesscache_warm(void) {
+  const char *sql =
+    "SELECT s.token, s.user_id, u.role, "
+    "       COALESCE(CAST(strftime('%s', s.expires_at) AS INTEGER), 0) "
+    "FROM sessions s "
+    "JOIN users u ON u.id = s.user_id "
+    "WHERE s.expires_at IS NULL OR s.expires_at > CURRENT_TIMESTAMP "
+    "ORDER BY s.id DESC "
+    "LIMIT ?;";
+
+  sqlite3_stmt *stmt = NULL;
+  int rc = stmtcache_prepare(sql, &stmt);
+  if (rc != SQLITE_OK || !stmt) {
+    printf("Erro ao carregar cache de sessões\n");
+    return;
+  }
+
+  sqlite3_bind_int(stmt, 1, SESSCACHE_SLOTS / 2);
+
+  int n = 0;
+  unsigned long gen = sesscache_gen();
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const unsigned char *token_u = sqlite3_column_text(stmt, 0);
+    const unsigned char *role_u  = sqlite3_column_text(stmt, 2);
+    if (!token_u) continue;
+
+    sesscache_put((const char *) token_u,
+                  sqlite3_column_int(stmt, 1),
+                  role_u ? (const char *) role_u : "",
+                  sqlite3_column_int64(stmt, 3), gen);
+    n++;
+  }
+
+  stmtcache_release(stmt);
+  printf("Cache de sessões: %d sessões carregadas\n", n);
+}
@@ -0,0 +1,41 @@
+#ifndef SESSCACHE_H
+#define SESSCACHE_H
+
+#include "auth.h"
+
+// Cache em memória de sessões já validadas (token -> user_id, role, expiração).
+// Evita o SELECT em sessions em cada pedido autenticado.
+// Cada entrada vive no máximo SESSCACHE_TTL segundos (ou até expires_at, se antes),
+// depois disso o token volta a ser validado na BD.
+// Uma só tabela para todos os workers (SRWLOCK: lookups em paralelo).
+
+// Carrega as sessões válidas mais recentes da BD (chamar depois de db_init)
+void sesscache_warm(void);
+
+// Retorna 1 e preenche ctx se o token estiver em cache e válido, 0 caso contrário
+int sesscache_lookup(const char *token, struct request_ctx *ctx);
+
+// Geração de revogações: ler antes de validar o token na BD e passar ao put
+unsigned long sesscache_gen(void);
+
+// Guarda/atualiza um token validado. expires_at = epoch UTC (0 = sem expiração).
+// Ignorado se houve uma revogação depois de "gen" (o SELECT pode ter lido a
+// sessão antes do DELETE do logout).
+void sesscache_put(const char *token, int user_id, const char *role, long long expires_at,
+                   unsigned long gen);
+
+// Revogação explícita (logout). Não há endpoints que alterem ou removam um user
+// existente; o rehash no login mantém a password, logo as sessões continuam válidas.
+// Dentro de um batch do writer só é aplicada no sesscache_txn_end, depois do
+// COMMIT (como os bumps da respcache).
+void sesscache_evict(const char *token);
+
+// Batch do writer: as revogações entre begin e end ficam pendentes; o end
+// aplica-as se committed, senão descarta-as (o DELETE foi desfeito)
+void sesscache_txn_begin(void);
+void sesscache_txn_end(int committed);
+
+// Contadores (para /health)
+void sesscache_stats(unsigned long *hits, unsigned long *misses);
+
+#endif
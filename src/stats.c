@@ -1,44 +1,93 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include "stats.h"
 #include "db.h"
+#include "stmtcache.h"
+#include "queries.h"
 #include "json.h"
+#include "colstore.h"
 
-void handle_get_stats_volume(struct mg_connection *c, struct mg_http_message *hm) {
-  char days_buf[16];
+// ======================================================
+// GET /stats/volume?days=N&bucket=day|week|month|year&max_points=N
+// Lê os rollups (mantidos por triggers): daily_volume para dias,
+// volume_rollup para semana/mês/ano. O(buckets), não O(sets).
+// Se o intervalo pedido der mais de max_points buckets, sobe para o
+// escalão seguinte; o escalão usado vai no header X-Bucket.
+// ======================================================
+#define VOLUME_MAX_DAYS       36500
+#define VOLUME_DEFAULT_POINTS 500
+#define VOLUME_MAX_POINTS     1000
+
+// Escalões por ordem de resolução; min_days = dias mínimos de um bucket
+static const struct {
+  const char *name;
+  int min_days;
+} VOLUME_BUCKETS[] = {
+  { "day", 1 }, { "week", 7 }, { "month", 28 }, { "year", 365 },
+};
+#define VOLUME_NBUCKETS ((int) (sizeof(VOLUME_BUCKETS) / sizeof(VOLUME_BUCKETS[0])))
+
+void handle_get_stats_volume(struct mg_connection *c, struct mg_http_message *hm,
+                             const struct request_ctx *ctx) {
+  char buf[16];
   int days = 7;
+  int max_points = VOLUME_DEFAULT_POINTS;
+  int bucket = 0;
+
+  if (mg_http_get_var(&hm->query, "days", buf, sizeof(buf)) > 0) {
+    int d = atoi(buf);
+    if (d > 0 && d <= VOLUME_MAX_DAYS) days = d;
+  }
+
+  if (mg_http_get_var(&hm->query, "max_points", buf, sizeof(buf)) > 0) {
+    int n = atoi(buf);
+    if (n > 0) max_points = n < VOLUME_MAX_POINTS ? n : VOLUME_MAX_POINTS;
+  }
+
+  if (mg_http_get_var(&hm->query, "bucket", buf, sizeof(buf)) > 0) {
+    for (bucket = 0; bucket < VOLUME_NBUCKETS; bucket++) {
+      if (strcmp(buf, VOLUME_BUCKETS[bucket].name) == 0) break;
+    }
+    if (bucket == VOLUME_NBUCKETS) {
+      mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"bucket must be day, week, month or year\" }\n");
+      return;
+    }
+  }
 
-  if (mg_http_get_var(&hm->query, "days", days_buf, sizeof(days_buf)) > 0) {
-    int d = atoi(days_buf);
-    if (d > 0 && d <= 3650) days = d; 
+  // Escalão mais fino (>= o pedido) que cabe em max_points; o 1º bucket
+  // pode ser parcial, daí o +1
+  while (bucket < VOLUME_NBUCKETS - 1 &&
+         days / VOLUME_BUCKETS[bucket].min_days + 1 > max_points) {
+    bucket++;
   }
 
   char modifier[32];
   snprintf(modifier, sizeof(modifier), "-%d days", days);
 
-  const char *sql =
-    "SELECT date(w.created_at) AS day, "
-    "       COALESCE(SUM(we.reps * we.weight), 0) AS volume "
-    "FROM workouts w "
-    "LEFT JOIN workout_exercises we ON we.workout_id = w.id "
-    "WHERE w.created_at >= datetime('now', ?) "
-    "GROUP BY day "
-    "ORDER BY day;";
+  const char *sql = bucket == 0 ? SQL_VOLUME_DAILY : SQL_VOLUME_ROLLUP;
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || stmt == NULL) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
     return;
   }
 
-  sqlite3_bind_text(stmt, 1, modifier, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 1, ctx->user_id);
+  if (bucket > 0) sqlite3_bind_text(stmt, 2, VOLUME_BUCKETS[bucket].name, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, modifier, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 4, max_points);
 
-  char json[8192];
-  int pos = 0;
-  pos += snprintf(json + pos, sizeof(json) - pos, "[");
+  char headers[48];
+  snprintf(headers, sizeof(headers), "X-Bucket: %s\r\n", VOLUME_BUCKETS[bucket].name);
+
+  struct json_writer w;
+  json_begin_headers(&w, c, 200, headers);
+  json_printf(&w, "[");
 
   int first = 1;
   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
@@ -46,53 +95,387 @@ void handle_get_stats_volume(struct mg_connection *c, struct mg_http_message *hm
     const char *day = day_u ? (const char *)day_u : "";
     double volume = sqlite3_column_double(stmt, 1);
 
-    char esc_day[64];
-    if (!json_escape(day, esc_day, sizeof(esc_day))) esc_day[0] = '\0';
-
-    pos += snprintf(json + pos, sizeof(json) - pos,
-                    "%s{ \"day\": \"%s\", \"volume\": %.3f }",
-                    first ? "" : ",",
-                    esc_day, volume);
+    json_printf(&w, "%s{ \"day\": %M, \"volume\": %M }",
+                first ? "" : ",",
+                json_esc, day, json_num, volume);
     first = 0;
+  }
+
+  stmtcache_release(stmt);
+
+  json_printf(&w, "]\n");
+  json_end(&w);
+}
+
+// ======================================================
+// Rebuild do rollup a partir dos sets (api.exe --rebuild-rollups)
+// ======================================================
+int stats_rebuild_daily_volume(void) {
+  const char *sql =
+    "BEGIN IMMEDIATE;"
+    "DELETE FROM daily_volume;"
+    // Escalões semana/mês/ano: partem do zero e são refeitos pelos
+    // triggers do daily_volume durante o INSERT
+    "DELETE FROM volume_rollup;"
+    "INSERT INTO daily_volume(user_id, day, volume, set_count, workout_count) "
+    "SELECT w.user_id, date(w.created_at), "
+    "       COALESCE(SUM(s.volume), 0), COALESCE(SUM(s.sets), 0), COUNT(*) "
+    "FROM workouts w "
+    "LEFT JOIN (SELECT workout_id, SUM(reps * weight) AS volume, COUNT(*) AS sets "
+    "           FROM workout_exercises GROUP BY workout_id) s ON s.workout_id = w.id "
+    "WHERE w.user_id IS NOT NULL "
+    "GROUP BY w.user_id, date(w.created_at);"
+    "COMMIT;";
+
+  char *err = NULL;
+  if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+    printf("Erro no rebuild dos rollups: %s\n", err ? err : "?");
+    sqlite3_free(err);
+    sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+    return -1;
+  }
+
+  return sqlite3_changes(db);
+}
+
+// ======================================================
+// GET /stats/e1rm?exercise_id=&days=N&formula=epley|brzycki&window=K
+// Série do 1RM estimado (melhor set de cada dia) lida de daily_e1rm,
+// mantida pelos triggers. Cada ponto leva "trend": valor da regressão
+// linear sobre os últimos K pontos (janela móvel); slope_per_week é a
+// inclinação sobre a série toda.
+// ======================================================
+#define E1RM_DEFAULT_DAYS   365
+#define E1RM_MAX_DAYS       36500
+#define E1RM_MAX_POINTS     1000
+#define E1RM_DEFAULT_WINDOW 8
+#define E1RM_MAX_WINDOW     64
+
+// Mínimos quadrados incremental: y = a + b*x
+struct linreg {
+  int n;
+  double sx, sy, sxx, sxy;
+};
+
+static void linreg_add(struct linreg *r, double x, double y) {
+  r->n++;
+  r->sx += x; r->sy += y;
+  r->sxx += x * x; r->sxy += x * y;
+}
+
+// Retorna 0 se não há declive (menos de 2 pontos / x todos iguais): b = 0, a = média
+static int linreg_fit(const struct linreg *r, double *a, double *b) {
+  double den = r->n * r->sxx - r->sx * r->sx;
+  if (r->n < 2 || den == 0) {
+    *b = 0;
+    *a = r->n > 0 ? r->sy / r->n : 0;
+    return 0;
+  }
+  *b = (r->n * r->sxy - r->sx * r->sy) / den;
+  *a = (r->sy - *b * r->sx) / r->n;
+  return 1;
+}
+
+static int exercise_exists(int exercise_id) {
+  sqlite3_stmt *stmt = NULL;
+  int rc = stmtcache_prepare("SELECT 1 FROM exercises WHERE id = ?;", &stmt);
+  if (rc != SQLITE_OK || stmt == NULL) return -1;
+  sqlite3_bind_int(stmt, 1, exercise_id);
+  rc = sqlite3_step(stmt);
+  stmtcache_release(stmt);
+  if (rc == SQLITE_ROW) return 1;
+  return rc == SQLITE_DONE ? 0 : -1;
+}
+
+void handle_get_stats_e1rm(struct mg_connection *c, struct mg_http_message *hm,
+                           const struct request_ctx *ctx) {
+  char buf[16];
+  int exercise_id = 0;
+  int days = E1RM_DEFAULT_DAYS;
+  int window = E1RM_DEFAULT_WINDOW;
+  int brzycki = 0;
+
+  if (mg_http_get_var(&hm->query, "exercise_id", buf, sizeof(buf)) > 0) {
+    exercise_id = atoi(buf);
+  }
+  if (exercise_id <= 0) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"exercise_id required\" }\n");
+    return;
+  }
 
-    if (pos > (int)sizeof(json) - 200) break;
+  if (mg_http_get_var(&hm->query, "days", buf, sizeof(buf)) > 0) {
+    int d = atoi(buf);
+    if (d > 0 && d <= E1RM_MAX_DAYS) days = d;
   }
 
-  sqlite3_finalize(stmt);
-  pos += snprintf(json + pos, sizeof(json) - pos, "]\n");
+  if (mg_http_get_var(&hm->query, "window", buf, sizeof(buf)) > 0) {
+    int k = atoi(buf);
+    if (k >= 2) window = k < E1RM_MAX_WINDOW ? k : E1RM_MAX_WINDOW;
+  }
+
+  if (mg_http_get_var(&hm->query, "formula", buf, sizeof(buf)) > 0) {
+    if (strcmp(buf, "brzycki") == 0) brzycki = 1;
+    else if (strcmp(buf, "epley") != 0) {
+      mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"formula must be epley or brzycki\" }\n");
+      return;
+    }
+  }
+
+  int exists = exercise_exists(exercise_id);
+  if (exists < 0) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"db query failed\" }\n");
+    return;
+  }
+  if (exists == 0) {
+    mg_http_reply(c, 404, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"exercise not found\" }\n");
+    return;
+  }
+
+  char modifier[32];
+  snprintf(modifier, sizeof(modifier), "-%d days", days);
+
+  const char *sql = brzycki ? SQL_E1RM_BRZYCKI : SQL_E1RM_EPLEY;
+
+  sqlite3_stmt *stmt = NULL;
+  int rc = stmtcache_prepare(sql, &stmt);
+  if (rc != SQLITE_OK || stmt == NULL) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"db prepare failed\" }\n");
+    return;
+  }
+
+  sqlite3_bind_int(stmt, 1, ctx->user_id);
+  sqlite3_bind_int(stmt, 2, exercise_id);
+  sqlite3_bind_text(stmt, 3, modifier, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 4, E1RM_MAX_POINTS);
+
+  struct json_writer w;
+  json_begin(&w, c, 200);
+  json_printf(&w, "{ \"exercise_id\": %d, \"formula\": \"%s\", \"window\": %d, \"points\": [",
+              exercise_id, brzycki ? "brzycki" : "epley", window);
+
+  // Janela móvel (circular) e regressão da série toda; x = dias desde o 1º ponto
+  double wx[E1RM_MAX_WINDOW], wy[E1RM_MAX_WINDOW];
+  struct linreg all = { 0 };
+  double x0 = 0;
+  int n = 0;
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const unsigned char *day_u = sqlite3_column_text(stmt, 0);
+    const char *day = day_u ? (const char *)day_u : "";
+    double e1rm = sqlite3_column_double(stmt, 1);
+    long long set_id = sqlite3_column_int64(stmt, 2);
+    double jd = sqlite3_column_double(stmt, 3);
+
+    if (n == 0) x0 = jd;
+    double x = jd - x0;
+
+    wx[n % window] = x;
+    wy[n % window] = e1rm;
+    n++;
 
-  mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
+    struct linreg win = { 0 };
+    for (int i = 0; i < n && i < window; i++) linreg_add(&win, wx[i], wy[i]);
+    double a, b;
+    linreg_fit(&win, &a, &b);
+
+    linreg_add(&all, x, e1rm);
+
+    json_printf(&w, "%s{ \"day\": %M, \"e1rm\": %M, \"set_id\": %lld, \"trend\": %M }",
+                n == 1 ? "" : ",",
+                json_esc, day, json_num, e1rm, set_id, json_num, a + b * x);
+  }
+
+  stmtcache_release(stmt);
+
+  // Declive da série toda (kg/semana), null com menos de 2 dias
+  double a, slope;
+  if (linreg_fit(&all, &a, &slope)) {
+    json_printf(&w, "], \"slope_per_week\": %M }\n", json_num, slope * 7);
+  } else {
+    json_printf(&w, "], \"slope_per_week\": null }\n");
+  }
+  json_end(&w);
 }
 
-void handle_get_stats_prs(struct mg_connection *c, struct mg_http_message *hm) {
+// ======================================================
+// GET /stats/histogram?exercise_id=&metric=weight|reps&bins=N&days=N
+// Distribuição dos sets de um exercício. Não há rollup para isto: com o
+// colstore ativo (GYM_COLSTORE=1) são dois loops sobre as colunas do
+// user, senão duas queries sobre os sets (mesmo resultado).
+// ======================================================
+#define HIST_DEFAULT_BINS 20
+#define HIST_MAX_BINS     100
+#define HIST_DEFAULT_DAYS 365
+#define HIST_MAX_DAYS     36500
+
+static const char *HIST_RANGE_SQL[] = { SQL_HIST_RANGE("weight"), SQL_HIST_RANGE("reps") };
+static const char *HIST_BINS_SQL[] = { SQL_HIST_BINS("weight"), SQL_HIST_BINS("reps") };
+
+long long stats_histogram_sql(int user_id, int exercise_id, int metric, int64_t from_ts,
+                              int bins, double *lo, double *width, unsigned *counts) {
+  memset(counts, 0, (size_t) bins * sizeof(*counts));
+  *lo = 0;
+  *width = 0;
+
+  sqlite3_stmt *stmt = NULL;
+  int rc = stmtcache_prepare(HIST_RANGE_SQL[metric], &stmt);
+  if (rc != SQLITE_OK || !stmt) return -1;
+
+  sqlite3_bind_int(stmt, 1, user_id);
+  sqlite3_bind_int64(stmt, 2, from_ts);
+  sqlite3_bind_int(stmt, 3, exercise_id);
+
+  rc = sqlite3_step(stmt);
+  double mn = sqlite3_column_double(stmt, 0);
+  double mx = sqlite3_column_double(stmt, 1);
+  long long count = sqlite3_column_int64(stmt, 2);
+  stmtcache_release(stmt);
+  if (rc != SQLITE_ROW) return -1;
+  if (count == 0) return 0;
+
+  double w = (mx - mn) / bins;
+  if (w <= 0) w = 1;
+
+  rc = stmtcache_prepare(HIST_BINS_SQL[metric], &stmt);
+  if (rc != SQLITE_OK || !stmt) return -1;
+
+  sqlite3_bind_int(stmt, 1, user_id);
+  sqlite3_bind_int64(stmt, 2, from_ts);
+  sqlite3_bind_int(stmt, 3, exercise_id);
+  sqlite3_bind_double(stmt, 4, mn);
+  sqlite3_bind_double(stmt, 5, w);
+  sqlite3_bind_int(stmt, 6, bins - 1);
+
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    int b = sqlite3_column_int(stmt, 0);
+    if (b >= 0 && b < bins) counts[b] = (unsigned) sqlite3_column_int64(stmt, 1);
+  }
+  stmtcache_release(stmt);
+  if (rc != SQLITE_DONE) return -1;
+
+  *lo = mn;
+  *width = w;
+  return count;
+}
+
+// %M: array de contagens
+static size_t print_counts(void (*out)(char, void *), void *arg, va_list *ap) {
+  const unsigned *counts = va_arg(*ap, const unsigned *);
+  int n = va_arg(*ap, int);
+  size_t len = 0;
+  for (int i = 0; i < n; i++) {
+    len += mg_xprintf(out, arg, "%s%u", i ? ", " : "", counts[i]);
+  }
+  return len;
+}
+
+void handle_get_stats_histogram(struct mg_connection *c, struct mg_http_message *hm,
+                                const struct request_ctx *ctx) {
+  char buf[16];
+  int exercise_id = 0;
+  int metric = COLSTORE_WEIGHT;
+  int bins = HIST_DEFAULT_BINS;
+  int days = HIST_DEFAULT_DAYS;
+
+  if (mg_http_get_var(&hm->query, "exercise_id", buf, sizeof(buf)) > 0) {
+    exercise_id = atoi(buf);
+  }
+  if (exercise_id <= 0) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"exercise_id required\" }\n");
+    return;
+  }
+
+  if (mg_http_get_var(&hm->query, "metric", buf, sizeof(buf)) > 0) {
+    if (strcmp(buf, "reps") == 0) metric = COLSTORE_REPS;
+    else if (strcmp(buf, "weight") != 0) {
+      mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"metric must be weight or reps\" }\n");
+      return;
+    }
+  }
+
+  if (mg_http_get_var(&hm->query, "bins", buf, sizeof(buf)) > 0) {
+    int b = atoi(buf);
+    if (b > 0) bins = b < HIST_MAX_BINS ? b : HIST_MAX_BINS;
+  }
+
+  if (mg_http_get_var(&hm->query, "days", buf, sizeof(buf)) > 0) {
+    int d = atoi(buf);
+    if (d > 0 && d <= HIST_MAX_DAYS) days = d;
+  }
+
+  // Meia-noite UTC de há N dias (como date('now', '-N days'))
+  int64_t from_ts = ((int64_t) time(NULL) / 86400 - days) * 86400;
+
+  unsigned counts[HIST_MAX_BINS];
+  double lo, width;
+  long long n = colstore_enabled()
+    ? colstore_histogram(ctx->user_id, exercise_id, metric, from_ts, bins, &lo, &width, counts)
+    : stats_histogram_sql(ctx->user_id, exercise_id, metric, from_ts, bins, &lo, &width, counts);
+
+  if (n < 0) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"db query failed\" }\n");
+    return;
+  }
+
+  struct json_writer w;
+  json_begin(&w, c, 200);
+  json_printf(&w,
+              "{ \"exercise_id\": %d, \"metric\": \"%s\", \"count\": %lld, "
+              "\"min\": %M, \"width\": %M, \"bins\": [%M] }\n",
+              exercise_id, metric == COLSTORE_REPS ? "reps" : "weight", n,
+              json_num, lo, json_num, width, print_counts, counts, n > 0 ? bins : 0);
+  json_end(&w);
+}
+
+// %M: coluna (stmt, índice) como inteiro / string JSON, ou null
+static size_t col_int(void (*out)(char, void *), void *arg, va_list *ap) {
+  sqlite3_stmt *stmt = va_arg(*ap, sqlite3_stmt *);
+  int col = va_arg(*ap, int);
+  if (sqlite3_column_type(stmt, col) == SQLITE_NULL) return mg_xprintf(out, arg, "null");
+  return mg_xprintf(out, arg, "%lld", (long long) sqlite3_column_int64(stmt, col));
+}
+
+static size_t col_text(void (*out)(char, void *), void *arg, va_list *ap) {
+  sqlite3_stmt *stmt = va_arg(*ap, sqlite3_stmt *);
+  int col = va_arg(*ap, int);
+  const unsigned char *v = sqlite3_column_text(stmt, col);
+  if (!v) return mg_xprintf(out, arg, "null");
+  return mg_xprintf(out, arg, "%M", json_esc, (const char *) v);
+}
+
+// ======================================================
+// GET /stats/prs (do próprio user)
+// Lê personal_records (mantida por triggers): um lookup pela PK por exercício
+// ======================================================
+void handle_get_stats_prs(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *ctx) {
   (void) hm;
 
-  // PRs por exercício:
+  // PRs por exercício, com o set que fez cada recorde e a data do workout:
   // - max_weight: maior peso levantado em qualquer set
   // - max_reps: maior reps em qualquer set
   // - max_volume: maior (reps*weight) num set
-  const char *sql =
-    "SELECT "
-    "  e.id, e.name, "
-    "  COALESCE(MAX(we.weight), 0) AS max_weight, "
-    "  COALESCE(MAX(we.reps), 0) AS max_reps, "
-    "  COALESCE(MAX(we.reps * we.weight), 0) AS max_volume "
-    "FROM exercises e "
-    "LEFT JOIN workout_exercises we ON we.exercise_id = e.id "
-    "GROUP BY e.id, e.name "
-    "ORDER BY e.id;";
-
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(SQL_PRS, &stmt);
   if (rc != SQLITE_OK || stmt == NULL) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                   "{ \"error\": \"db prepare failed\" }\n");
     return;
   }
 
-  char json[16384];
-  int pos = 0;
-  pos += snprintf(json + pos, sizeof(json) - pos, "[");
+  sqlite3_bind_int(stmt, 1, ctx->user_id);
+
+  struct json_writer w;
+  json_begin(&w, c, 200);
+  json_printf(&w, "[");
 
   int first = 1;
   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
@@ -101,24 +484,128 @@ void handle_get_stats_prs(struct mg_connection *c, struct mg_http_message *hm) {
     const char *name = name_u ? (const char *)name_u : "";
 
     double max_weight = sqlite3_column_double(stmt, 2);
-    int max_reps = sqlite3_column_int(stmt, 3);
-    double max_volume = sqlite3_column_double(stmt, 4);
+    int max_reps = sqlite3_column_int(stmt, 5);
+    double max_volume = sqlite3_column_double(stmt, 8);
 
-    char esc_name[1024];
-    if (!json_escape(name, esc_name, sizeof(esc_name))) esc_name[0] = '\0';
-
-    pos += snprintf(json + pos, sizeof(json) - pos,
-                    "%s{ \"exercise_id\": %d, \"exercise_name\": \"%s\", "
-                    "\"max_weight\": %.3f, \"max_reps\": %d, \"max_volume\": %.3f }",
-                    first ? "" : ",",
-                    ex_id, esc_name, max_weight, max_reps, max_volume);
+    json_printf(&w,
+                "%s{ \"exercise_id\": %d, \"exercise_name\": %M, "
+                "\"max_weight\": %M, \"max_weight_set_id\": %M, \"max_weight_at\": %M, "
+                "\"max_reps\": %d, \"max_reps_set_id\": %M, \"max_reps_at\": %M, "
+                "\"max_volume\": %M, \"max_volume_set_id\": %M, \"max_volume_at\": %M }",
+                first ? "" : ",",
+                ex_id, json_esc, name,
+                json_num, max_weight, col_int, stmt, 3, col_text, stmt, 4,
+                max_reps, col_int, stmt, 6, col_text, stmt, 7,
+                json_num, max_volume, col_int, stmt, 9, col_text, stmt, 10);
     first = 0;
+  }
+
+  stmtcache_release(stmt);
+
+  json_printf(&w, "]\n");
+  json_end(&w);
+}
+
+// ======================================================
+// GET /leaderboards/:exercise_id?metric=max_weight|max_reps|max_volume&k=N
+// Top-K de todos os users num exercício, a partir de personal_records
+// (um recorde por user, mantido pelos triggers). Os índices idx_pr_board_*
+// estão ordenados pela métrica: lê K entradas, não toca em workout_exercises.
+// ======================================================
+#define BOARD_DEFAULT_K 10
+#define BOARD_MAX_K     100
+
+static const struct {
+  const char *name;
+  const char *sql;
+} BOARD_METRICS[] = {
+  { "max_weight", SQL_BOARD("max_weight") },
+  { "max_reps",   SQL_BOARD("max_reps") },
+  { "max_volume", SQL_BOARD("max_volume") },
+};
+#define BOARD_NMETRICS ((int) (sizeof(BOARD_METRICS) / sizeof(BOARD_METRICS[0])))
+
+void handle_get_leaderboard(struct mg_connection *c, struct mg_http_message *hm,
+                            const struct request_ctx *ctx) {
+  char buf[16];
+  int exercise_id = ctx->param[0];
+  int k = BOARD_DEFAULT_K;
+  int metric = 0;
+
+  if (exercise_id <= 0) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"invalid exercise id\" }\n");
+    return;
+  }
+
+  if (mg_http_get_var(&hm->query, "k", buf, sizeof(buf)) > 0) {
+    int n = atoi(buf);
+    if (n > 0) k = n < BOARD_MAX_K ? n : BOARD_MAX_K;
+  }
+
+  if (mg_http_get_var(&hm->query, "metric", buf, sizeof(buf)) > 0) {
+    metric = -1;
+    for (int i = 0; i < BOARD_NMETRICS; i++) {
+      if (strcmp(buf, BOARD_METRICS[i].name) == 0) metric = i;
+    }
+    if (metric < 0) {
+      mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"metric must be max_weight, max_reps or max_volume\" }\n");
+      return;
+    }
+  }
+
+  int exists = exercise_exists(exercise_id);
+  if (exists < 0) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"db query failed\" }\n");
+    return;
+  }
+  if (exists == 0) {
+    mg_http_reply(c, 404, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"exercise not found\" }\n");
+    return;
+  }
+
+  sqlite3_stmt *stmt = NULL;
+  int rc = stmtcache_prepare(BOARD_METRICS[metric].sql, &stmt);
+  if (rc != SQLITE_OK || stmt == NULL) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"db prepare failed\" }\n");
+    return;
+  }
+
+  sqlite3_bind_int(stmt, 1, exercise_id);
+  sqlite3_bind_int(stmt, 2, k);
+
+  struct json_writer w;
+  json_begin(&w, c, 200);
+  json_printf(&w, "{ \"exercise_id\": %d, \"metric\": \"%s\", \"k\": %d, \"entries\": [",
+              exercise_id, BOARD_METRICS[metric].name, k);
+
+  // Empates partilham o rank (1, 2, 2, 4)
+  int pos = 0, rank = 0;
+  double prev = 0;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const unsigned char *name_u = sqlite3_column_text(stmt, 1);
+    const unsigned char *surname_u = sqlite3_column_text(stmt, 2);
+    double value = sqlite3_column_double(stmt, 3);
+
+    pos++;
+    if (pos == 1 || value != prev) rank = pos;
+    prev = value;
 
-    if (pos > (int)sizeof(json) - 400) break;
+    json_printf(&w,
+                "%s{ \"rank\": %d, \"user_id\": %d, \"name\": %M, \"surname\": %M, "
+                "\"value\": %M, \"set_id\": %M, \"at\": %M }",
+                pos == 1 ? "" : ",", rank, sqlite3_column_int(stmt, 0),
+                json_esc, name_u ? (const char *) name_u : "",
+                json_esc, surname_u ? (const char *) surname_u : "",
+                json_num, value, col_int, stmt, 4, col_text, stmt, 5);
   }
 
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
-  pos += snprintf(json + pos, sizeof(json) - pos, "]\n");
-  mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
+  json_printf(&w, "] }\n");
+  json_end(&w);
 }
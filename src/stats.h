@@ -2,12 +2,37 @@
 #define STATS_H
 
 #include "mongoose.h"
+#include "auth.h"
 
-// GET /stats/volume?days=N
-void handle_get_stats_volume(struct mg_connection *c, struct mg_http_message *hm);
+// GET /stats/volume?days=N&bucket=day|week|month|year&max_points=N (user autenticado)
+void handle_get_stats_volume(struct mg_connection *c, struct mg_http_message *hm,
+                             const struct request_ctx *ctx);
 
-// GET /stats/prs
-void handle_get_stats_prs(struct mg_connection *c, struct mg_http_message *hm);
+// GET /stats/prs (user autenticado)
+void handle_get_stats_prs(struct mg_connection *c, struct mg_http_message *hm,
+                          const struct request_ctx *ctx);
+
+// GET /stats/e1rm?exercise_id=&days=N&formula=epley|brzycki&window=K (user autenticado)
+void handle_get_stats_e1rm(struct mg_connection *c, struct mg_http_message *hm,
+                           const struct request_ctx *ctx);
+
+// GET /stats/histogram?exercise_id=&metric=weight|reps&bins=N&days=N (user autenticado)
+void handle_get_stats_histogram(struct mg_connection *c, struct mg_http_message *hm,
+                                const struct request_ctx *ctx);
+
+// GET /leaderboards/:exercise_id?metric=max_weight|max_reps|max_volume&k=N (user autenticado)
+void handle_get_leaderboard(struct mg_connection *c, struct mg_http_message *hm,
+                            const struct request_ctx *ctx);
+
+// Histograma do /stats/histogram pelas queries sobre os sets: mesmo contrato
+// que colstore_histogram (colstore.h), com que o --bench-colstore compara.
+// Retorna o nº de sets, -1 se erro.
+long long stats_histogram_sql(int user_id, int exercise_id, int metric, int64_t from_ts,
+                              int bins, double *lo, double *width, unsigned *counts);
+
+// Regenera daily_volume (e os escalões volume_rollup) a partir dos sets.
+// Retorna nº de linhas do daily_volume, -1 se erro.
+int stats_rebuild_daily_volume(void);
 
 
 #endif
\ No newline at end of file
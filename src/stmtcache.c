@@ -0,0 +1,100 @@
+#include <string.h>
+#include "stmtcache.h"
+#include "worker.h"
+
+// Tabela de hash com open addressing (linear probing), uma por thread
+// (os statements são da ligação dela).
+// Chega para todas as queries distintas da API com folga.
+#define STMTCACHE_SLOTS 256
+
+struct stmt_entry {
+  unsigned long hash;
+  sqlite3_stmt *stmt;   // NULL = slot livre
+  int in_use;
+};
+
+static WORKER_LOCAL struct stmt_entry s_slots[STMTCACHE_SLOTS];
+static WORKER_LOCAL int s_count = 0;
+static WORKER_LOCAL unsigned long s_hits = 0, s_misses = 0;
+
+// FNV-1a
+static unsigned long sql_hash(const char *sql) {
+  unsigned long h = 2166136261u;
+  for (const unsigned char *p = (const unsigned char *) sql; *p; p++) {
+    h ^= *p;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// Devolve o slot com este SQL, ou o slot livre onde deve entrar (ou NULL se cheia)
+static struct stmt_entry *find_slot(const char *sql, unsigned long h) {
+  for (unsigned long i = 0; i < STMTCACHE_SLOTS; i++) {
+    struct stmt_entry *e = &s_slots[(h + i) % STMTCACHE_SLOTS];
+    if (!e->stmt) return e;
+    if (e->hash == h && strcmp(sqlite3_sql(e->stmt), sql) == 0) return e;
+  }
+  return NULL;
+}
+
+int stmtcache_prepare(const char *sql, sqlite3_stmt **out) {
+  *out = NULL;
+
+  unsigned long h = sql_hash(sql);
+  struct stmt_entry *e = find_slot(sql, h);
+
+  // Hit: statement já preparado e livre
+  if (e && e->stmt && !e->in_use) {
+    e->in_use = 1;
+    s_hits++;
+    *out = e->stmt;
+    return SQLITE_OK;
+  }
+
+  s_misses++;
+
+  sqlite3_stmt *stmt = NULL;
+  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  if (rc != SQLITE_OK || !stmt) return rc != SQLITE_OK ? rc : SQLITE_ERROR;
+
+  // Guardar na cache se houver slot livre (deixa 1/4 livre para o probing)
+  if (e && !e->stmt && s_count < STMTCACHE_SLOTS * 3 / 4) {
+    e->hash = h;
+    e->stmt = stmt;
+    e->in_use = 1;
+    s_count++;
+  }
+
+  *out = stmt;
+  return SQLITE_OK;
+}
+
+void stmtcache_release(sqlite3_stmt *stmt) {
+  if (!stmt) return;
+
+  const char *sql = sqlite3_sql(stmt);
+  struct stmt_entry *e = sql ? find_slot(sql, sql_hash(sql)) : NULL;
+
+  // reset termina a transação de leitura (senão o checkpoint não avança)
+  if (e && e->stmt == stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    e->in_use = 0;
+  } else {
+    sqlite3_finalize(stmt);
+  }
+}
+
+void stmtcache_stats(unsigned long *hits, unsigned long *misses) {
+  if (hits) *hits = s_hits;
+  if (misses) *misses = s_misses;
+}
+
+void stmtcache_clear(void) {
+  for (int i = 0; i < STMTCACHE_SLOTS; i++) {
+    if (s_slots[i].stmt) sqlite3_finalize(s_slots[i].stmt);
+    s_slots[i].stmt = NULL;
+    s_slots[i].in_use = 0;
+  }
+  s_count = 0;
+}
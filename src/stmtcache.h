@@ -0,0 +1,27 @@
+#ifndef STMTCACHE_H
+#define STMTCACHE_H
+
+#include "db.h"
+
+// Cache de prepared statements da ligação da thread (db), chaveada pelo texto SQL.
+// Substitui o par sqlite3_prepare_v2 / sqlite3_finalize nos handlers:
+//   sqlite3_stmt *stmt = NULL;
+//   int rc = stmtcache_prepare(sql, &stmt);
+//   ... bind / step ...
+//   stmtcache_release(stmt);
+// O statement devolvido vem sempre "reset" e sem bindings.
+
+// Retorna SQLITE_OK (ou o erro do sqlite3_prepare_v2)
+int stmtcache_prepare(const char *sql, sqlite3_stmt **out);
+
+// Devolve o statement à cache (reset + clear bindings).
+// Se não for da cache (cache cheia / statement já em uso) faz finalize.
+void stmtcache_release(sqlite3_stmt *stmt);
+
+// Contadores (para /health)
+void stmtcache_stats(unsigned long *hits, unsigned long *misses);
+
+// Finaliza tudo (chamar antes de sqlite3_close)
+void stmtcache_clear(void);
+
+#endif
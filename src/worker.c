@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <windows.h>
+
+#include "worker.h"
+#include "mongoose.h"
+#include "http.h"
+#include "db.h"
+#include "hashpool.h"
+#include "dbexec.h"
+#include "respcache.h"
+#include "assets.h"
+#include "arena.h"
+
+
+#define WORKER_INBOX         256    // ligações aceites à espera de um worker
+
+// Ligação aceite pelo worker 0 para outro worker
+struct handoff {
+  MG_SOCKET_TYPE fd;
+  struct mg_addr rem, loc;
+  void (*pfn)(struct mg_connection *, int, void *);   // protocolo HTTP (static no mongoose)
+};
+
+struct worker {
+  int id;
+  HANDLE thread;
+  struct mg_mgr mgr;            // estático: hashpool / executor podem ainda fazer mg_wakeup no fim
+  volatile long state;          // 0 a arrancar, 1 a correr, -1 falhou
+  CRITICAL_SECTION lock;        // protege inbox
+  struct handoff inbox[WORKER_INBOX];
+  int inbox_len;
+};
+
+static struct worker s_workers[WORKERS_MAX];
+static int s_count = 0;
+static volatile long s_stop = 0;
+static char s_url[100];
+static unsigned s_next = 0;     // round-robin do worker 0
+
+static WORKER_LOCAL int s_id = 0;
+
+int worker_id(void) {
+  return s_id;
+}
+
+int worker_count(void) {
+  return s_count > 0 ? s_count : 1;
+}
+
+static void close_sock(MG_SOCKET_TYPE fd) {
+#ifdef _WIN32
+  closesocket(fd);
+#else
+  close((int) fd);
+#endif
+}
+
+// Interrompe o mg_mgr_poll do worker. Nenhuma ligação tem este id: o
+// mongoose só lê o pipe e volta ao loop.
+static void worker_wake(struct worker *w) {
+  mg_wakeup(&w->mgr, (unsigned long) -1, "", 0);
+}
+
+// ======================================================
+// Listener e repartição
+// ======================================================
+// Passa uma ligação acabada de aceitar para o próximo worker. Fica no
+// worker 0 se for a vez dele ou se a inbox do outro estiver cheia.
+static void worker_handoff(struct mg_connection *c) {
+  struct worker *w = &s_workers[s_next++ % (unsigned) s_count];
+  if (w->id == 0) return;
+
+  EnterCriticalSection(&w->lock);
+  int ok = w->inbox_len < WORKER_INBOX;
+  if (ok) {
+    struct handoff *h = &w->inbox[w->inbox_len++];
+    h->fd = (MG_SOCKET_TYPE) (size_t) c->fd;
+    h->rem = c->rem;
+    h->loc = c->loc;
+    h->pfn = c->pfn;
+  }
+  LeaveCriticalSection(&w->lock);
+  if (!ok) return;
+
+  // O socket passa a ser do outro worker: esta ligação fecha sem closesocket
+#if MG_ENABLE_EPOLL
+  epoll_ctl(c->mgr->epoll_fd, EPOLL_CTL_DEL, (int) (size_t) c->fd, NULL);
+#endif
+  c->fd = (void *) (size_t) MG_INVALID_SOCKET;
+  c->is_closing = 1;
+  worker_wake(w);
+}
+
+// fn do listener (e das ligações aceites, que o herdam)
+static void accept_fn(struct mg_connection *c, int ev, void *ev_data) {
+  if (ev == MG_EV_ACCEPT) {
+    c->fn = ev_handler;
+    if (s_count > 1) worker_handoff(c);
+    return;
+  }
+  ev_handler(c, ev, ev_data);
+}
+
+// Ligações que o worker 0 passou a este worker
+static void worker_adopt(struct worker *w) {
+  struct handoff in[WORKER_INBOX];
+  EnterCriticalSection(&w->lock);
+  int n = w->inbox_len;
+  memcpy(in, w->inbox, (size_t) n * sizeof(in[0]));
+  w->inbox_len = 0;
+  LeaveCriticalSection(&w->lock);
+
+  for (int i = 0; i < n; i++) {
+    // Já em modo não bloqueante (accept do mongoose)
+    struct mg_connection *c = mg_wrapfd(&w->mgr, (int) in[i].fd, ev_handler, NULL);
+    if (!c) {
+      close_sock(in[i].fd);
+      continue;
+    }
+    c->is_accepted = 1;
+    c->rem = in[i].rem;
+    c->loc = in[i].loc;
+    c->pfn = in[i].pfn;
+  }
+}
+
+// ======================================================
+// Loop de cada worker
+// ======================================================
+static DWORD WINAPI worker_main(LPVOID arg) {
+  struct worker *w = (struct worker *) arg;
+  struct mg_mgr *mgr = &w->mgr;
+  s_id = w->id;
+
+  mg_mgr_init(mgr);
+  if (!mg_wakeup_init(mgr) || !db_thread_open(0)) {
+    mg_mgr_free(mgr);
+    InterlockedExchange(&w->state, -1);
+    return 1;
+  }
+
+  respcache_worker_init(s_count);
+  if (s_count == 1) assets_watch(mgr);
+
+  // Só o worker 0 ouve; os outros recebem as ligações pela inbox
+  if (w->id == 0 && !mg_http_listen(mgr, s_url, accept_fn, NULL)) {
+    printf("Erro ao ouvir em %s\n", s_url);
+    mg_mgr_free(mgr);
+    db_thread_close();
+    InterlockedExchange(&w->state, -1);
+    return 1;
+  }
+  InterlockedExchange(&w->state, 1);
+
+  while (!s_stop) {
+    mg_mgr_poll(mgr, 1000);
+    worker_adopt(w);
+    hashpool_poll(mgr);
+    dbexec_poll(mgr);
+  }
+
+  mg_mgr_free(mgr);
+  // A ponta de escrita do mg_wakeup_init não é fechada pelo mg_mgr_free
+  if (mgr->pipe != MG_INVALID_SOCKET) {
+    close_sock(mgr->pipe);
+    mgr->pipe = MG_INVALID_SOCKET;
+  }
+  respcache_free();
+  dbexec_thread_free();
+  arena_thread_free();
+  db_thread_close();
+  return 0;
+}
+
+// ======================================================
+// Start / stop
+// ======================================================
+int workers_start(int n, const char *url) {
+  if (n < 1) n = 1;
+  if (n > WORKERS_MAX) n = WORKERS_MAX;
+  snprintf(s_url, sizeof(s_url), "%s", url);
+  s_stop = 0;
+  s_count = n;
+  s_next = 0;
+
+  int started = 0;
+  for (int i = 0; i < n; i++) {
+    struct worker *w = &s_workers[i];
+    w->id = i;
+    w->state = 0;
+    w->inbox_len = 0;
+    InitializeCriticalSection(&w->lock);
+    w->thread = CreateThread(NULL, 0, worker_main, w, 0, NULL);
+    if (!w->thread) {
+      DeleteCriticalSection(&w->lock);
+      printf("Erro ao criar worker %d\n", i);
+      break;
+    }
+    started++;
+  }
+
+  // Só retorna com o listener aberto e os loops a correr (ou falhados)
+  int running = 0;
+  for (int i = 0; i < started; i++) {
+    while (s_workers[i].state == 0) Sleep(1);
+    if (s_workers[i].state == 1) running++;
+  }
+  s_count = started;
+
+  if (running < n) {
+    workers_stop();
+    return 0;
+  }
+  return running;
+}
+
+void workers_stop(void) {
+  InterlockedExchange(&s_stop, 1);
+  for (int i = 0; i < s_count; i++) {
+    if (s_workers[i].state == 1) worker_wake(&s_workers[i]);
+  }
+  workers_wait();
+}
+
+void workers_wait(void) {
+  for (int i = 0; i < s_count; i++) {
+    if (!s_workers[i].thread) continue;
+    WaitForSingleObject(s_workers[i].thread, INFINITE);
+    CloseHandle(s_workers[i].thread);
+    s_workers[i].thread = NULL;
+    // Entregues depois do último worker_adopt (o worker 0, que entrega, já saiu)
+    for (int k = 0; k < s_workers[i].inbox_len; k++) close_sock(s_workers[i].inbox[k].fd);
+    s_workers[i].inbox_len = 0;
+    DeleteCriticalSection(&s_workers[i].lock);
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+// Servidor com N event loops (--workers N). Cada worker é uma thread com o
+// seu mg_mgr e a sua ligação SQLite (auth / sessões; as queries dos
+// handlers vão para o executor, dbexec.h). Só o worker 0 tem listener: cada
+// ligação aceite passa, em round-robin, para a inbox de um worker, que a
+// adota no seu mg_mgr (mg_wrapfd) e a serve até fechar. Com N = 1 é o
+// servidor de sempre.
+//
+// Estado por worker (uma cópia por thread): marcar com WORKER_LOCAL.
+// O que é partilhado (sessões, gerações da cache de respostas, hash pool,
+// executor da BD, assets) tem o seu próprio lock / operações atómicas.
+
+#define WORKER_LOCAL __thread
+#define WORKERS_MAX  64
+
+// Arranca n workers a ouvir em url ("http://0.0.0.0:8000"); a BD, caches
+// e hash pool já têm de estar iniciados. Retorna o nº de workers a correr.
+int workers_start(int n, const char *url);
+
+// Espera que todos terminem (depois de workers_stop, ou para sempre)
+void workers_wait(void);
+void workers_stop(void);
+
+// Nº do worker da thread atual (0..n-1) e total a correr
+int worker_id(void);
+int worker_count(void);
+
+#endif
@@ -1,10 +1,18 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
 
 #include "workouts.h"
 #include "db.h"
+#include "stmtcache.h"
+#include "queries.h"
 #include "json.h"
 #include "auth.h"
+#include "http.h"
+#include "colstore.h"
+#include "respcache.h"
+#include "arena.h"
 
 // ------------------ Helpers JSON parse ------------------
 static int json_get_int_field(const char *json, const char *field, int *out) {
@@ -47,84 +55,86 @@ static int json_get_double_field(const char *json, const char *field, double *ou
   return 1;
 }
 
-static int parse_id_from_uri(const char *uri, const char *fmt, int *out) {
-  int v = -1;
-  if (sscanf(uri, fmt, &v) != 1 || v <= 0) return 0;
-  *out = v;
-  return 1;
-}
-
 static void reply_db_prepare_failed(struct mg_connection *c) {
   mg_http_reply(c, 500, "Content-Type: application/json\r\n",
                 "{ \"error\": \"db prepare failed\" }\n");
 }
 
+// 1 = workout é do user, 0 = não existe / não é dele, -1 = erro de BD
+static int workout_owned(int workout_id, int user_id) {
+  sqlite3_stmt *s = NULL;
+  int rc = stmtcache_prepare(SQL_WORKOUT_OWNED, &s);
+  if (rc != SQLITE_OK || !s) return -1;
+  sqlite3_bind_int(s, 1, workout_id);
+  sqlite3_bind_int(s, 2, user_id);
+  rc = sqlite3_step(s);
+  stmtcache_release(s);
+  if (rc == SQLITE_ROW) return 1;
+  return rc == SQLITE_DONE ? 0 : -1;
+}
+
 // ------------------ GET /workouts ------------------
-void handle_get_workouts(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+// ?limit=N&after_id=<cursor> (mais recentes primeiro)
+// Resposta: { "items": [...], "next_cursor": "..." | null }
+void handle_get_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  int user_id = ctx->user_id;
 
-  const char *sql =
-    "SELECT id, created_at "
-    "FROM workouts "
-    "WHERE user_id = ? "
-    "ORDER BY id DESC;";
+  int limit = 0, after_id = 0;
+  if (!get_page_params(hm, &limit, &after_id)) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"invalid limit/after_id\" }\n");
+    return;
+  }
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(SQL_WORKOUTS_PAGE, &stmt);
   if (rc != SQLITE_OK || !stmt) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt, 1, user_id);
+  sqlite3_bind_int(stmt, 2, after_id > 0 ? after_id : 2147483647);
+  sqlite3_bind_int(stmt, 3, limit + 1);   // +1 para saber se há próxima página
 
-  char json[8192];
-  int pos = 0;
-  pos += snprintf(json + pos, (int)sizeof(json) - pos, "[");
+  struct json_writer w;
+  json_begin(&w, c, 200);
+  json_printf(&w, "{ \"items\": [");
 
-  int first = 1;
+  int n = 0, last_id = 0, more = 0;
   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    if (n == limit) { more = 1; break; }
+
     int id = sqlite3_column_int(stmt, 0);
     const unsigned char *dt_u = sqlite3_column_text(stmt, 1);
     const char *dt = dt_u ? (const char *)dt_u : "";
 
-    char esc_dt[128];
-    if (!json_escape(dt, esc_dt, sizeof(esc_dt))) esc_dt[0] = '\0';
-
-    pos += snprintf(json + pos, (int)sizeof(json) - pos,
-                    "%s{ \"id\": %d, \"created_at\": \"%s\" }",
-                    first ? "" : ",",
-                    id, esc_dt);
-    first = 0;
-
-    if (pos > (int)sizeof(json) - 200) break;
+    json_printf(&w, "%s{ \"id\": %d, \"created_at\": %M }",
+                n == 0 ? "" : ",",
+                id, json_esc, dt);
+    last_id = id;
+    n++;
   }
 
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
-  pos += snprintf(json + pos, (int)sizeof(json) - pos, "]\n");
-  mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
+  if (more) json_printf(&w, "], \"next_cursor\": \"%d\" }\n", last_id);
+  else json_printf(&w, "], \"next_cursor\": null }\n");
+  json_end(&w);
 }
 
 // ------------------ GET /workouts/:id ------------------
-void handle_get_workouts_id(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+void handle_get_workouts_id(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  (void) hm;
+  int user_id = ctx->user_id;
 
-  int workout_id = -1;
-  if (!parse_id_from_uri(hm->uri.buf, "/workouts/%d", &workout_id)) {
+  int workout_id = ctx->param[0];
+  if (workout_id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid id\" }\n");
     return;
   }
 
   // 1) confirmar que o workout é do user
-  const char *sql_w =
-    "SELECT id, created_at "
-    "FROM workouts "
-    "WHERE id = ? AND user_id = ? "
-    "LIMIT 1;";
-
   sqlite3_stmt *stmt_w = NULL;
-  int rc = sqlite3_prepare_v2(db, sql_w, -1, &stmt_w, NULL);
+  int rc = stmtcache_prepare(SQL_WORKOUT_GET, &stmt_w);
   if (rc != SQLITE_OK || !stmt_w) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt_w, 1, workout_id);
@@ -132,39 +142,29 @@ void handle_get_workouts_id(struct mg_connection *c, struct mg_http_message *hm)
 
   rc = sqlite3_step(stmt_w);
   if (rc != SQLITE_ROW) {
-    sqlite3_finalize(stmt_w);
+    stmtcache_release(stmt_w);
     mg_http_reply(c, 404, "Content-Type: application/json\r\n",
                   "{ \"error\": \"not found\" }\n");
     return;
   }
 
   const unsigned char *dt_u = sqlite3_column_text(stmt_w, 1);
-  const char *dt = dt_u ? (const char *)dt_u : "";
-  char esc_dt[128];
-  if (!json_escape(dt, esc_dt, sizeof(esc_dt))) esc_dt[0] = '\0';
+  char dt[64];
+  snprintf(dt, sizeof(dt), "%s", dt_u ? (const char *)dt_u : "");
 
-  sqlite3_finalize(stmt_w);
+  stmtcache_release(stmt_w);
 
   // 2) listar sets desse workout (com nome do exercício)
-  const char *sql_s =
-    "SELECT we.id, we.exercise_id, e.name, we.reps, we.weight "
-    "FROM workout_exercises we "
-    "JOIN exercises e ON e.id = we.exercise_id "
-    "WHERE we.workout_id = ? "
-    "ORDER BY we.id;";
-
   sqlite3_stmt *stmt_s = NULL;
-  rc = sqlite3_prepare_v2(db, sql_s, -1, &stmt_s, NULL);
+  rc = stmtcache_prepare(SQL_WORKOUT_SETS, &stmt_s);
   if (rc != SQLITE_OK || !stmt_s) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt_s, 1, workout_id);
 
-  char json[16384];
-  int pos = 0;
-
-  pos += snprintf(json + pos, (int)sizeof(json) - pos,
-                  "{ \"id\": %d, \"created_at\": \"%s\", \"sets\": [",
-                  workout_id, esc_dt);
+  struct json_writer w;
+  json_begin(&w, c, 200);
+  json_printf(&w, "{ \"id\": %d, \"created_at\": %M, \"sets\": [",
+              workout_id, json_esc, dt);
 
   int first = 1;
   while ((rc = sqlite3_step(stmt_s)) == SQLITE_ROW) {
@@ -175,40 +175,37 @@ void handle_get_workouts_id(struct mg_connection *c, struct mg_http_message *hm)
     int reps = sqlite3_column_int(stmt_s, 3);
     double weight = sqlite3_column_double(stmt_s, 4);
 
-    char esc_name[1024];
-    if (!json_escape(name, esc_name, sizeof(esc_name))) esc_name[0] = '\0';
-
-    pos += snprintf(json + pos, (int)sizeof(json) - pos,
-      "%s{ \"id\": %d, \"exercise_id\": %d, \"exercise_name\": \"%s\", \"reps\": %d, \"weight\": %.3f }",
+    json_printf(&w,
+      "%s{ \"id\": %d, \"exercise_id\": %d, \"exercise_name\": %M, \"reps\": %d, \"weight\": %M }",
       first ? "" : ",",
-      set_id, ex_id, esc_name, reps, weight);
+      set_id, ex_id, json_esc, name, reps, json_num, weight);
 
     first = 0;
-
-    if (pos > (int)sizeof(json) - 400) break;
   }
 
-  sqlite3_finalize(stmt_s);
+  stmtcache_release(stmt_s);
 
-  pos += snprintf(json + pos, (int)sizeof(json) - pos, "] }\n");
-  mg_http_reply(c, 200, "Content-Type: application/json\r\n", "%s", json);
+  json_printf(&w, "] }\n");
+  json_end(&w);
 }
 
 // ------------------ POST /workouts ------------------
-void handle_post_workouts(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+// Escritas (ROUTE_WRITE): o handler corre no writer, dentro da transação
+// do batch (group commit, ver writeq.h)
+void handle_post_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  (void) hm;
+  int user_id = ctx->user_id;
 
   const char *sql = "INSERT INTO workouts(user_id) VALUES (?);";
   sqlite3_stmt *stmt = NULL;
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || !stmt) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt, 1, user_id);
 
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -217,25 +214,27 @@ void handle_post_workouts(struct mg_connection *c, struct mg_http_message *hm) {
   }
 
   int id = (int) sqlite3_last_insert_rowid(db);
-  mg_http_reply(c, 201, "Content-Type: application/json\r\n",
-                "{ \"id\": %d }\n", id);
+  respcache_bump_user(user_id);
+
+  mg_http_reply(c, 201, "Content-Type: application/json\r\n", "{ \"id\": %d }\n", id);
 }
 
 // ------------------ PUT /workouts/:id ------------------
 // Por agora devolve "not implemented"
-void handle_put_workouts(struct mg_connection *c, struct mg_http_message *hm) {
+void handle_put_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
   (void) hm;
+  (void) ctx;
   mg_http_reply(c, 501, "Content-Type: application/json\r\n",
                 "{ \"error\": \"not implemented\" }\n");
 }
 
 // ------------------ DELETE /workouts/:id ------------------
-void handle_delete_workouts(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+void handle_delete_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  (void) hm;
+  int user_id = ctx->user_id;
 
-  int workout_id = -1;
-  if (!parse_id_from_uri(hm->uri.buf, "/workouts/%d", &workout_id)) {
+  int workout_id = ctx->param[0];
+  if (workout_id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid id\" }\n");
     return;
@@ -246,14 +245,14 @@ void handle_delete_workouts(struct mg_connection *c, struct mg_http_message *hm)
     "DELETE FROM workouts WHERE id = ? AND user_id = ?;";
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  int rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || !stmt) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt, 1, workout_id);
   sqlite3_bind_int(stmt, 2, user_id);
 
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -267,52 +266,35 @@ void handle_delete_workouts(struct mg_connection *c, struct mg_http_message *hm)
     return;
   }
 
+  colstore_workout_deleted(user_id, workout_id);
+  respcache_bump_user(user_id);
+
   mg_http_reply(c, 204, "", "");
 }
 
 // ------------------ POST /workouts/:id/sets ------------------
-void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  int user_id = ctx->user_id;
+  int workout_id = ctx->param[0];
+  int exercise_id = 0, reps = 0;
+  double weight = 0.0;
 
-  int workout_id = -1;
-  if (sscanf(hm->uri.buf, "/workouts/%d/sets", &workout_id) != 1 || workout_id <= 0) {
+  if (workout_id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid workout id\" }\n");
     return;
   }
 
-  // Confirmar que o workout é do user
-  {
-    const char *sql = "SELECT 1 FROM workouts WHERE id = ? AND user_id = ? LIMIT 1;";
-    sqlite3_stmt *s = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &s, NULL);
-    if (rc != SQLITE_OK || !s) { reply_db_prepare_failed(c); return; }
-    sqlite3_bind_int(s, 1, workout_id);
-    sqlite3_bind_int(s, 2, user_id);
-    rc = sqlite3_step(s);
-    sqlite3_finalize(s);
-    if (rc != SQLITE_ROW) {
-      mg_http_reply(c, 404, "Content-Type: application/json\r\n",
-                    "{ \"error\": \"workout not found\" }\n");
-      return;
-    }
-  }
-
   if (hm->body.len == 0 || hm->body.len > 512) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid body\" }\n");
     return;
   }
 
-  char body[513];
-  memcpy(body, hm->body.buf, hm->body.len);
-  body[hm->body.len] = '\0';
-
-  int exercise_id = 0, reps = 0;
-  double weight = 0.0;
-
-  if (!json_get_int_field(body, "exercise_id", &exercise_id) ||
+  // Os helpers usam sscanf: cópia com '\0' na arena do pedido
+  char *body = arena_strndup(hm->body.buf, hm->body.len);
+  if (!body ||
+      !json_get_int_field(body, "exercise_id", &exercise_id) ||
       !json_get_int_field(body, "reps", &reps) ||
       !json_get_double_field(body, "weight", &weight)) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
@@ -326,15 +308,24 @@ void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm
     return;
   }
 
+  // Confirmar que o workout é do user (dentro da transação: não corre contra um DELETE)
+  int rc = workout_owned(workout_id, user_id);
+  if (rc < 0) { reply_db_prepare_failed(c); return; }
+  if (rc == 0) {
+    mg_http_reply(c, 404, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"workout not found\" }\n");
+    return;
+  }
+
   // Confirmar que exercise existe
   {
     const char *sql = "SELECT 1 FROM exercises WHERE id = ? LIMIT 1;";
     sqlite3_stmt *s = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &s, NULL);
+    rc = stmtcache_prepare(sql, &s);
     if (rc != SQLITE_OK || !s) { reply_db_prepare_failed(c); return; }
     sqlite3_bind_int(s, 1, exercise_id);
     rc = sqlite3_step(s);
-    sqlite3_finalize(s);
+    stmtcache_release(s);
     if (rc != SQLITE_ROW) {
       mg_http_reply(c, 404, "Content-Type: application/json\r\n",
                     "{ \"error\": \"exercise not found\" }\n");
@@ -347,7 +338,7 @@ void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm
     "VALUES (?, ?, ?, ?);";
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  rc = stmtcache_prepare(sql, &stmt);
   if (rc != SQLITE_OK || !stmt) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt, 1, workout_id);
@@ -356,7 +347,7 @@ void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm
   sqlite3_bind_double(stmt, 4, weight);
 
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -365,56 +356,199 @@ void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm
   }
 
   int set_id = (int) sqlite3_last_insert_rowid(db);
+  colstore_set_changed(user_id, set_id);
+  respcache_bump_user(user_id);
 
   mg_http_reply(c, 201, "Content-Type: application/json\r\n",
-                "{ \"id\": %d, \"workout_id\": %d, \"exercise_id\": %d, \"reps\": %d, \"weight\": %.3f }\n",
-                set_id, workout_id, exercise_id, reps, weight);
+            "{ \"id\": %d, \"workout_id\": %d, \"exercise_id\": %d, \"reps\": %d, \"weight\": %.3f }\n",
+            set_id, workout_id, exercise_id, reps, weight);
 }
 
-// ------------------ PUT /workouts/:id/sets/:set_id ------------------
-void handle_put_workout_set(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+// ------------------ POST /workouts/:id/sets:batch ------------------
+// Body: { "sets": [ { "exercise_id": 1, "reps": 8, "weight": 80 }, ... ] }
+// Tudo ou nada: uma verificação de ownership, uma query para os exercise_ids,
+// todos os INSERTs no mesmo SAVEPOINT. Resposta: ids criados, pela ordem do body.
+#define SETS_BATCH_MAX 200
+
+struct batch_set {
+  int exercise_id;
+  int reps;
+  double weight;
+};
+
+// %M: lista de ids separada por vírgulas
+static size_t print_ids(void (*out)(char, void *), void *arg, va_list *ap) {
+  const int *ids = va_arg(*ap, const int *);
+  int n = va_arg(*ap, int);
+  size_t len = 0;
+  for (int i = 0; i < n; i++) {
+    len += mg_xprintf(out, arg, "%s%d", i ? ", " : "", ids[i]);
+  }
+  return len;
+}
 
-  int workout_id = -1, set_id = -1;
-  if (sscanf(hm->uri.buf, "/workouts/%d/sets/%d", &workout_id, &set_id) != 2 ||
-      workout_id <= 0 || set_id <= 0) {
+void handle_post_workout_sets_batch(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  int user_id = ctx->user_id;
+  int workout_id = ctx->param[0];
+  if (workout_id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"invalid ids\" }\n");
+                  "{ \"error\": \"invalid workout id\" }\n");
+    return;
+  }
+
+  struct mg_str arr = mg_json_get_tok(hm->body, "$.sets");
+  if (arr.len < 2 || arr.buf[0] != '[') {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"missing sets\" }\n");
+    return;
+  }
+
+  struct batch_set *sets = (struct batch_set *) arena_alloc(SETS_BATCH_MAX * sizeof(*sets));
+  if (!sets) {
+    mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"out of memory\" }\n");
+    return;
+  }
+  int count = 0;
+
+  struct mg_str key, val;
+  size_t ofs = 0;
+  while ((ofs = mg_json_next(arr, ofs, &key, &val)) > 0) {
+    if (count >= SETS_BATCH_MAX) {
+      mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"too many sets (max %d)\" }\n", SETS_BATCH_MAX);
+      return;
+    }
+
+    double exercise_id = 0, reps = 0, weight = 0;
+    if (!mg_json_get_num(val, "$.exercise_id", &exercise_id) ||
+        !mg_json_get_num(val, "$.reps", &reps) ||
+        !mg_json_get_num(val, "$.weight", &weight)) {
+      mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"missing fields\", \"index\": %d }\n", count);
+      return;
+    }
+
+    if (exercise_id < 1 || exercise_id > 2147483647.0 || exercise_id != (int) exercise_id ||
+        reps < 1 || reps > 2147483647.0 || reps != (int) reps || weight <= 0) {
+      mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"invalid values\", \"index\": %d }\n", count);
+      return;
+    }
+
+    struct batch_set *set = &sets[count++];
+    set->exercise_id = (int) exercise_id;
+    set->reps = (int) reps;
+    set->weight = weight;
+  }
+
+  if (count == 0) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"missing sets\" }\n");
     return;
   }
 
-  // Confirmar que o workout é do user
+  int rc = workout_owned(workout_id, user_id);
+  if (rc < 0) { reply_db_prepare_failed(c); return; }
+  if (rc == 0) {
+    mg_http_reply(c, 404, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"workout not found\" }\n");
+    return;
+  }
+
+  // Todos os exercise_ids numa só query (array JSON + json_each)
   {
-    const char *sql = "SELECT 1 FROM workouts WHERE id = ? AND user_id = ? LIMIT 1;";
+    char list[SETS_BATCH_MAX * 12 + 2];
+    size_t n = 0;
+    list[n++] = '[';
+    for (int i = 0; i < count; i++) {
+      n += (size_t) snprintf(list + n, sizeof(list) - n, "%s%d", i ? "," : "", sets[i].exercise_id);
+    }
+    snprintf(list + n, sizeof(list) - n, "]");
+
+    const char *sql =
+      "SELECT j.value FROM json_each(?) j "
+      "LEFT JOIN exercises e ON e.id = j.value "
+      "WHERE e.id IS NULL LIMIT 1;";
     sqlite3_stmt *s = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &s, NULL);
+    rc = stmtcache_prepare(sql, &s);
     if (rc != SQLITE_OK || !s) { reply_db_prepare_failed(c); return; }
-    sqlite3_bind_int(s, 1, workout_id);
-    sqlite3_bind_int(s, 2, user_id);
+    sqlite3_bind_text(s, 1, list, -1, SQLITE_TRANSIENT);
     rc = sqlite3_step(s);
-    sqlite3_finalize(s);
-    if (rc != SQLITE_ROW) {
+    int missing = rc == SQLITE_ROW ? sqlite3_column_int(s, 0) : 0;
+    stmtcache_release(s);
+
+    if (rc == SQLITE_ROW) {
       mg_http_reply(c, 404, "Content-Type: application/json\r\n",
-                    "{ \"error\": \"workout not found\" }\n");
+                    "{ \"error\": \"exercise not found\", \"exercise_id\": %d }\n", missing);
+      return;
+    }
+    if (rc != SQLITE_DONE) {
+      mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"db query failed\" }\n");
       return;
     }
   }
 
-  if (hm->body.len == 0 || hm->body.len > 512) {
-    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
-                  "{ \"error\": \"invalid body\" }\n");
-    return;
+  const char *sql =
+    "INSERT INTO workout_exercises(workout_id, exercise_id, reps, weight) "
+    "VALUES (?, ?, ?, ?);";
+
+  sqlite3_stmt *stmt = NULL;
+  rc = stmtcache_prepare(sql, &stmt);
+  if (rc != SQLITE_OK || !stmt) { reply_db_prepare_failed(c); return; }
+
+  int ids[SETS_BATCH_MAX];
+  sqlite3_bind_int(stmt, 1, workout_id);
+
+  for (int i = 0; i < count; i++) {
+    sqlite3_bind_int(stmt, 2, sets[i].exercise_id);
+    sqlite3_bind_int(stmt, 3, sets[i].reps);
+    sqlite3_bind_double(stmt, 4, sets[i].weight);
+
+    rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    if (rc != SQLITE_DONE) {
+      stmtcache_release(stmt);
+      mg_http_reply(c, 500, "Content-Type: application/json\r\n",
+                    "{ \"error\": \"insert failed\", \"index\": %d }\n", i);
+      return;
+    }
+    ids[i] = (int) sqlite3_last_insert_rowid(db);
+    colstore_set_changed(user_id, ids[i]);
   }
 
-  char body[513];
-  memcpy(body, hm->body.buf, hm->body.len);
-  body[hm->body.len] = '\0';
+  stmtcache_release(stmt);
+  respcache_bump_user(user_id);
+
+  mg_http_reply(c, 201, "Content-Type: application/json\r\n",
+                "{ \"workout_id\": %d, \"ids\": [%M] }\n", workout_id, print_ids, ids, count);
+}
 
+// ------------------ PUT /workouts/:id/sets/:set_id ------------------
+void handle_put_workout_set(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  int user_id = ctx->user_id;
+  int workout_id = ctx->param[0];
+  int set_id = ctx->param[1];
   int reps = 0;
   double weight = 0.0;
 
-  if (!json_get_int_field(body, "reps", &reps) ||
+  if (workout_id <= 0 || set_id <= 0) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"invalid ids\" }\n");
+    return;
+  }
+
+  if (hm->body.len == 0 || hm->body.len > 512) {
+    mg_http_reply(c, 400, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"invalid body\" }\n");
+    return;
+  }
+
+  // Os helpers usam sscanf: cópia com '\0' na arena do pedido
+  char *body = arena_strndup(hm->body.buf, hm->body.len);
+  if (!body ||
+      !json_get_int_field(body, "reps", &reps) ||
       !json_get_double_field(body, "weight", &weight)) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"missing fields\" }\n");
@@ -427,13 +561,16 @@ void handle_put_workout_set(struct mg_connection *c, struct mg_http_message *hm)
     return;
   }
 
-  const char *sql =
-    "UPDATE workout_exercises "
-    "SET reps = ?, weight = ? "
-    "WHERE id = ? AND workout_id = ?;";
+  int rc = workout_owned(workout_id, user_id);
+  if (rc < 0) { reply_db_prepare_failed(c); return; }
+  if (rc == 0) {
+    mg_http_reply(c, 404, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"workout not found\" }\n");
+    return;
+  }
 
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  rc = stmtcache_prepare(SQL_SET_UPDATE, &stmt);
   if (rc != SQLITE_OK || !stmt) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt, 1, reps);
@@ -442,7 +579,7 @@ void handle_put_workout_set(struct mg_connection *c, struct mg_http_message *hm)
   sqlite3_bind_int(stmt, 4, workout_id);
 
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -455,55 +592,43 @@ void handle_put_workout_set(struct mg_connection *c, struct mg_http_message *hm)
                   "{ \"error\": \"not found\" }\n");
     return;
   }
+  colstore_set_changed(user_id, set_id);
+  respcache_bump_user(user_id);
 
   mg_http_reply(c, 200, "Content-Type: application/json\r\n",
-                "{ \"id\": %d, \"workout_id\": %d, \"reps\": %d, \"weight\": %.3f }\n",
-                set_id, workout_id, reps, weight);
+            "{ \"id\": %d, \"workout_id\": %d, \"reps\": %d, \"weight\": %.3f }\n",
+            set_id, workout_id, reps, weight);
 }
 
 // ------------------ DELETE /workouts/:id/sets/:set_id ------------------
-void handle_delete_workout_set(struct mg_connection *c, struct mg_http_message *hm) {
-  int user_id = 0;
-  if (!auth_require_user(c, hm, &user_id)) return;
+void handle_delete_workout_set(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx) {
+  (void) hm;
+  int user_id = ctx->user_id;
 
-  int workout_id = -1, set_id = -1;
-  if (sscanf(hm->uri.buf, "/workouts/%d/sets/%d", &workout_id, &set_id) != 2 ||
-      workout_id <= 0 || set_id <= 0) {
+  int workout_id = ctx->param[0], set_id = ctx->param[1];
+  if (workout_id <= 0 || set_id <= 0) {
     mg_http_reply(c, 400, "Content-Type: application/json\r\n",
                   "{ \"error\": \"invalid ids\" }\n");
     return;
   }
 
-  // Confirmar que o workout é do user
-  {
-    const char *sql = "SELECT 1 FROM workouts WHERE id = ? AND user_id = ? LIMIT 1;";
-    sqlite3_stmt *s = NULL;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &s, NULL);
-    if (rc != SQLITE_OK || !s) { reply_db_prepare_failed(c); return; }
-    sqlite3_bind_int(s, 1, workout_id);
-    sqlite3_bind_int(s, 2, user_id);
-    rc = sqlite3_step(s);
-    sqlite3_finalize(s);
-    if (rc != SQLITE_ROW) {
-      mg_http_reply(c, 404, "Content-Type: application/json\r\n",
-                    "{ \"error\": \"workout not found\" }\n");
-      return;
-    }
+  int rc = workout_owned(workout_id, user_id);
+  if (rc < 0) { reply_db_prepare_failed(c); return; }
+  if (rc == 0) {
+    mg_http_reply(c, 404, "Content-Type: application/json\r\n",
+                  "{ \"error\": \"workout not found\" }\n");
+    return;
   }
 
-  const char *sql =
-    "DELETE FROM workout_exercises "
-    "WHERE id = ? AND workout_id = ?;";
-
   sqlite3_stmt *stmt = NULL;
-  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  rc = stmtcache_prepare(SQL_SET_DELETE, &stmt);
   if (rc != SQLITE_OK || !stmt) { reply_db_prepare_failed(c); return; }
 
   sqlite3_bind_int(stmt, 1, set_id);
   sqlite3_bind_int(stmt, 2, workout_id);
 
   rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  stmtcache_release(stmt);
 
   if (rc != SQLITE_DONE) {
     mg_http_reply(c, 500, "Content-Type: application/json\r\n",
@@ -517,5 +642,8 @@ void handle_delete_workout_set(struct mg_connection *c, struct mg_http_message *
     return;
   }
 
+  colstore_set_deleted(user_id, set_id);
+  respcache_bump_user(user_id);
+
   mg_http_reply(c, 204, "", "");
 }
@@ -2,17 +2,19 @@
 #define WORKOUTS_H
 
 #include "mongoose.h"
+#include "auth.h"
 
 // Workouts
-void handle_get_workouts(struct mg_connection *c, struct mg_http_message *hm);
-void handle_get_workouts_id(struct mg_connection *c, struct mg_http_message *hm);
-void handle_post_workouts(struct mg_connection *c, struct mg_http_message *hm);
-void handle_put_workouts(struct mg_connection *c, struct mg_http_message *hm);
-void handle_delete_workouts(struct mg_connection *c, struct mg_http_message *hm);
+void handle_get_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
+void handle_get_workouts_id(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
+void handle_post_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
+void handle_put_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
+void handle_delete_workouts(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
 
 // Sets
-void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm);
-void handle_put_workout_set(struct mg_connection *c, struct mg_http_message *hm);
-void handle_delete_workout_set(struct mg_connection *c, struct mg_http_message *hm);
+void handle_post_workout_set(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
+void handle_post_workout_sets_batch(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
+void handle_put_workout_set(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
+void handle_delete_workout_set(struct mg_connection *c, struct mg_http_message *hm, const struct request_ctx *ctx);
 
 #endif
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include <windows.h>
+
+#include "writeq.h"
+#include "dbexec.h"
+#include "db.h"
+#include "stmtcache.h"
+#include "colstore.h"
+#include "respcache.h"
+#include "sesscache.h"
+#include "arena.h"
+
+static HANDLE s_thread = NULL;
+static volatile long s_state = 0;     // 0 a arrancar, 1 a correr, -1 falhou
+static int s_stop = 0;
+static int s_depth = DBEXEC_DEFAULT_WRITE_DEPTH;
+
+static CRITICAL_SECTION s_lock;
+static CONDITION_VARIABLE s_cv;
+
+static struct dbexec_job *s_head = NULL, *s_tail = NULL;
+static int s_count = 0;
+
+static volatile long s_batches = 0, s_jobs = 0;
+
+// Statements de controlo (ficam na stmtcache como qualquer outro).
+// Retorna o rc do SQLite (SQLITE_DONE = ok)
+static int run_sql(const char *sql) {
+  sqlite3_stmt *stmt = NULL;
+  int rc = stmtcache_prepare(sql, &stmt);
+  if (rc != SQLITE_OK || !stmt) return rc != SQLITE_OK ? rc : SQLITE_ERROR;
+  rc = sqlite3_step(stmt);
+  stmtcache_release(stmt);
+  return rc;
+}
+
+// BEGIN/COMMIT falhados: com a BD ocupada (o lock de escrita só é pedido
+// aqui) o pedido pode ser repetido, por isso 503 como nas filas cheias
+static void fail_batch_job(struct dbexec_job *job, int rc, const char *error) {
+  if (db_is_busy(rc)) dbexec_job_fail(job, 503, "server busy, try again");
+  else dbexec_job_fail(job, 500, error);
+}
+
+void writeq_reply(struct writeq_result *res, int status, const char *fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  res->status = status;
+  res->body = arena_vprintf(fmt, &ap);
+  va_end(ap);
+}
+
+// ======================================================
+// Batch: BEGIN, um SAVEPOINT por job, COMMIT, respostas
+// ======================================================
+static void run_batch(struct dbexec_job *batch) {
+  // IMMEDIATE: pega já no lock de escrita, não falha a meio do batch por SQLITE_BUSY
+  respcache_txn_begin();
+  sesscache_txn_begin();
+  int rc = run_sql("BEGIN IMMEDIATE;");
+  int ok = rc == SQLITE_DONE;
+
+  for (struct dbexec_job *job = batch; job; job = job->next) {
+    if (!ok) {
+      fail_batch_job(job, rc, "db begin failed");
+      continue;
+    }
+
+    if (run_sql("SAVEPOINT writeq_job;") != SQLITE_DONE) {
+      dbexec_job_fail(job, 500, "db savepoint failed");
+      continue;
+    }
+
+    int mark = colstore_txn_mark();
+    if (dbexec_job_run(job) >= 400) {
+      run_sql("ROLLBACK TO writeq_job;");
+      colstore_txn_rollback(mark);
+    }
+    run_sql("RELEASE writeq_job;");
+  }
+
+  if (ok && (rc = run_sql("COMMIT;")) != SQLITE_DONE) {
+    printf("Erro no COMMIT do batch: %s\n", sqlite3_errmsg(db));
+    run_sql("ROLLBACK;");
+    for (struct dbexec_job *job = batch; job; job = job->next) {
+      if (job->status < 400) fail_batch_job(job, rc, "db commit failed");
+    }
+    ok = 0;
+  }
+
+  // Cópia em colunas (se ativa): só o que ficou commitado
+  if (ok) colstore_txn_commit();
+  else colstore_txn_abort();
+
+  // Invalidação da cache de respostas e revogação de sessões só depois do
+  // COMMIT (ver respcache.h, sesscache.h)
+  respcache_txn_end();
+  sesscache_txn_end(ok);
+
+  InterlockedIncrement(&s_batches);
+
+  // Só agora (dados já no WAL) é que os clientes recebem a resposta
+  while (batch) {
+    struct dbexec_job *next = batch->next;
+    batch->next = NULL;
+    InterlockedIncrement(&s_jobs);
+    dbexec_job_done(batch);
+    batch = next;
+  }
+}
+
+// Tira da fila até WRITEQ_MAX_BATCH jobs (com o lock)
+static struct dbexec_job *take_batch(void) {
+  struct dbexec_job *batch = s_head, *last = s_head;
+  int n = 1;
+  while (n < WRITEQ_MAX_BATCH && last->next) {
+    last = last->next;
+    n++;
+  }
+
+  s_head = last->next;
+  if (!s_head) s_tail = NULL;
+  last->next = NULL;
+  s_count -= n;
+  return batch;
+}
+
+static DWORD WINAPI writer_main(LPVOID arg) {
+  (void) arg;
+  if (!db_thread_open(0)) {
+    InterlockedExchange(&s_state, -1);
+    return 1;
+  }
+  InterlockedExchange(&s_state, 1);
+
+  for (;;) {
+    EnterCriticalSection(&s_lock);
+    while (!s_stop && s_head == NULL) {
+      SleepConditionVariableCS(&s_cv, &s_lock, INFINITE);
+    }
+    if (s_head == NULL) {   // s_stop e fila vazia
+      LeaveCriticalSection(&s_lock);
+      break;
+    }
+    struct dbexec_job *batch = take_batch();
+    LeaveCriticalSection(&s_lock);
+
+    run_batch(batch);
+  }
+
+  db_thread_close();
+  arena_thread_free();
+  return 0;
+}
+
+// ======================================================
+// Start / stop / submit
+// ======================================================
+int writeq_start(int depth) {
+  s_depth = depth > 0 ? depth : DBEXEC_DEFAULT_WRITE_DEPTH;
+  s_stop = 0;
+  s_state = 0;
+  InitializeCriticalSection(&s_lock);
+  InitializeConditionVariable(&s_cv);
+
+  s_thread = CreateThread(NULL, 0, writer_main, NULL, 0, NULL);
+  if (!s_thread) {
+    printf("Erro ao criar o writer\n");
+    DeleteCriticalSection(&s_lock);
+    return 0;
+  }
+
+  // Só retorna com a ligação aberta (ou falhada)
+  while (s_state == 0) Sleep(1);
+  if (s_state < 0) {
+    writeq_stop();
+    return 0;
+  }
+  return 1;
+}
+
+void writeq_stop(void) {
+  if (!s_thread) return;
+
+  EnterCriticalSection(&s_lock);
+  s_stop = 1;
+  WakeAllConditionVariable(&s_cv);
+  LeaveCriticalSection(&s_lock);
+
+  WaitForSingleObject(s_thread, INFINITE);
+  CloseHandle(s_thread);
+  s_thread = NULL;
+
+  s_state = 0;
+  DeleteCriticalSection(&s_lock);
+}
+
+int writeq_push(struct dbexec_job *job) {
+  if (s_state != 1) return 0;
+
+  EnterCriticalSection(&s_lock);
+  if (s_stop || s_count >= s_depth) {
+    LeaveCriticalSection(&s_lock);
+    return 0;
+  }
+  job->next = NULL;
+  if (s_tail) s_tail->next = job;
+  else s_head = job;
+  s_tail = job;
+  s_count++;
+  WakeConditionVariable(&s_cv);
+  LeaveCriticalSection(&s_lock);
+  return 1;
+}
+
+int writeq_submit(struct mg_connection *c, struct mg_http_message *hm, writeq_fn fn,
+                  const void *arg, size_t arg_len) {
+  struct dbexec_job *job = dbexec_job_new(c, hm, arg, arg_len);
+  if (!job) return 0;
+  job->wfn = fn;
+  if (!writeq_push(job)) {
+    dbexec_job_free(job);
+    return 0;
+  }
+  return 1;
+}
+
+int writeq_queued(void) {
+  if (!s_thread) return 0;
+  EnterCriticalSection(&s_lock);
+  int n = s_count;
+  LeaveCriticalSection(&s_lock);
+  return n;
+}
+
+void writeq_stats(unsigned long *batches, unsigned long *jobs) {
+  if (batches) *batches = (unsigned long) s_batches;
+  if (jobs) *jobs = (unsigned long) s_jobs;
+}
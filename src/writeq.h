@@ -0,0 +1,55 @@
+#ifndef WRITEQ_H
+#define WRITEQ_H
+
+#include "mongoose.h"
+
+// Group commit numa thread própria: o writer do executor de BD (dbexec.h),
+// com a sua ligação SQLite. Os jobs (handlers ROUTE_WRITE do router e
+// writeq_submit) entram numa fila limitada; o writer tira tudo o que lá
+// estiver (até WRITEQ_MAX_BATCH) e corre-os numa única transação. Enquanto
+// um batch corre, os pedidos seguintes acumulam para o próximo, por isso
+// com carga os batches crescem sozinhos e sem carga não há espera.
+// Cada job corre num SAVEPOINT: um erro (404, 500...) só desfaz esse
+// pedido. As respostas saem depois do COMMIT.
+
+#define WRITEQ_MAX_BATCH 256
+
+struct dbexec_job;
+
+// Resultado de um job: status HTTP + corpo JSON (na arena da thread do
+// writer, até ao fim do job; NULL para 204).
+// status >= 400 faz rollback do SAVEPOINT do job.
+struct writeq_result {
+  int status;
+  char *body;
+};
+
+// Preenche o resultado (formatos do mg_xprintf, incluindo %M)
+void writeq_reply(struct writeq_result *res, int status, const char *fmt, ...);
+
+// Corre na thread do writer, dentro da transação do batch.
+// arg = cópia dos parâmetros passados ao writeq_submit.
+typedef void (*writeq_fn)(const void *arg, struct writeq_result *res);
+
+// Arranca o writer (depth = tamanho máximo da fila). Retorna 1 se ok.
+int writeq_start(int depth);
+
+// Faz commit do que está na fila e pára o writer
+void writeq_stop(void);
+
+// Submete um job (arg é copiado). Para escritas que não saem de um handler
+// do router, p.ex. depois do hashpool (auth); um pedido que só escreve é
+// uma rota ROUTE_WRITE. hm = pedido (para o "Connection: close"), NULL se
+// já não existe. Retorna 1 se aceite, 0 se a fila está cheia ou sem
+// memória (responder 503).
+int writeq_submit(struct mg_connection *c, struct mg_http_message *hm, writeq_fn fn,
+                  const void *arg, size_t arg_len);
+
+// Job já montado pelo dbexec_submit. Retorna 0 se a fila está cheia.
+int writeq_push(struct dbexec_job *job);
+
+// Contadores (para /health)
+int writeq_queued(void);
+void writeq_stats(unsigned long *batches, unsigned long *jobs);
+
+#endif